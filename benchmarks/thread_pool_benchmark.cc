@@ -0,0 +1,246 @@
+/**
+ * \file    thread_pool_benchmark.cc
+ * \authors \ref contributors
+ * \date    Created on October 16, 2026
+ * \brief   Throughput and latency benchmarks for the ThreadPool.
+ *
+ * \copyright Copyright 2026 Deutsches Elektronen-Synchrotron (DESY), Hamburg
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2.1 of the license, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+// Usage: thread_pool_benchmark [output.json]
+//
+// Measures, for several thread counts,
+// - the throughput of empty tasks (tasks per second),
+// - the latency between add_task() and the start of the task (percentiles),
+// - the accuracy of delayed tasks (lateness percentiles), and
+// - the cost of cancel_pending_tasks() on a full queue.
+//
+// The results are written as JSON to the given file or to stdout.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gul14/cat.h>
+#include <gul14/join_split.h>
+#include <gul14/ThreadPool.h>
+#include <gul14/Trigger.h>
+#include <gul14/version.h>
+
+using namespace gul14;
+using namespace std::literals;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t num_throughput_tasks = 200'000;
+constexpr std::size_t num_latency_tasks = 10'000;
+constexpr std::size_t num_delayed_tasks = 500;
+constexpr std::size_t num_cancel_tasks = 1'000'000;
+
+// Return a JSON object with the given percentiles of a set of durations in microseconds.
+std::string percentiles_json(std::vector<Clock::duration> durations)
+{
+    std::sort(durations.begin(), durations.end());
+
+    const auto to_us = [](Clock::duration d)
+        {
+            return std::chrono::duration<double, std::micro>(d).count();
+        };
+
+    const auto percentile = [&](double p)
+        {
+            const auto idx = static_cast<std::size_t>(
+                p / 100.0 * static_cast<double>(durations.size() - 1) + 0.5);
+            return to_us(durations[idx]);
+        };
+
+    return cat("{ \"p50\": ", percentile(50.0), ", \"p90\": ", percentile(90.0),
+        ", \"p99\": ", percentile(99.0), ", \"max\": ", to_us(durations.back()), " }");
+}
+
+// Wait until the pool has neither pending nor running tasks.
+void wait_until_idle(const ThreadPool& pool)
+{
+    while (!pool.is_idle())
+        std::this_thread::yield();
+}
+
+// Return the number of empty tasks per second that the pool executes.
+double measure_throughput(std::size_t num_threads)
+{
+    ThreadPoolOptions options;
+    options.num_threads = num_threads;
+    options.capacity = num_throughput_tasks;
+    auto pool = make_thread_pool(options);
+
+    const auto t0 = Clock::now();
+    for (std::size_t i = 0; i != num_throughput_tasks; ++i)
+        pool->add_task([]() {});
+    wait_until_idle(*pool);
+    const std::chrono::duration<double> elapsed = Clock::now() - t0;
+
+    return static_cast<double>(num_throughput_tasks) / elapsed.count();
+}
+
+// Return the percentiles of the time between add_task() and the start of the task.
+std::string measure_submit_to_start_latency(std::size_t num_threads)
+{
+    ThreadPoolOptions options;
+    options.num_threads = num_threads;
+    options.capacity = num_latency_tasks;
+    auto pool = make_thread_pool(options);
+
+    std::vector<Clock::duration> latencies(num_latency_tasks);
+
+    // Submit in small bursts so that the measurement includes the wakeup of idle
+    // workers as well as the queueing behind other tasks.
+    constexpr std::size_t burst_size = 8;
+    for (std::size_t i = 0; i < num_latency_tasks; i += burst_size)
+    {
+        const auto end = std::min(i + burst_size, num_latency_tasks);
+        for (std::size_t j = i; j != end; ++j)
+        {
+            auto& latency = latencies[j];
+            pool->add_task([&latency, submit_time = Clock::now()]()
+                {
+                    latency = Clock::now() - submit_time;
+                });
+        }
+        wait_until_idle(*pool);
+    }
+
+    return percentiles_json(std::move(latencies));
+}
+
+// Return the percentiles of the lateness of delayed tasks relative to their start time.
+std::string measure_delay_accuracy(std::size_t num_threads)
+{
+    ThreadPoolOptions options;
+    options.num_threads = num_threads;
+    options.capacity = num_delayed_tasks;
+    auto pool = make_thread_pool(options);
+
+    std::vector<Clock::duration> lateness(num_delayed_tasks);
+
+    const auto t0 = Clock::now();
+    for (std::size_t i = 0; i != num_delayed_tasks; ++i)
+    {
+        auto& late = lateness[i];
+        const auto start_time = t0 + 1ms + (i % 100) * 500us;
+        pool->add_task([&late, start_time]() { late = Clock::now() - start_time; },
+            start_time);
+    }
+    wait_until_idle(*pool);
+
+    return percentiles_json(std::move(lateness));
+}
+
+// Return a JSON object with the time needed to cancel a full queue of pending tasks.
+std::string measure_cancel_cost(std::size_t num_threads)
+{
+    Trigger go;
+
+    ThreadPoolOptions options;
+    options.num_threads = num_threads;
+    options.capacity = num_cancel_tasks + num_threads;
+    auto pool = make_thread_pool(options);
+
+    // Block all workers so that the queue stays full
+    for (std::size_t i = 0; i != num_threads; ++i)
+        pool->add_task([&go]() { go.wait(); });
+    while (pool->count_pending() != 0)
+        std::this_thread::yield();
+
+    for (std::size_t i = 0; i != num_cancel_tasks; ++i)
+        pool->add_task([]() {});
+
+    const auto t0 = Clock::now();
+    const auto num_canceled = pool->cancel_pending_tasks();
+    const std::chrono::duration<double, std::milli> elapsed = Clock::now() - t0;
+
+    go = true;
+    wait_until_idle(*pool);
+
+    const auto num_tasks = static_cast<double>(std::max<std::size_t>(num_canceled, 1));
+    const auto ns_per_task = elapsed.count() * 1e6 / num_tasks;
+
+    return cat("{ \"num_tasks\": ", num_canceled, ", \"total_ms\": ", elapsed.count(),
+        ", \"ns_per_task\": ", ns_per_task, " }");
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    const std::size_t hw_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    const std::set<std::size_t> thread_counts{ 1, 2, 4, hw_threads };
+
+    std::vector<std::string> results;
+
+    for (const std::size_t num_threads : thread_counts)
+    {
+        std::cerr << "Running benchmarks with " << num_threads << " thread(s)\n";
+
+        const auto tasks_per_second = measure_throughput(num_threads);
+        const auto latency = measure_submit_to_start_latency(num_threads);
+        const auto lateness = measure_delay_accuracy(num_threads);
+        const auto cancel_cost = measure_cancel_cost(num_threads);
+
+        results.push_back(cat(
+            "    {\n"
+            "      \"num_threads\": ", num_threads, ",\n"
+            "      \"empty_tasks_per_second\": ", tasks_per_second, ",\n"
+            "      \"submit_to_start_latency_us\": ", latency, ",\n"
+            "      \"delayed_task_lateness_us\": ", lateness, ",\n"
+            "      \"cancel_pending_tasks\": ", cancel_cost, "\n"
+            "    }"));
+    }
+
+    const auto json = cat(
+        "{\n"
+        "  \"library_version\": \"", version_api, "\",\n"
+        "  \"hardware_concurrency\": ", hw_threads, ",\n"
+        "  \"results\": [\n", join(results, ",\n"), "\n  ]\n"
+        "}\n");
+
+    if (argc > 1)
+    {
+        std::ofstream file{ argv[1] };
+        file << json;
+        if (!file)
+        {
+            std::cerr << "Cannot write results to " << argv[1] << "\n";
+            return 1;
+        }
+        std::cerr << "Results written to " << argv[1] << "\n";
+    }
+    else
+    {
+        std::cout << json;
+    }
+
+    return 0;
+}
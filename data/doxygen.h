@@ -144,6 +144,86 @@ namespace gul14 {
  *
  * \section changelog_2_x 2.x Versions
  *
+ * \subsection V2_14_0 Version 2.14.0
+ *
+ * - Add ThreadPoolOptions and a work-stealing mode for ThreadPool
+ * - ThreadPool::get_thread_id() now throws when called from a worker of another pool
+ * - ThreadPool keeps delayed tasks in a heap ordered by start time, so that picking the
+ *   next task no longer scans the whole queue
+ * - ThreadPool tasks share an atomic state with their TaskHandle: get_state() and
+ *   cancel() take constant time and do not lock the pool. The TaskHandle constructor
+ *   takes an additional control block argument.
+ * - Add ThreadPool::add_detached_task() for tasks whose results are not needed. Small
+ *   function objects are stored inline in the task queues, and the shared states of
+ *   tasks are recycled, so that submitting tasks does not allocate in steady state.
+ * - Add ThreadPool::add_tasks() for enqueuing a whole range of tasks with a single lock
+ *   acquisition. It returns a ThreadPool::BatchHandle for waiting on or canceling the
+ *   batch.
+ * - Add parallel_for(), parallel_transform() and parallel_reduce() in the new header
+ *   gul14/parallel.h. They distribute the work over a ThreadPool in adaptively sized
+ *   chunks, with the calling thread participating.
+ * - Add TaskDependencies and after() for ThreadPool::add_task(): A task can be made to
+ *   wait for other tasks without blocking a thread. It is enqueued when all of its
+ *   predecessors have finished and canceled if one of them is canceled.
+ * - Add ThreadPool::TaskHandle::then(), when_all(), when_any() and after_any() for
+ *   reacting to the completion of tasks without blocking a thread.
+ * - ThreadPool schedules delayed tasks on the steady clock, so that adjustments of the
+ *   system clock do not affect them. Start times can be given as a
+ *   ThreadPool::SteadyTimePoint.
+ * - Add ThreadPoolOptions::timer_wheel for storing delayed tasks in a hierarchical
+ *   timer wheel with constant-time insertion
+ * - Add ThreadPool::add_periodic_task() for tasks that run repeatedly at a fixed rate
+ *   or with a fixed delay, reusing one task object and one handle for all runs
+ * - Add ThreadPoolOptions::cpu_sets and ThreadPoolOptions::numa_groups for pinning
+ *   worker threads to CPUs and grouping them by NUMA node, and
+ *   ThreadPool::add_task_to_worker_group() for submitting tasks to the workers of one
+ *   worker group
+ * - ThreadPool can change its number of threads at runtime:
+ *   ThreadPool::set_thread_count() resizes the pool explicitly, and
+ *   ThreadPoolOptions::max_num_threads, ThreadPoolOptions::min_num_threads,
+ *   ThreadPoolOptions::queue_wait_threshold and ThreadPoolOptions::idle_timeout let it
+ *   grow under load and shrink when idle.
+ * - Add ThreadPool::add_task_blocking(), which waits (optionally with a timeout) for
+ *   room in a full queue, and ThreadPool::try_add_task(), which returns an empty
+ *   optional instead of throwing
+ * - Add ThreadPool::get_statistics() for a lock-free snapshot of task counters, of
+ *   histograms of queue waiting and execution times, and of the busy and idle times of
+ *   the workers (times are measured if ThreadPoolOptions::measure_task_times is set)
+ * - Add ThreadPoolOptions::trace_buffer_size and ThreadPool::get_trace_json() for
+ *   recording task executions per worker and exporting them as a Chrome trace
+ * - Add ThreadPool::Strand and ThreadPool::make_strand(): Tasks that are added to the
+ *   same strand with add_task(fct, strand) run one after another in FIFO order, while
+ *   waiting tasks do not occupy a worker thread
+ * - Add ThreadPoolOptions::spin_duration: Idle workers can poll for new tasks for a
+ *   while before they go to sleep, which reduces the latency of task submissions
+ * - Add ThreadPool::CancellationToken and ThreadPool::get_cancellation_token(): Canceling
+ *   a running task sets its token, which the task can poll with a single atomic load
+ * - ThreadPool::TaskHandle stores the result of its task inline in the shared state of
+ *   the task instead of using std::future: Creating and completing a task no longer
+ *   allocates a separate future state, and TaskHandle::is_complete() is a single atomic
+ *   load. The constructor of TaskHandle takes this shared state instead of a
+ *   std::future.
+ * - Add ThreadPool::Deadline and add_task(fct, deadline): A task that has not been
+ *   started by its deadline is dropped and reported as TaskState::expired.
+ *   ThreadPoolOptions::earliest_deadline_first starts such tasks in the order of their
+ *   deadlines.
+ * - Add ShardedThreadPool in the new header gul14/ShardedThreadPool.h: A set of
+ *   independent ThreadPool shards to which tasks are routed by key or by shard index,
+ *   with optional spillover to the least loaded shard
+ * - Task names are passed as ThreadPool::TaskName, which can refer to string literals
+ *   (ThreadPool::TaskName::literal()) and to names from ThreadPool::TaskName::intern()
+ *   instead of copying them. The pool no longer copies task names when starting a task
+ *   and skips the name bookkeeping for unnamed tasks.
+ * - Add ThreadPool::TaskGroup and ThreadPool::make_task_group() for waiting for and
+ *   canceling a set of tasks together. Tasks join a group with add_task(fct, group).
+ * - Add the meson option \c benchmarks and a ThreadPool benchmark (run with
+ *   <tt>ninja benchmark</tt>) that reports throughput, submit-to-start latency,
+ *   delayed-task accuracy, and cancellation cost as JSON
+ * - Add CompletionQueue in the new header gul14/CompletionQueue.h: Finished tasks post
+ *   notifications to a lock-free list that is signaled through a file descriptor
+ *   (an eventfd on Linux), so that event loops can collect many completions per
+ *   wakeup. Add ThreadPool::TaskHandle::get_id().
+ *
  * \subsection V2_13_0 Version 2.13.0
  *
  * - *Released with DOOCS 25.4.0 and later*
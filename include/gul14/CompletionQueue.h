@@ -0,0 +1,182 @@
+/**
+ * \file    CompletionQueue.h
+ * \authors \ref contributors
+ * \date    Created on October 16, 2026
+ * \brief   Declaration of the CompletionQueue class.
+ *
+ * \copyright Copyright 2026 Deutsches Elektronen-Synchrotron (DESY), Hamburg
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2.1 of the license, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef GUL14_COMPLETIONQUEUE_H_
+#define GUL14_COMPLETIONQUEUE_H_
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "gul14/internal.h"
+#include "gul14/ThreadPool.h"
+
+namespace gul14 {
+
+/**
+ * \addtogroup CompletionQueue_h gul14/CompletionQueue.h
+ * \brief A pollable queue of notifications about finished tasks.
+ * @{
+ */
+
+/**
+ * A queue that collects notifications about finished ThreadPool tasks and signals them
+ * through a file descriptor.
+ *
+ * This allows an event loop (e.g. based on epoll, poll, or select) to learn about
+ * finished tasks without blocking on their handles: The loop watches the file
+ * descriptor returned by get_fd() and calls harvest() whenever it becomes readable.
+ *
+ * \code{.cpp}
+ * auto pool = make_thread_pool(4);
+ * CompletionQueue completions;
+ *
+ * auto task = pool->add_task([]() { return compute(); });
+ * completions.watch(task);
+ *
+ * epoll_event event{};
+ * event.events = EPOLLIN;
+ * epoll_ctl(epoll_fd, EPOLL_CTL_ADD, completions.get_fd(), &event);
+ *
+ * // In the event loop, after epoll_wait() has reported the descriptor as readable:
+ * for (const auto& completion : completions.harvest())
+ *     handle_finished_task(completion.id, completion.state);
+ * \endcode
+ *
+ * Finished tasks push their notification onto a lock-free list, and only the first
+ * notification after a harvest() makes the descriptor readable. A single wakeup of the
+ * event loop can therefore collect thousands of notifications. The results of the tasks
+ * stay in their TaskHandles, from which they can be taken without blocking once the
+ * notification has arrived.
+ *
+ * On Linux, the descriptor is an eventfd. On other POSIX systems, it is the read end of
+ * a pipe. On platforms without either, get_fd() returns -1 and harvest() has to be
+ * polled.
+ *
+ * watch() and harvest() are thread-safe, but harvest() is meant to be called by a
+ * single consumer. A CompletionQueue may be destroyed before the watched tasks have
+ * finished; their notifications are discarded.
+ *
+ * \since GUL version 2.14
+ */
+class CompletionQueue
+{
+public:
+    /// A notification about a finished task.
+    struct Completion
+    {
+        /// ID of the task (see ThreadPool::TaskHandle::get_id())
+        ThreadPool::TaskId id;
+
+        /// Final state of the task (complete, canceled, or expired)
+        TaskState state;
+    };
+
+    /**
+     * Construct an empty completion queue.
+     *
+     * \exception std::system_error is thrown if the file descriptor cannot be created.
+     */
+    GUL_EXPORT
+    CompletionQueue();
+
+    /// Destruct the queue and close its file descriptor.
+    GUL_EXPORT
+    ~CompletionQueue();
+
+    /// Not copyable and not movable
+    CompletionQueue(const CompletionQueue&) = delete;
+    CompletionQueue(CompletionQueue&&) = delete;
+    CompletionQueue& operator=(const CompletionQueue&) = delete;
+    CompletionQueue& operator=(CompletionQueue&&) = delete;
+
+    /**
+     * Return a file descriptor that becomes readable when notifications are available.
+     *
+     * The descriptor is owned by the queue and must not be read from or closed by the
+     * caller; harvest() resets it. The function returns -1 on platforms without
+     * eventfd or pipes.
+     */
+    GUL_EXPORT
+    int get_fd() const noexcept;
+
+    /**
+     * Remove all available notifications from the queue and append them to the given
+     * vector, in the order in which the tasks have finished.
+     *
+     * This resets the file descriptor; it becomes readable again with the next
+     * notification. The function does not block.
+     *
+     * \returns the number of notifications that were appended.
+     */
+    GUL_EXPORT
+    std::size_t harvest(std::vector<Completion>& completions);
+
+    /**
+     * Remove all available notifications from the queue and return them, in the order
+     * in which the tasks have finished.
+     */
+    std::vector<Completion> harvest()
+    {
+        std::vector<Completion> completions;
+        harvest(completions);
+        return completions;
+    }
+
+    /**
+     * Post a notification to this queue when the given task has finished.
+     *
+     * If the task has already finished, the notification is posted immediately. A task
+     * can be watched by several queues.
+     *
+     * \exception std::logic_error is thrown if the handle is not associated with a task
+     *            (e.g. if it was default-constructed).
+     */
+    template <typename T>
+    void watch(const ThreadPool::TaskHandle<T>& task)
+    {
+        if (!task.control_)
+            throw std::logic_error("Task handle is not associated with a task");
+
+        watch_task(*task.control_, task.id_);
+    }
+
+private:
+    struct Node;
+    struct State;
+    struct Watch;
+
+    std::shared_ptr<State> state_;
+
+    /// Register a continuation that posts a notification when the task has finished.
+    GUL_EXPORT
+    void watch_task(detail::TaskControlBlock& control, ThreadPool::TaskId id);
+};
+
+/// @}
+
+} // namespace gul14
+
+#endif // GUL14_COMPLETIONQUEUE_H_
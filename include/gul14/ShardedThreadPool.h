@@ -0,0 +1,270 @@
+/**
+ * \file    ShardedThreadPool.h
+ * \authors \ref contributors
+ * \date    Created on October 16, 2026
+ * \brief   Declaration of the ShardedThreadPool class.
+ *
+ * \copyright Copyright 2026 Deutsches Elektronen-Synchrotron (DESY), Hamburg
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2.1 of the license, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef GUL14_SHARDEDTHREADPOOL_H_
+#define GUL14_SHARDEDTHREADPOOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "gul14/cat.h"
+#include "gul14/ThreadPool.h"
+
+namespace gul14 {
+
+/**
+ * \addtogroup ShardedThreadPool_h gul14/ShardedThreadPool.h
+ * \brief A set of independent thread pools with keyed task submission.
+ * @{
+ */
+
+/**
+ * A set of options for constructing a ShardedThreadPool.
+ *
+ * \since GUL version 2.14
+ */
+struct ShardedThreadPoolOptions
+{
+    /// Number of shards, i.e. of independent thread pools.
+    std::size_t num_shards{ 2 };
+
+    /**
+     * Options for each of the shards. The number of threads and the capacity apply to
+     * each shard individually.
+     */
+    ThreadPoolOptions shard_options;
+
+    /**
+     * Number of pending tasks on the target shard from which new tasks spill over to the
+     * least loaded shard (0, the default, disables spillover).
+     *
+     * Spillover evens out an imbalance between the shards at the price of the key
+     * affinity: A task that spills over may run concurrently with, and in a different
+     * order than, other tasks for the same key.
+     */
+    std::size_t spillover_threshold{ 0 };
+};
+
+/**
+ * A thread pool that is split into independent shards.
+ *
+ * Each shard is a complete ThreadPool with its own queue, lock, condition variable, and
+ * worker threads. Submitting a task to one shard therefore never contends with the
+ * submissions to or the workers of another shard. This suits workloads that partition
+ * naturally by a key (e.g. a connection, a device, or a client ID): All tasks for the
+ * same key go to the same shard, so with one thread per shard they are even executed
+ * one after another in the order of submission.
+ *
+ * \code{.cpp}
+ * ShardedThreadPoolOptions options;
+ * options.num_shards = 8;
+ * ShardedThreadPool pool{ options };
+ *
+ * auto task = pool.add_task_by_key(client_id, [&]() { return handle(request); });
+ * \endcode
+ *
+ * Tasks are routed either by hashing a key with add_task_by_key() or by an explicit
+ * shard index with add_task_to_shard(). The handles that are returned are the usual
+ * ThreadPool::TaskHandle objects of the shard, and functions taking a `ThreadPool&`
+ * receive the shard on which they run. Features that are not forwarded here (delayed
+ * tasks, strands, statistics, ...) are available through get_shard().
+ *
+ * All public member functions are thread-safe.
+ *
+ * \since GUL version 2.14
+ */
+class ShardedThreadPool
+{
+public:
+    /**
+     * Construct a sharded thread pool and start the worker threads of all shards.
+     *
+     * \exception std::invalid_argument is thrown if the number of shards is zero or if
+     *            the shard options are invalid (see make_thread_pool()).
+     */
+    explicit ShardedThreadPool(const ShardedThreadPoolOptions& options)
+        : spillover_threshold_{ options.spillover_threshold }
+    {
+        if (options.num_shards == 0)
+            throw std::invalid_argument("A sharded thread pool needs at least one shard");
+
+        shards_.reserve(options.num_shards);
+        for (std::size_t i = 0; i != options.num_shards; ++i)
+            shards_.push_back(make_thread_pool(options.shard_options));
+    }
+
+    /**
+     * Enqueue a task on the shard that is selected by hashing a key.
+     *
+     * \param key   A key for which std::hash is defined. All tasks with the same key go
+     *              to the same shard (unless they spill over to another one).
+     * \param fct   A function object or function pointer to be executed (see
+     *              ThreadPool::add_task())
+     * \param name  Optional name for the task (mainly for debugging)
+     *
+     * \returns a TaskHandle for the task.
+     * \exception std::runtime_error is thrown if the queue of the shard is full.
+     */
+    template <typename Key, typename Function>
+    auto add_task_by_key(const Key& key, Function fct,
+        ThreadPool::TaskName name = {})
+    {
+        return add_task_to_shard(get_shard_index(key), std::move(fct), std::move(name));
+    }
+
+    /**
+     * Enqueue a task on the shard with the given index.
+     *
+     * \param shard_index  Index of the shard in the range [0, count_shards())
+     * \param fct          A function object or function pointer to be executed (see
+     *                     ThreadPool::add_task())
+     * \param name         Optional name for the task (mainly for debugging)
+     *
+     * \returns a TaskHandle for the task.
+     * \exception std::out_of_range is thrown if the shard index is invalid.
+     *            std::runtime_error is thrown if the queue of the shard is full.
+     */
+    template <typename Function>
+    auto add_task_to_shard(std::size_t shard_index, Function fct,
+        ThreadPool::TaskName name = {})
+    {
+        return select_shard(shard_index).add_task(std::move(fct), std::move(name));
+    }
+
+    /**
+     * Remove all tasks from the queues of all shards that have not been started yet.
+     *
+     * \returns the number of tasks that were canceled.
+     */
+    std::size_t cancel_pending_tasks()
+    {
+        std::size_t num_canceled = 0;
+        for (const auto& shard : shards_)
+            num_canceled += shard->cancel_pending_tasks();
+        return num_canceled;
+    }
+
+    /// Return the total number of pending tasks on all shards.
+    std::size_t count_pending() const
+    {
+        std::size_t num_pending = 0;
+        for (const auto& shard : shards_)
+            num_pending += shard->count_pending();
+        return num_pending;
+    }
+
+    /// Return the number of shards.
+    std::size_t count_shards() const noexcept { return shards_.size(); }
+
+    /// Return the total number of worker threads on all shards.
+    std::size_t count_threads() const noexcept
+    {
+        std::size_t num_threads = 0;
+        for (const auto& shard : shards_)
+            num_threads += shard->count_threads();
+        return num_threads;
+    }
+
+    /**
+     * Return the shard with the given index.
+     *
+     * \exception std::out_of_range is thrown if the shard index is invalid.
+     */
+    ThreadPool& get_shard(std::size_t shard_index) const
+    {
+        if (shard_index >= shards_.size())
+            throw std::out_of_range(cat("Invalid shard index: ", shard_index));
+
+        return *shards_[shard_index];
+    }
+
+    /**
+     * Return the index of the shard to which tasks for the given key are routed.
+     *
+     * The result of std::hash is mixed before it is mapped onto the shards, so that
+     * keys like consecutive integers (for which std::hash is usually the identity) are
+     * spread evenly.
+     */
+    template <typename Key>
+    std::size_t get_shard_index(const Key& key) const
+    {
+        const auto hash = static_cast<std::uint64_t>(std::hash<Key>{}(key));
+        const auto mixed = (hash * 0x9e3779b97f4a7c15ull) >> 32;
+        return static_cast<std::size_t>(mixed % shards_.size());
+    }
+
+    /// Return true if no shard has pending or running tasks.
+    bool is_idle() const
+    {
+        for (const auto& shard : shards_)
+        {
+            if (!shard->is_idle())
+                return false;
+        }
+        return true;
+    }
+
+private:
+    std::vector<std::shared_ptr<ThreadPool>> shards_;
+    std::size_t spillover_threshold_{ 0 };
+
+    /**
+     * Return the shard on which a task for the given shard is to be enqueued: The shard
+     * itself, or the least loaded shard if the task spills over.
+     */
+    ThreadPool& select_shard(std::size_t shard_index) const
+    {
+        ThreadPool* shard = &get_shard(shard_index);
+
+        if (spillover_threshold_ == 0)
+            return *shard;
+
+        std::size_t min_pending = shard->count_pending();
+        if (min_pending < spillover_threshold_)
+            return *shard;
+
+        for (const auto& candidate : shards_)
+        {
+            const std::size_t num_pending = candidate->count_pending();
+            if (num_pending < min_pending)
+            {
+                min_pending = num_pending;
+                shard = candidate.get();
+            }
+        }
+
+        return *shard;
+    }
+};
+
+/// @}
+
+} // namespace gul14
+
+#endif // GUL14_SHARDEDTHREADPOOL_H_
@@ -25,29 +25,108 @@
 #ifndef GUL14_THREADPOOL_H_
 #define GUL14_THREADPOOL_H_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <functional>
-#include <future>
+#include <initializer_list>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <stdexcept>
+#include <string>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
 #include <gul14/cat.h>
+#include <gul14/optional.h>
+#include <gul14/string_view.h>
 #include <gul14/traits.h>
 
 namespace gul14 {
 
+class CompletionQueue;
+class TaskDependencies;
 class ThreadPool;
+struct ThreadPoolOptions;
 
 namespace detail {
 
 GUL_EXPORT
 std::shared_ptr<ThreadPool> lock_pool_or_throw(std::weak_ptr<ThreadPool> pool);
 
+/**
+ * Allocate a memory block of the given size, preferably from a thread-local cache of
+ * recycled blocks (which is refilled from a shared depot when it runs empty).
+ */
+GUL_EXPORT
+void* allocate_recycled(std::size_t size);
+
+/**
+ * Return a memory block that was obtained from allocate_recycled() with the same size
+ * to the thread-local cache of the calling thread. If the cache is full, part of it is
+ * handed over to a shared depot (or released if the depot is full as well).
+ */
+GUL_EXPORT
+void deallocate_recycled(void* ptr, std::size_t size) noexcept;
+
+/**
+ * A stateless allocator that recycles memory blocks of single objects.
+ *
+ * Small blocks are taken from and returned to thread-local caches, so that frequently
+ * recurring allocations of the same size (like the shared states of tasks and futures)
+ * do not reach the global heap in steady state. The caches exchange batches of blocks
+ * through a shared depot, so this also holds if the blocks are allocated on one thread
+ * and freed on another. Arrays and over-aligned types are allocated with
+ * std::allocator.
+ */
+template <typename T>
+struct RecyclingAllocator
+{
+    using value_type = T;
+
+    RecyclingAllocator() noexcept = default;
+
+    template <typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>&) noexcept
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        if (n == 1 && alignof(T) <= alignof(std::max_align_t))
+            return static_cast<T*>(allocate_recycled(sizeof(T)));
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept
+    {
+        if (n == 1 && alignof(T) <= alignof(std::max_align_t))
+            deallocate_recycled(ptr, sizeof(T));
+        else
+            std::allocator<T>{}.deallocate(ptr, n);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const RecyclingAllocator<T>&, const RecyclingAllocator<U>&) noexcept
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const RecyclingAllocator<T>&, const RecyclingAllocator<U>&) noexcept
+{
+    return false;
+}
+
 } // namespace detail
 
 /**
@@ -67,9 +146,471 @@ enum class TaskState
     pending,  ///< The task is waiting to be started.
     running,  ///< The task is currently being executed.
     complete, ///< The task has finished (successfully or by throwing an exception).
-    canceled  ///< The task was removed from the queue before it was started.
+    canceled, ///< The task was removed from the queue before it was started.
+    expired   ///< The task was dropped because it had not started before its deadline.
+              ///< \since GUL version 2.14
+};
+
+/**
+ * A set of options for a periodic task on a ThreadPool (see
+ * ThreadPool::add_periodic_task()).
+ *
+ * \since GUL version 2.14
+ */
+struct PeriodicTaskOptions
+{
+    /// How the start time of the next run is determined.
+    enum class Mode
+    {
+        /**
+         * Runs are scheduled at fixed intervals from the first start time, regardless of
+         * how long each run takes. Delays in starting one run do not accumulate.
+         */
+        fixed_rate,
+        /// Each run is scheduled one period after the end of the previous run.
+        fixed_delay
+    };
+
+    /// How the start time of the next run is determined.
+    Mode mode{ Mode::fixed_rate };
+
+    /**
+     * In fixed-rate mode, skip runs whose start times have already passed when the
+     * previous run ends (e.g. because it took longer than one period) and continue with
+     * the next start time in the future. If this flag is false, the missed runs are
+     * started back to back until the schedule has caught up.
+     */
+    bool skip_missed_ticks{ true };
+
+    /// Delay between adding the task and its first run.
+    std::chrono::steady_clock::duration initial_delay{ 0 };
+};
+
+/**
+ * A snapshot of runtime statistics of a ThreadPool (see ThreadPool::get_statistics()).
+ *
+ * The pool updates its counters without locking, and the snapshot reads them one by
+ * one. While tasks are being executed, the values can therefore be slightly
+ * inconsistent with each other (e.g. a task may already be counted as started, but not
+ * yet in the histogram of waiting times).
+ *
+ * \since GUL version 2.14
+ */
+struct ThreadPoolStatistics
+{
+    /// Type used for durations in the statistics.
+    using Duration = std::chrono::steady_clock::duration;
+
+    /// Number of bins in a Histogram.
+    constexpr static std::size_t num_bins{ 32 };
+
+    /**
+     * A histogram of durations with logarithmic bins: Bin 0 counts durations below one
+     * microsecond, bin i counts durations in the range [2^(i-1), 2^i) microseconds, and
+     * the last bin additionally counts all longer durations.
+     */
+    using Histogram = std::array<std::uint64_t, num_bins>;
+
+    /// Statistics of a single worker thread.
+    struct WorkerStatistics
+    {
+        /// Number of task runs completed by the worker
+        std::uint64_t num_completed{ 0 };
+
+        /// Total time spent executing tasks (only measured if
+        /// ThreadPoolOptions::measure_task_times is set)
+        Duration busy_time{ 0 };
+
+        /// Total time for which the worker thread was running, but not executing a task
+        /// (only measured if ThreadPoolOptions::measure_task_times is set)
+        Duration idle_time{ 0 };
+    };
+
+    /// Number of tasks that have been submitted to the pool (a periodic task counts once)
+    std::uint64_t num_submitted{ 0 };
+
+    /// Number of task runs that have been started (each run of a periodic task counts)
+    std::uint64_t num_started{ 0 };
+
+    /// Number of task runs that have finished (successfully or with an exception)
+    std::uint64_t num_completed{ 0 };
+
+    /// Number of tasks that have been canceled before being started
+    std::uint64_t num_canceled{ 0 };
+
+    /// Number of tasks that have been dropped because they missed their deadline
+    std::uint64_t num_expired{ 0 };
+
+    /**
+     * Histogram of the times that tasks have been waiting to be started after becoming
+     * ready, i.e. after being submitted or after reaching their start time (only filled
+     * if ThreadPoolOptions::measure_task_times is set).
+     */
+    Histogram queue_wait_times{};
+
+    /// Histogram of the execution times of tasks (only filled if
+    /// ThreadPoolOptions::measure_task_times is set)
+    Histogram execution_times{};
+
+    /// Statistics for each worker, indexed by thread ID (one entry per possible thread)
+    std::vector<WorkerStatistics> workers;
+
+    /// Return the shortest duration that is counted in the given histogram bin.
+    static Duration get_bin_lower_limit(std::size_t bin) noexcept
+    {
+        if (bin == 0)
+            return Duration{ 0 };
+
+        return std::chrono::duration_cast<Duration>(
+            std::chrono::microseconds{ std::int64_t{ 1 } << (bin - 1) });
+    }
+};
+
+namespace detail {
+
+/**
+ * Shared state of a task on a ThreadPool.
+ *
+ * The control block is shared between the pool and the TaskHandle of a task. Its state
+ * is updated atomically, so that handles can query it without interacting with the pool.
+ */
+struct TaskControlBlock;
+
+/**
+ * An action to be performed when a task has finished (i.e. it has been completed or
+ * canceled). Continuations are registered with TaskControlBlock::add_continuation().
+ */
+struct TaskContinuation
+{
+    virtual ~TaskContinuation() = default;
+
+    /// Perform the action; final_state is TaskState::complete, canceled, or expired.
+    virtual void run(TaskState final_state) noexcept = 0;
+
+    TaskContinuation* next_{ nullptr }; // Next continuation in the list of the task
+};
+
+struct TaskControlBlock
+{
+    std::atomic<TaskState> state_{ TaskState::pending };
+
+    /**
+     * Lock-free list of continuations that are run when the task finishes. After that,
+     * the list is closed and later continuations are run immediately.
+     */
+    std::atomic<TaskContinuation*> continuations_{ nullptr };
+
+    /// Flag set by TaskHandle::cancel() if the task could not be removed from the queue
+    std::atomic<bool> cancel_requested_{ false };
+
+    /// Flag indicating that a thread has gone to sleep in wait()
+    std::atomic<bool> has_waiters_{ false };
+
+    TaskControlBlock() = default;
+    TaskControlBlock(const TaskControlBlock&) = delete;
+    TaskControlBlock& operator=(const TaskControlBlock&) = delete;
+
+    GUL_EXPORT
+    ~TaskControlBlock();
+
+    /**
+     * Register a continuation to be run when the task finishes. If the task has already
+     * finished, the continuation is run immediately on the calling thread.
+     */
+    GUL_EXPORT
+    void add_continuation(std::unique_ptr<TaskContinuation> continuation) noexcept;
+
+    /**
+     * Wake up the threads waiting in wait(), then run and destroy all registered
+     * continuations. This must be called exactly once, after the state has been set to
+     * complete, canceled, or expired.
+     */
+    GUL_EXPORT
+    void run_continuations() noexcept;
+
+    /**
+     * Block until the task has finished and return its final state (complete, canceled,
+     * or expired).
+     *
+     * The calling thread sleeps on the state word itself (via a futex on Linux), so
+     * that the control block needs neither a mutex nor a condition variable.
+     */
+    GUL_EXPORT
+    TaskState wait() noexcept;
+};
+
+/**
+ * Shared state of a task with a result: A control block that additionally stores the
+ * return value (or the exception) of the task inline.
+ *
+ * The worker stores the result while the task is running, i.e. before the state becomes
+ * TaskState::complete. Creating and completing the shared state therefore needs only the
+ * allocation of the block itself, which is recycled by RecyclingAllocator.
+ */
+template <typename T>
+struct TaskResultBlock : TaskControlBlock
+{
+    optional<T> value_;
+    std::exception_ptr exception_;
+
+    /// Call a function and store its return value or exception.
+    template <typename Function, typename... Args>
+    void fulfill(Function& fct, Args&&... args) noexcept
+    {
+        try
+        {
+            value_.emplace(fct(std::forward<Args>(args)...));
+        }
+        catch (...)
+        {
+            exception_ = std::current_exception();
+        }
+    }
+
+    /// Move the result out or rethrow the exception of a completed task.
+    T take()
+    {
+        if (exception_)
+            std::rethrow_exception(exception_);
+        return std::move(*value_);
+    }
+};
+
+template <typename T>
+struct TaskResultBlock<T&> : TaskControlBlock
+{
+    T* value_{ nullptr };
+    std::exception_ptr exception_;
+
+    template <typename Function, typename... Args>
+    void fulfill(Function& fct, Args&&... args) noexcept
+    {
+        try
+        {
+            value_ = &fct(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            exception_ = std::current_exception();
+        }
+    }
+
+    T& take()
+    {
+        if (exception_)
+            std::rethrow_exception(exception_);
+        return *value_;
+    }
+};
+
+template <>
+struct TaskResultBlock<void> : TaskControlBlock
+{
+    std::exception_ptr exception_;
+
+    template <typename Function, typename... Args>
+    void fulfill(Function& fct, Args&&... args) noexcept
+    {
+        try
+        {
+            fct(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            exception_ = std::current_exception();
+        }
+    }
+
+    void take()
+    {
+        if (exception_)
+            std::rethrow_exception(exception_);
+    }
+};
+
+/**
+ * A lightweight replacement for std::future that retrieves the result of a task from its
+ * TaskResultBlock.
+ *
+ * Like a std::future, a TaskFuture is move-only and its result can be retrieved only
+ * once. Checking whether the result is available is a single atomic load.
+ */
+template <typename T>
+class TaskFuture
+{
+public:
+    TaskFuture() = default;
+
+    explicit TaskFuture(std::shared_ptr<TaskResultBlock<T>> block) noexcept
+        : block_{ std::move(block) }
+    {}
+
+    TaskFuture(TaskFuture&&) noexcept = default;
+    TaskFuture& operator=(TaskFuture&&) noexcept = default;
+    TaskFuture(const TaskFuture&) = delete;
+    TaskFuture& operator=(const TaskFuture&) = delete;
+
+    /// Determine whether the future refers to a result that has not been retrieved yet.
+    bool valid() const noexcept { return block_ != nullptr; }
+
+    /**
+     * Return another future that refers to the same result. Only one of the two may be
+     * used to retrieve it.
+     */
+    TaskFuture duplicate() const noexcept { return TaskFuture{ block_ }; }
+
+    /// Determine whether the task has completed. The future must be valid.
+    bool is_ready() const noexcept
+    {
+        return block_->state_.load(std::memory_order_acquire) == TaskState::complete;
+    }
+
+    /**
+     * Block until the task has finished and return its result (or rethrow its
+     * exception). Afterwards, the future is invalid. The future must be valid.
+     *
+     * \exception std::logic_error is thrown if the task was canceled or has expired.
+     */
+    T get()
+    {
+        auto block = std::move(block_);
+
+        switch (block->wait())
+        {
+        case TaskState::complete:
+            return block->take();
+        case TaskState::expired:
+            throw std::logic_error("Expired task has no result");
+        default:
+            throw std::logic_error("Canceled task has no result");
+        }
+    }
+
+private:
+    std::shared_ptr<TaskResultBlock<T>> block_;
+};
+
+/// Call a continuation function with the result of a finished task.
+template <typename Function, typename T>
+struct Continuation
+{
+    using Result = invoke_result_t<Function, T>;
+
+    static Result call(Function& fct, TaskFuture<T>& future)
+    {
+        return fct(future.get());
+    }
+};
+
+template <typename Function>
+struct Continuation<Function, void>
+{
+    using Result = invoke_result_t<Function>;
+
+    static Result call(Function& fct, TaskFuture<void>& future)
+    {
+        future.get();
+        return fct();
+    }
+};
+
+/**
+ * Shared state of a batch of tasks that was added with ThreadPool::add_tasks().
+ *
+ * Instead of a control block per task, all tasks of a batch share a counter of tasks
+ * that may still be started. A worker claims the right to start a task of the batch by
+ * decrementing this counter, and canceling the batch sets it to zero in a single step.
+ */
+struct BatchState
+{
+    explicit BatchState(std::size_t num_tasks)
+        : num_tasks_{ num_tasks }
+        , num_unstarted_{ num_tasks }
+        , num_remaining_{ num_tasks }
+    {}
+
+    /// Total number of tasks in the batch
+    const std::size_t num_tasks_;
+
+    /// Number of tasks that have not been started (or canceled) yet
+    std::atomic<std::size_t> num_unstarted_;
+
+    /// Number of tasks that have neither finished nor been canceled
+    std::atomic<std::size_t> num_remaining_;
+
+    /// Flag indicating that the remaining tasks of the batch have been canceled
+    std::atomic<bool> canceled_{ false };
+
+    std::mutex mutex_; // Protects exception_ and is used together with cv_
+    std::condition_variable cv_;
+    std::exception_ptr exception_; // First exception thrown by one of the tasks
+
+    /**
+     * Try to claim one of the unstarted tasks for execution.
+     * \returns true if successful, false if the batch has been canceled.
+     */
+    bool try_claim() noexcept
+    {
+        auto num = num_unstarted_.load(std::memory_order_relaxed);
+        while (num != 0)
+        {
+            if (num_unstarted_.compare_exchange_weak(num, num - 1,
+                    std::memory_order_acq_rel))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Mark the given number of tasks as finished and wake up waiting threads if needed.
+    void finish(std::size_t num) noexcept
+    {
+        if (num_remaining_.fetch_sub(num, std::memory_order_acq_rel) == num)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_all();
+        }
+    }
+
+    /// Store the given exception unless another one has been stored before.
+    void set_exception(std::exception_ptr e) noexcept
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!exception_)
+            exception_ = std::move(e);
+    }
+};
+
+/**
+ * Shared state of a periodic task that was added with ThreadPool::add_periodic_task().
+ *
+ * The same task object (and therefore the same control block) is put back into the
+ * queue after each run. Between runs, the state is TaskState::pending; it only becomes
+ * TaskState::canceled when the periodic task is stopped.
+ */
+struct PeriodicControlBlock : TaskControlBlock
+{
+    PeriodicControlBlock(std::chrono::steady_clock::duration period,
+        PeriodicTaskOptions::Mode mode, bool skip_missed_ticks)
+        : period_{ period }
+        , mode_{ mode }
+        , skip_missed_ticks_{ skip_missed_ticks }
+    {}
+
+    const std::chrono::steady_clock::duration period_;
+    const PeriodicTaskOptions::Mode mode_;
+    const bool skip_missed_ticks_;
+
+    /// Flag indicating that the task must not be rescheduled anymore
+    std::atomic<bool> stop_requested_{ false };
+
+    /// Number of completed runs
+    std::atomic<std::size_t> num_runs_{ 0 };
 };
 
+} // namespace detail
+
 /**
  * A pool of worker threads with a task queue.
  *
@@ -82,7 +623,7 @@ enum class TaskState
  * Each task is associated with a TaskHandle. This handle is returned by add_task() and
  * can be used to query the status of the task or to remove it from the queue via
  * \ref gul14::ThreadPool::TaskHandle::cancel() "cancel()". Tasks that are already running
- * cannot be canceled.
+ * cannot be removed, but they can poll a CancellationToken to stop early on request.
  *
  * \code{.cpp}
  * auto pool = make_thread_pool(1);
@@ -99,8 +640,19 @@ enum class TaskState
  * delay. Each task can also be given a name, which is mainly useful for debugging. See
  * the \ref thread_pool.cc "example" for an introduction.
  *
+ * Small function objects are stored directly inside the queue entry of a task, and the
+ * shared states of tasks and their results are recycled, so that adding tasks does not
+ * need to allocate memory from the heap in steady state. Tasks whose results are not
+ * needed can be added via add_detached_task(), which avoids the shared state altogether.
+ *
  * All public member functions are thread-safe.
  *
+ * Pools with many threads and short tasks can be created in work-stealing mode (see
+ * ThreadPoolOptions::work_stealing). In this mode, each worker thread owns a local task
+ * queue in addition to the shared one. Tasks that a worker enqueues for immediate
+ * execution are pushed onto its own queue without touching the shared lock, and idle
+ * workers steal tasks from their peers.
+ *
  * On Linux, threads in the pool explicitly block the signals SIGALRM, SIGINT, SIGPIPE,
  * SIGTERM, SIGURG, SIGUSR1, and SIGUSR2. This is done to prevent the threads from
  * terminating the whole process if one of these signals is received.
@@ -117,33 +669,119 @@ public:
     using ThreadId = std::vector<std::thread>::size_type;
 
     /**
-     * A handle for a task that has (or had) been enqueued on a ThreadPool.
+     * The name of a task, as shown by get_pending_task_names(), get_running_task_names()
+     * and get_trace_json().
      *
-     * A TaskHandle can be used to query the status of a task and to retrieve its result.
+     * A TaskName either owns a copy of the name or refers to a string that lives for
+     * the rest of the program:
+     * - A std::string, a `const char*` pointer, or a char array (including a string
+     *   literal) is copied into the TaskName: `pool->add_task(f, "refresh")`. Short
+     *   names usually fit into the internal buffer of std::string.
+     * - literal() refers to a string literal without copying it:
+     *   `pool->add_task(f, TaskName::literal("refresh"))`.
+     * - intern() returns a name from a process-wide table, so that names that are built
+     *   at runtime but recur often are stored only once.
      *
-     * \code{.cpp}
-     * auto pool = make_thread_pool(1);
-     * auto task = pool->add_task([]() { return 42; });
-     * while (not task.is_complete())
-     * {
-     *     std::cout << "Waiting for task to complete...\n";
-     *     sleep(0.1);
-     * }
-     * std::cout << "Task result: " << task.get_result() << "\n";
-     * \endcode
+     * Copying a referenced name never allocates memory, and the pool skips all name
+     * bookkeeping for unnamed tasks (the default).
+     *
+     * \since GUL version 2.14
      */
-    template <typename T>
-    class TaskHandle
+    class TaskName
     {
     public:
+        /// Construct an empty name (for an unnamed task).
+        TaskName() noexcept = default;
+
+        /// Construct a name from a copy of the null-terminated contents of a char array.
+        template <std::size_t N>
+        TaskName(const char (&str)[N])
+            : owned_name_{ str, static_cast<std::size_t>(
+                std::find(str, str + N, '\0') - str) }
+        {}
+
+        /// Construct a name from a copy of a null-terminated string.
+        template <typename CharPtr, std::enable_if_t<
+            std::is_same<CharPtr, const char*>::value
+            || std::is_same<CharPtr, char*>::value, int> = 0>
+        TaskName(const CharPtr& str)
+            : owned_name_{ str }
+        {}
+
+        /// Construct a name from a string, taking over its contents.
+        TaskName(std::string str) noexcept
+            : owned_name_{ std::move(str) }
+        {}
+
         /**
-         * Default-construct an invalid TaskHandle.
+         * Return a name that refers to an interned copy of the given string.
          *
-         * This constructor creates an invalid TaskHandle which has no result and is not
-         * associated with a ThreadPool.
+         * Interned strings are stored in a process-wide table and are never freed, so
+         * this is meant for a limited set of names. Interning the same string again
+         * returns a name that refers to the same storage.
          */
-        TaskHandle()
-        {}
+        GUL_EXPORT
+        static TaskName intern(string_view name);
+
+        /**
+         * Return a name that refers to a string literal without copying it.
+         *
+         * The string must not change and must live for the rest of the program, which is
+         * the case for string literals. Use the constructor for any other char array.
+         */
+        template <std::size_t N>
+        static TaskName literal(const char (&str)[N]) noexcept
+        {
+            TaskName result;
+            result.static_name_ = str;
+            return result;
+        }
+
+        /// Return the name as a null-terminated string.
+        const char* c_str() const noexcept
+        {
+            return static_name_ ? static_name_ : owned_name_.c_str();
+        }
+
+        /// Determine whether the name is empty.
+        bool empty() const noexcept
+        {
+            return static_name_ ? *static_name_ == '\0' : owned_name_.empty();
+        }
+
+    private:
+        const char* static_name_{ nullptr }; // Literal or interned name, or null
+        std::string owned_name_; // Only used if static_name_ is null
+    };
+
+    /**
+     * A handle for a task that has (or had) been enqueued on a ThreadPool.
+     *
+     * A TaskHandle can be used to query the status of a task and to retrieve its result.
+     *
+     * \code{.cpp}
+     * auto pool = make_thread_pool(1);
+     * auto task = pool->add_task([]() { return 42; });
+     * while (not task.is_complete())
+     * {
+     *     std::cout << "Waiting for task to complete...\n";
+     *     sleep(0.1);
+     * }
+     * std::cout << "Task result: " << task.get_result() << "\n";
+     * \endcode
+     */
+    template <typename T>
+    class TaskHandle
+    {
+    public:
+        /**
+         * Default-construct an invalid TaskHandle.
+         *
+         * This constructor creates an invalid TaskHandle which has no result and is not
+         * associated with a ThreadPool.
+         */
+        TaskHandle()
+        {}
 
         /**
          * Construct a TaskHandle.
@@ -152,32 +790,50 @@ public:
          * returned by the ThreadPool when a task is enqueued.
          *
          * \param id      Unique ID of the task
-         * \param future  A std::future that will eventually contain the result of the
-         *                task
+         * \param result  The shared state of the task, which will eventually contain
+         *                its result
          * \param pool    A shared pointer to the ThreadPool that the task is associated
          *                with
+         *
+         * \since GUL version 2.14, the constructor takes the shared state of the task
+         *        instead of a std::future
          */
-        TaskHandle(TaskId id, std::future<T> future, std::shared_ptr<ThreadPool> pool)
-            : future_{ std::move(future) }
+        TaskHandle(TaskId id, std::shared_ptr<detail::TaskResultBlock<T>> result,
+            std::shared_ptr<ThreadPool> pool)
+            : future_{ result }
+            , control_{ std::move(result) }
             , id_{ id }
             , pool_{ std::move(pool) }
         {}
 
         /**
-         * Remove the task from the queue if it is still pending.
+         * Remove the task from the queue if it is still pending, or request a running
+         * task to stop.
          *
-         * This call has no effect if the task is already running.
+         * If the task is already running, it cannot be removed. Instead, its
+         * CancellationToken is set: The task can poll the token and return early. In
+         * this case, the handle keeps its result. The call takes constant time,
+         * regardless of the number of tasks in the queue.
          *
-         * \returns true if the task was removed from the queue, false if it was not found in
-         *          the queue (e.g. because it is already running).
+         * \returns true if the task was removed from the queue, false if it was not
+         *          pending anymore (e.g. because it is already running).
          *
          * \exception std::logic_error is thrown if the associated thread pool does not
          *            exist anymore.
+         *
+         * \since GUL version 2.14, cancel() sets the cancellation token of a running
+         *        task
          */
         bool cancel()
         {
+            auto pool = detail::lock_pool_or_throw(pool_);
+            if (not pool->cancel_pending_task(*control_))
+            {
+                control_->cancel_requested_.store(true, std::memory_order_release);
+                return false;
+            }
             future_ = {};
-            return detail::lock_pool_or_throw(pool_)->cancel_pending_task(id_);
+            return true;
         }
 
         /**
@@ -198,419 +854,2717 @@ public:
          *
          * This function returns true if the task has finished, either successfully or by
          * throwing an exception. It returns false if the task is still running, waiting
-         * to be started, or has been canceled.
+         * to be started, or has been canceled or has expired. The check is a single
+         * atomic load.
          *
          * \note
-         * is_complete() does not need to interact with the ThreadPool to determine the
-         * state of the task. It is therefore slightly more performant than get_state(),
-         * but does not deliver the same fine-grained information.
+         * is_complete() only inspects the result of the task. It does not deliver the
+         * same fine-grained information as get_state().
          */
         bool is_complete() const
         {
-            if (not future_.valid())
-                return false;
-
-            return future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            return future_.valid() && future_.is_ready();
         }
 
+        /**
+         * Return the unique ID of the task (0 for a default-constructed handle).
+         *
+         * \since GUL version 2.14
+         */
+        TaskId get_id() const noexcept { return id_; }
+
         /**
          * Determine if the task is running, waiting to be started, completed, or has been
-         * canceled.
+         * canceled or has expired.
          *
-         * \exception std::logic_error is thrown if the associated thread pool does not
-         *            exist anymore.
+         * The state is read with a single atomic load from the shared state of the task,
+         * without interacting with the ThreadPool. Tasks that had not been started when
+         * their pool was destroyed are reported as canceled.
          *
-         * \note
-         * If you just need to find out if a task has finished running, prefer
-         * is_complete() over this function. It does not need to interact with the
-         * ThreadPool and is therefore slightly more performant.
+         * \exception std::logic_error is thrown if the handle is not associated with a
+         *            task (e.g. if it was default-constructed).
+         *
+         * \since GUL version 2.14, get_state() does not access the ThreadPool anymore
          */
         TaskState get_state() const
         {
-            const auto state = detail::lock_pool_or_throw(pool_)->get_task_state(id_);
+            if (not control_)
+                throw std::logic_error("Task handle is not associated with a task");
 
-            if (state == InternalTaskState::unknown)
-            {
-                if (is_complete())
-                    return TaskState::complete;
-                else
-                    return TaskState::canceled;
-            }
-            return static_cast<TaskState>(state);
+            return control_->state_.load(std::memory_order_acquire);
         }
 
-    private:
-        std::future<T> future_;
-        TaskId id_{ 0 };
-        std::weak_ptr<ThreadPool> pool_;
-    };
+        /**
+         * Schedule a function to be run on the pool with the result of this task as soon
+         * as the task has completed.
+         *
+         * The continuation is a new task on the same ThreadPool. It does not occupy a
+         * thread while waiting, and it is canceled if this task is canceled. The result
+         * of this task is moved into the continuation: Afterwards, this handle has no
+         * result anymore (get_result() throws and is_complete() returns false), but its
+         * state can still be queried with get_state().
+         *
+         * \param fct   A function object to be called as `fct(result)`, or as `fct()` if
+         *              this task returns void. If this task has thrown an exception, the
+         *              continuation rethrows it instead of calling fct, so that the
+         *              exception propagates to the handle of the continuation.
+         * \param name  Optional name for the continuation task
+         *
+         * \returns a TaskHandle for the continuation.
+         *
+         * \code{.cpp}
+         * auto pool = make_thread_pool(2);
+         * auto n = pool->add_task([]() { return 6; });
+         * auto n_squared = n.then([](int v) { return v * v; });
+         * std::cout << n_squared.get_result() << "\n"; // 36
+         * \endcode
+         *
+         * \exception std::logic_error is thrown if the handle has no result (e.g. because
+         *            the task was canceled or then() has already been called) or if the
+         *            pool does not exist anymore. std::runtime_error is thrown if the
+         *            queue of the pool is full; in this case, the result stays with this
+         *            handle.
+         *
+         * \since GUL version 2.14
+         */
+        template <typename Function>
+        TaskHandle<typename detail::Continuation<Function, T>::Result>
+        then(Function fct, TaskName name = {})
+        {
+            if (not future_.valid())
+                throw std::logic_error("Task handle has no result");
 
+            auto pool = detail::lock_pool_or_throw(pool_);
+            auto dependencies = after(*this);
 
-    using TimePoint = std::chrono::time_point<std::chrono::system_clock>;
-    using Duration = TimePoint::duration;
+            auto continuation = pool->add_task(
+                [f = std::move(fct), fut = future_.duplicate()]() mutable
+                {
+                    return detail::Continuation<Function, T>::call(f, fut);
+                },
+                dependencies, std::move(name));
 
-    /// Default capacity for the task queue.
-    constexpr static std::size_t default_capacity{ 200 };
+            // The result is handed over only once the continuation has been enqueued
+            future_ = detail::TaskFuture<T>{};
 
-    /// Maximum possible capacity for the task queue.
-    constexpr static std::size_t max_capacity{ 10'000'000 };
+            return continuation;
+        }
 
-    /// Maximum possible number of threads
-    constexpr static std::size_t max_threads{ 10'000 };
+    private:
+        friend class CompletionQueue;
+        friend class TaskDependencies;
 
-    /**
-     * Destruct the ThreadPool and join all threads.
-     *
-     * This destructor blocks until all threads have terminated. Work that has not yet
-     * been started in one of the threads gets canceled, but work that has already been
-     * assigned to a thread continues to be executed until it completes.
-     */
-    ~ThreadPool();
+        detail::TaskFuture<T> future_;
+        std::shared_ptr<detail::TaskControlBlock> control_;
+        TaskId id_{ 0 };
+        std::weak_ptr<ThreadPool> pool_;
+    };
 
     /**
-     * Enqueue a task.
-     *
-     * There are multiple overloads of this function for variations of the arguments:
-     *
-     * \param fct   A function object or function pointer to be executed. This function
-     *              can have an arbitrary return type and may either take no arguments
-     *              (`T fct()`) or a reference to the ThreadPool by which it gets
-     *              executed (`T fct(ThreadPool&)`).
-     * \param start_time  Earliest time point at which the task is to be started
-     * \param name  Optional name for the task (mainly for debugging)
+     * A handle for a batch of tasks that has been enqueued with add_tasks().
      *
-     * \returns a TaskHandle that can be used for inquiries about the state of the task
-     *          and to retrieve its return value.
-     * \exception std::runtime_error is thrown if the queue is full.
+     * A BatchHandle represents all tasks of the batch together. It can be used to wait
+     * for their completion and to cancel those that have not been started yet.
      *
      * \code{.cpp}
-     * auto pool = make_thread_pool(2); // Create a pool with 2 threads
-     *
-     * // A simple task that does not interact with the pool
-     * pool->add_task([]() { std::cout << "Task 1\n"; });
-     *
-     * // A task that schedules another task to start two seconds later
-     * pool->add_task(
-     *     [](ThreadPool& pool)
-     *     {
-     *         std::cout << "Task 2\n";
-     *         pool.add_task([]() { std::cout << "Task 3\n"; }, 2s);
-     *     });
-     *
-     * // A task with a name
-     * pool->add_task([]() { std::cout << "Task 4\n"; }, "Task 4");
+     * auto pool = make_thread_pool(4);
+     * std::vector<std::function<void()>> jobs = make_jobs();
+     * auto batch = pool->add_tasks(jobs);
+     * batch.wait();
      * \endcode
      *
-     * \since GUL version 2.12.1, add_task() unconditionally accepts mutable function
-     *        objects
+     * \since GUL version 2.14
      */
-    template <typename Function>
-    TaskHandle<invoke_result_t<Function, ThreadPool&>>
-    add_task(Function fct, TimePoint start_time = {}, std::string name = {})
+    class BatchHandle
     {
-        static_assert(
-            is_invocable<Function, ThreadPool&>::value
-            || is_invocable<Function>::value,
-            "Invalid function signature: Must be T fct() or T fct(ThreadPool&)");
+    public:
+        /**
+         * Default-construct an invalid BatchHandle.
+         *
+         * This constructor creates an invalid BatchHandle which is not associated with
+         * any tasks or with a ThreadPool.
+         */
+        BatchHandle()
+        {}
 
-        using Result = invoke_result_t<Function, ThreadPool&>;
+        /**
+         * Construct a BatchHandle.
+         *
+         * This constructor is not meant to be used directly. Instead, BatchHandles are
+         * returned by the ThreadPool when a batch of tasks is enqueued.
+         */
+        BatchHandle(std::shared_ptr<detail::BatchState> state,
+            std::shared_ptr<ThreadPool> pool)
+            : state_{ std::move(state) }
+            , pool_{ std::move(pool) }
+        {}
 
-        TaskHandle<Result> task_handle = [this, &fct, start_time, &name]()
-            {
-                std::lock_guard<std::mutex> lock(mutex_);
+        /**
+         * Remove all tasks of the batch from the queue that have not been started yet.
+         *
+         * Tasks that are already running are not removed, but their CancellationToken is
+         * set. This call takes constant time, regardless of the size of the batch or of
+         * the queue.
+         *
+         * \returns the number of tasks that were canceled.
+         *
+         * \exception std::logic_error is thrown if the associated thread pool does not
+         *            exist anymore.
+         */
+        std::size_t cancel()
+        {
+            if (not state_)
+                return 0;
+
+            auto pool = detail::lock_pool_or_throw(pool_);
+            return pool->cancel_pending_batch(*state_);
+        }
+
+        /**
+         * Determine how many tasks of the batch have neither finished nor been canceled.
+         */
+        std::size_t count_remaining() const noexcept
+        {
+            if (not state_)
+                return 0;
+            return state_->num_remaining_.load(std::memory_order_acquire);
+        }
+
+        /// Determine whether all tasks of the batch have finished or been canceled.
+        bool is_complete() const noexcept { return count_remaining() == 0; }
+
+        /// Return the number of tasks in the batch.
+        std::size_t size() const noexcept { return state_ ? state_->num_tasks_ : 0; }
+
+        /**
+         * Block until all tasks of the batch have finished or been canceled.
+         *
+         * If any of the tasks has thrown an exception, the first of these exceptions is
+         * rethrown.
+         */
+        void wait() const
+        {
+            if (not state_)
+                return;
 
-                if (is_full_i())
+            std::unique_lock<std::mutex> lock(state_->mutex_);
+            state_->cv_.wait(lock,
+                [this]()
                 {
-                    throw std::runtime_error(cat(
-                        "Cannot add task: Pending queue has reached capacity (",
-                        pending_tasks_.size(), ')'));
-                }
+                    return state_->num_remaining_.load(std::memory_order_acquire) == 0;
+                });
+
+            if (state_->exception_)
+                std::rethrow_exception(state_->exception_);
+        }
+
+    private:
+        std::shared_ptr<detail::BatchState> state_;
+        std::weak_ptr<ThreadPool> pool_;
+    };
 
-                using PackagedTask = std::packaged_task<Result(ThreadPool&)>;
+    /**
+     * A handle for a periodic task that has been enqueued with add_periodic_task().
+     *
+     * The handle refers to the same task for its whole lifetime. It can be used to stop
+     * the periodic task and to query how often it has run.
+     *
+     * \since GUL version 2.14
+     */
+    class PeriodicTaskHandle
+    {
+    public:
+        /**
+         * Default-construct an invalid PeriodicTaskHandle.
+         *
+         * This constructor creates an invalid PeriodicTaskHandle which is not associated
+         * with a task or with a ThreadPool.
+         */
+        PeriodicTaskHandle()
+        {}
 
-                auto named_task_ptr = std::make_unique<NamedTaskImpl<PackagedTask>>(
-                    PackagedTask{ std::move(fct) }, std::move(name));
+        /**
+         * Construct a PeriodicTaskHandle.
+         *
+         * This constructor is not meant to be used directly. Instead, PeriodicTaskHandles
+         * are returned by the ThreadPool when a periodic task is enqueued.
+         */
+        PeriodicTaskHandle(std::shared_ptr<detail::PeriodicControlBlock> control,
+            std::shared_ptr<ThreadPool> pool)
+            : control_{ std::move(control) }
+            , pool_{ std::move(pool) }
+        {}
 
-                TaskHandle<Result> handle{
-                    next_task_id_, named_task_ptr->fct_.get_future(), shared_from_this() };
+        /**
+         * Stop the periodic task.
+         *
+         * If the task is waiting for its next run, it is removed from the queue. If it is
+         * currently running, the current run is completed, but the task is not
+         * rescheduled afterwards (the current run can end early by polling its
+         * CancellationToken). In both cases, the state of the task becomes
+         * TaskState::canceled (after the current run, if any).
+         *
+         * \returns true if the task was stopped by this call, false if it had already
+         *          been stopped before.
+         *
+         * \exception std::logic_error is thrown if the associated thread pool does not
+         *            exist anymore.
+         */
+        bool cancel()
+        {
+            if (not control_)
+                return false;
 
-                pending_tasks_.emplace_back(
-                    next_task_id_, std::move(named_task_ptr), start_time);
+            auto pool = detail::lock_pool_or_throw(pool_);
+            if (control_->stop_requested_.exchange(true))
+                return false;
 
-                ++next_task_id_;
+            pool->cancel_pending_task(*control_);
+            return true;
+        }
 
-                return handle;
-            }();
+        /// Return the number of runs of the task that have been completed.
+        std::size_t count_runs() const noexcept
+        {
+            return control_ ? control_->num_runs_.load(std::memory_order_acquire) : 0;
+        }
 
-        cv_.notify_one();
+        /**
+         * Determine if the task is running, waiting for its next run, or has been
+         * stopped (TaskState::canceled). A periodic task never reaches the state
+         * TaskState::complete.
+         *
+         * \exception std::logic_error is thrown if the handle is not associated with a
+         *            task (e.g. if it was default-constructed).
+         */
+        TaskState get_state() const
+        {
+            if (not control_)
+                throw std::logic_error("Task handle is not associated with a task");
 
-        return task_handle;
-    }
+            return control_->state_.load(std::memory_order_acquire);
+        }
 
-    template <typename Function,
-        std::enable_if_t<is_invocable<Function>::value, bool> = true>
-    TaskHandle<invoke_result_t<Function>>
-    add_task(Function fct, TimePoint start_time = {}, std::string name = {})
-    {
-        return add_task(
-            [f = std::move(fct)](ThreadPool&) mutable { return f(); },
-            start_time, std::move(name));
-    }
+    private:
+        std::shared_ptr<detail::PeriodicControlBlock> control_;
+        std::weak_ptr<ThreadPool> pool_;
+    };
 
-    template <typename Function,
-        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
-    TaskHandle<invoke_result_t<Function, ThreadPool&>>
-    add_task(Function fct, Duration delay_before_start, std::string name = {})
+    /**
+     * A strand of tasks that are executed one after another, in the order in which they
+     * were added.
+     *
+     * Tasks that are added to the same strand with add_task(fct, strand) never run
+     * concurrently, and each of them starts only after its predecessor in the strand has
+     * finished (or has been canceled). Tasks of different strands and tasks without a
+     * strand are executed in parallel as usual. This allows serializing the work on a
+     * shared resource, such as a connection or a device, without a mutex:
+     *
+     * \code{.cpp}
+     * auto pool = make_thread_pool(4);
+     * auto device_strand = pool->make_strand();
+     * pool->add_task([&]() { device.configure(); }, device_strand);
+     * pool->add_task([&]() { device.start(); }, device_strand); // after configure()
+     * \endcode
+     *
+     * At most one task of a strand is in the queue of the pool or running at any time.
+     * The others wait in the strand, so no worker thread is blocked by waiting for a
+     * predecessor. Strand objects are cheap handles: All copies of a Strand refer to the
+     * same sequence of tasks.
+     *
+     * \since GUL version 2.14
+     */
+    class Strand
     {
-        return add_task(std::move(fct),
-            std::chrono::system_clock::now() + delay_before_start, std::move(name));
-    }
+    public:
+        /**
+         * Default-construct an invalid Strand.
+         *
+         * This constructor creates a Strand which is not associated with a ThreadPool.
+         * Use ThreadPool::make_strand() to create a usable one.
+         */
+        Strand()
+        {}
 
-    template <typename Function,
-        std::enable_if_t<is_invocable<Function>::value, bool> = true>
-    TaskHandle<invoke_result_t<Function>>
-    add_task(Function fct, Duration delay_before_start, std::string name = {})
-    {
-        return add_task(std::move(fct),
-            std::chrono::system_clock::now() + delay_before_start, std::move(name));
-    }
+    private:
+        friend class ThreadPool;
 
-    template <typename Function,
-        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
-    TaskHandle<invoke_result_t<Function, ThreadPool&>>
-    add_task(Function fct, std::string name)
-    {
-        return add_task(std::move(fct), TimePoint{}, std::move(name));
-    }
+        struct State; // Defined in ThreadPool.cc
 
-    template <typename Function,
-        std::enable_if_t<is_invocable<Function>::value, bool> = true>
-    TaskHandle<invoke_result_t<Function>>
-    add_task(Function fct, std::string name)
+        Strand(std::shared_ptr<State> state, std::shared_ptr<ThreadPool> pool)
+            : state_{ std::move(state) }
+            , pool_{ std::move(pool) }
+        {}
+
+        std::shared_ptr<State> state_;
+        std::weak_ptr<ThreadPool> pool_;
+    };
+
+    /**
+     * A group of tasks that can be waited for and canceled together.
+     *
+     * Tasks join a group when they are added with add_task(fct, group), and they leave it
+     * as soon as they have finished (i.e. completed, been canceled, or expired). This
+     * allows treating all tasks that belong to one logical request as a unit without
+     * keeping their handles around:
+     *
+     * \code{.cpp}
+     * auto pool = make_thread_pool(4);
+     * auto request = pool->make_task_group();
+     * for (const auto& part : parts)
+     *     pool->add_task([&part]() { process(part); }, request);
+     *
+     * if (client_disconnected)
+     *     request.cancel(); // Cancels the pending tasks of this request only
+     * request.wait_all();
+     * \endcode
+     *
+     * Joining and leaving a group takes constant time. wait_all() blocks once on the
+     * group instead of on the individual tasks, and cancel() visits only the unfinished
+     * tasks of the group, regardless of the number of other tasks in the pool. TaskGroup
+     * objects are cheap handles: All copies of a TaskGroup refer to the same group.
+     *
+     * \since GUL version 2.14
+     */
+    class TaskGroup
+    {
+    public:
+        /**
+         * Default-construct an invalid TaskGroup.
+         *
+         * This constructor creates a TaskGroup which is not associated with a ThreadPool.
+         * Use ThreadPool::make_task_group() to create a usable one.
+         */
+        TaskGroup()
+        {}
+
+        /**
+         * Cancel the tasks of the group that have not been started yet.
+         *
+         * Pending tasks are canceled just like with TaskHandle::cancel(). Tasks of the
+         * group that are already running are not interrupted, but their
+         * CancellationToken is set. Tasks that are being added to the group by another
+         * thread at the same time are canceled as soon as they have been enqueued.
+         *
+         * \returns the number of pending tasks that were canceled (not counting those
+         *          that were still being added).
+         *
+         * \exception std::logic_error is thrown if the associated thread pool does not
+         *            exist anymore.
+         */
+        GUL_EXPORT
+        std::size_t cancel();
+
+        /// Return the number of tasks in the group that have not finished yet.
+        GUL_EXPORT
+        std::size_t count_unfinished() const noexcept;
+
+        /**
+         * Block until all tasks of the group have finished (i.e. completed, been
+         * canceled, or expired).
+         *
+         * Exceptions thrown by the tasks are not rethrown here; they can be retrieved
+         * from the individual TaskHandles. wait_all() must not be called from a task of
+         * the group itself.
+         */
+        GUL_EXPORT
+        void wait_all() const;
+
+    private:
+        friend class ThreadPool;
+
+        struct Member; // Defined in ThreadPool.cc
+        struct State; // Defined in ThreadPool.cc
+
+        TaskGroup(std::shared_ptr<State> state, std::shared_ptr<ThreadPool> pool)
+            : state_{ std::move(state) }
+            , pool_{ std::move(pool) }
+        {}
+
+        std::shared_ptr<State> state_;
+        std::weak_ptr<ThreadPool> pool_;
+    };
+
+    /**
+     * A token through which a running task can find out whether it should stop early.
+     *
+     * A task obtains its token with get_cancellation_token(). The token is set when
+     * the handle of the task is used to cancel it while it is running
+     * (TaskHandle::cancel(), BatchHandle::cancel(), or PeriodicTaskHandle::cancel()).
+     * Polling the token costs a single atomic load and does not lock the pool, so that
+     * long-running tasks can check it frequently:
+     *
+     * \code{.cpp}
+     * auto pool = make_thread_pool(2);
+     * auto task = pool->add_task([](ThreadPool& p)
+     *     {
+     *         const auto token = p.get_cancellation_token();
+     *         for (auto& item : items)
+     *         {
+     *             if (token.is_cancellation_requested())
+     *                 return false;
+     *             scan(item);
+     *         }
+     *         return true;
+     *     });
+     * task.cancel(); // Removes the task from the queue or makes the scan stop early
+     * \endcode
+     *
+     * Cancellation is cooperative: A task that does not poll its token runs to
+     * completion as before. Tokens of detached tasks are never set.
+     *
+     * \since GUL version 2.14
+     */
+    class CancellationToken
+    {
+    public:
+        /// Default-construct a token that is never set.
+        CancellationToken()
+        {}
+
+        /// Determine whether the task has been requested to stop.
+        bool is_cancellation_requested() const noexcept
+        {
+            return flag_ && flag_->load(std::memory_order_acquire);
+        }
+
+    private:
+        friend class ThreadPool;
+
+        explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> flag)
+            : flag_{ std::move(flag) }
+        {}
+
+        std::shared_ptr<const std::atomic<bool>> flag_;
+    };
+
+    /**
+     * The latest time at which a task may be started (see add_task(Function, Deadline,
+     * TaskName)).
+     *
+     * A deadline can be given as a point in time on the system clock or on the steady
+     * clock, or as a timeout from now. Like start times, it is tracked on the steady
+     * clock.
+     *
+     * \since GUL version 2.14
+     */
+    struct Deadline
+    {
+        /// Construct a deadline at the given point in time on the steady clock.
+        explicit Deadline(std::chrono::steady_clock::time_point t) noexcept
+            : time_point{ t }
+        {}
+
+        /// Construct a deadline at the given point in time on the system clock.
+        explicit Deadline(std::chrono::system_clock::time_point t)
+            : time_point{ to_steady_time(t) }
+        {}
+
+        /// Construct a deadline that lies the given timeout after the current time.
+        explicit Deadline(std::chrono::system_clock::duration timeout)
+            : time_point{ get_steady_time_after(timeout) }
+        {}
+
+        /// The deadline on the steady clock
+        std::chrono::steady_clock::time_point time_point;
+    };
+
+
+    using TimePoint = std::chrono::time_point<std::chrono::system_clock>;
+    using Duration = TimePoint::duration;
+
+    /**
+     * A time point on the monotonic clock that the pool uses internally for scheduling.
+     * \since GUL version 2.14
+     */
+    using SteadyTimePoint = std::chrono::steady_clock::time_point;
+
+    /// Default capacity for the task queue.
+    constexpr static std::size_t default_capacity{ 200 };
+
+    /// Maximum possible capacity for the task queue.
+    constexpr static std::size_t max_capacity{ 10'000'000 };
+
+    /// Maximum possible number of threads
+    constexpr static std::size_t max_threads{ 10'000 };
+
+    /**
+     * Destruct the ThreadPool and join all threads.
+     *
+     * This destructor blocks until all threads have terminated. Work that has not yet
+     * been started in one of the threads gets canceled, but work that has already been
+     * assigned to a thread continues to be executed until it completes.
+     */
+    ~ThreadPool();
+
+    /**
+     * Enqueue a task.
+     *
+     * There are multiple overloads of this function for variations of the arguments:
+     *
+     * \param fct   A function object or function pointer to be executed. This function
+     *              can have an arbitrary return type and may either take no arguments
+     *              (`T fct()`) or a reference to the ThreadPool by which it gets
+     *              executed (`T fct(ThreadPool&)`).
+     * \param start_time  Earliest time point at which the task is to be started
+     * \param name  Optional name for the task (mainly for debugging)
+     *
+     * \returns a TaskHandle that can be used for inquiries about the state of the task
+     *          and to retrieve its return value.
+     * \exception std::runtime_error is thrown if the queue is full.
+     *
+     * \code{.cpp}
+     * auto pool = make_thread_pool(2); // Create a pool with 2 threads
+     *
+     * // A simple task that does not interact with the pool
+     * pool->add_task([]() { std::cout << "Task 1\n"; });
+     *
+     * // A task that schedules another task to start two seconds later
+     * pool->add_task(
+     *     [](ThreadPool& pool)
+     *     {
+     *         std::cout << "Task 2\n";
+     *         pool.add_task([]() { std::cout << "Task 3\n"; }, 2s);
+     *     });
+     *
+     * // A task with a name
+     * pool->add_task([]() { std::cout << "Task 4\n"; }, "Task 4");
+     * \endcode
+     *
+     * Internally, all start times are converted to the monotonic steady clock when the
+     * task is enqueued. Delayed tasks therefore do not start early or late if the system
+     * clock is adjusted afterwards. Start times can also be given directly as a
+     * SteadyTimePoint, and delays (Duration) are always measured on the steady clock.
+     *
+     * \since GUL version 2.12.1, add_task() unconditionally accepts mutable function
+     *        objects
+     * \since GUL version 2.14, start times are tracked on the steady clock and can be
+     *        given as a SteadyTimePoint
+     */
+    template <typename Function>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task(Function fct, TimePoint start_time = {}, TaskName name = {})
+    {
+        static_assert(
+            is_invocable<Function, ThreadPool&>::value
+            || is_invocable<Function>::value,
+            "Invalid function signature: Must be T fct() or T fct(ThreadPool&)");
+
+        return add_task_impl(std::move(fct), std::move(name),
+            SubmitOptions{ to_steady_time(start_time) });
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function>>
+    add_task(Function fct, TimePoint start_time = {}, TaskName name = {})
+    {
+        return add_task(
+            [f = std::move(fct)](ThreadPool&) mutable { return f(); },
+            start_time, std::move(name));
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task(Function fct, SteadyTimePoint start_time, TaskName name = {})
+    {
+        return add_task_impl(std::move(fct), std::move(name),
+            SubmitOptions{ start_time });
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function>>
+    add_task(Function fct, SteadyTimePoint start_time, TaskName name = {})
+    {
+        return add_task(
+            [f = std::move(fct)](ThreadPool&) mutable { return f(); },
+            start_time, std::move(name));
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task(Function fct, Duration delay_before_start, TaskName name = {})
+    {
+        return add_task(std::move(fct), get_steady_time_after(delay_before_start),
+            std::move(name));
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function>>
+    add_task(Function fct, Duration delay_before_start, TaskName name = {})
+    {
+        return add_task(std::move(fct), get_steady_time_after(delay_before_start),
+            std::move(name));
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task(Function fct, TaskName name)
+    {
+        return add_task(std::move(fct), TimePoint{}, std::move(name));
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function>>
+    add_task(Function fct, TaskName name)
+    {
+        return add_task(std::move(fct), TimePoint{}, std::move(name));
+    }
+
+    /**
+     * Enqueue a task that is started only after other tasks have finished.
+     *
+     * The task does not enter the queue before all of its predecessors have been
+     * completed (successfully or by throwing an exception). No thread is blocked while
+     * waiting for them. If any of the predecessors gets canceled (or expires), the task
+     * is canceled as well. This allows expressing a graph of tasks without the risk of
+     * deadlocks:
+     *
+     * \code{.cpp}
+     * auto decode = pool->add_task([&]() { frame = decode_frame(); });
+     * auto t1 = pool->add_task([&]() { transform_1(frame); }, after(decode));
+     * auto t2 = pool->add_task([&]() { transform_2(frame); }, after(decode));
+     * auto merge = pool->add_task([&]() { merge_results(); }, after(t1, t2));
+     * \endcode
+     *
+     * While it waits for its predecessors, the task is counted as pending (e.g. by
+     * count_pending() and for the capacity limit) and can be canceled via its
+     * TaskHandle, but it does not show up in get_pending_task_names().
+     *
+     * \param fct   A function object or function pointer to be executed. This function
+     *              can have an arbitrary return type and may either take no arguments
+     *              (`T fct()`) or a reference to the ThreadPool by which it gets
+     *              executed (`T fct(ThreadPool&)`).
+     * \param dependencies  The tasks that have to finish before this one can start,
+     *              usually created with after()
+     * \param name  Optional name for the task (mainly for debugging)
+     *
+     * \returns a TaskHandle that can be used for inquiries about the state of the task
+     *          and to retrieve its return value.
+     * \exception std::runtime_error is thrown if the queue is full.
+     *            std::invalid_argument is thrown if one of the predecessors belongs to
+     *            another thread pool or if a TaskHandle is not associated with a task.
+     *
+     * \since GUL version 2.14
+     */
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task(Function fct, const TaskDependencies& dependencies, TaskName name = {})
+    {
+        SubmitOptions options;
+        options.dependencies = &dependencies;
+        return add_task_impl(std::move(fct), std::move(name), options);
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function>>
+    add_task(Function fct, const TaskDependencies& dependencies, TaskName name = {})
+    {
+        return add_task(
+            [f = std::move(fct)](ThreadPool&) mutable { return f(); },
+            dependencies, std::move(name));
+    }
+
+    /**
+     * Enqueue a task on a strand.
+     *
+     * The task is started after all tasks that have previously been added to the same
+     * strand have finished or have been canceled, and it never runs concurrently with
+     * them (see Strand). Until then, it waits in the strand without occupying a worker.
+     *
+     * \param fct     A function object or function pointer to be executed (see
+     *                add_task())
+     * \param strand  A strand created by make_strand() on this pool
+     * \param name    Optional name for the task (mainly for debugging)
+     *
+     * \returns a TaskHandle for the task.
+     * \exception std::runtime_error is thrown if the queue is full.
+     *            std::invalid_argument is thrown if the strand is not associated with
+     *            this pool.
+     *
+     * \since GUL version 2.14
+     */
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task(Function fct, const Strand& strand, TaskName name = {})
+    {
+        SubmitOptions options;
+        options.strand = &strand;
+        return add_task_impl(std::move(fct), std::move(name), options);
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function>>
+    add_task(Function fct, const Strand& strand, TaskName name = {})
+    {
+        return add_task(
+            [f = std::move(fct)](ThreadPool&) mutable { return f(); },
+            strand, std::move(name));
+    }
+
+    /**
+     * Enqueue a task as a member of a task group.
+     *
+     * The task belongs to the group until it has finished, so that it can be waited for
+     * and canceled together with the other tasks of the group (see TaskGroup).
+     *
+     * \param fct    A function object or function pointer to be executed (see
+     *               add_task())
+     * \param group  A task group created by make_task_group() on this pool
+     * \param name   Optional name for the task (mainly for debugging)
+     *
+     * \returns a TaskHandle for the task.
+     * \exception std::runtime_error is thrown if the queue is full.
+     *            std::invalid_argument is thrown if the task group is not associated
+     *            with this pool.
+     *
+     * \since GUL version 2.14
+     */
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task(Function fct, const TaskGroup& group, TaskName name = {})
+    {
+        SubmitOptions options;
+        options.task_group = &group;
+        return add_task_impl(std::move(fct), std::move(name), options);
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function>>
+    add_task(Function fct, const TaskGroup& group, TaskName name = {})
+    {
+        return add_task(
+            [f = std::move(fct)](ThreadPool&) mutable { return f(); },
+            group, std::move(name));
+    }
+
+    /**
+     * Enqueue a task that must be started before a deadline.
+     *
+     * If a worker takes the task from the queue after its deadline has passed, the
+     * function is not called. Instead, the task is completed as expired: Its state
+     * becomes TaskState::expired, get_result() throws, and tasks depending on it are
+     * canceled. Under overload, the pool thereby sheds work whose result nobody waits
+     * for anymore instead of falling further behind.
+     *
+     * \code{.cpp}
+     * auto reply = pool->add_task([&]() { return handle(request); },
+     *     ThreadPool::Deadline{ 200ms });
+     * \endcode
+     *
+     * By default, tasks with a deadline are started in the same order as all other
+     * tasks. With ThreadPoolOptions::earliest_deadline_first, they are started in the
+     * order of their deadlines instead.
+     *
+     * \param fct       A function object or function pointer to be executed (see
+     *                  add_task())
+     * \param deadline  The latest time at which the task may be started
+     * \param name      Optional name for the task (mainly for debugging)
+     *
+     * \returns a TaskHandle for the task.
+     * \exception std::runtime_error is thrown if the queue is full.
+     *
+     * \since GUL version 2.14
+     */
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task(Function fct, Deadline deadline, TaskName name = {})
+    {
+        SubmitOptions options;
+        options.deadline = deadline.time_point;
+        return add_task_impl(std::move(fct), std::move(name), options);
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function>>
+    add_task(Function fct, Deadline deadline, TaskName name = {})
+    {
+        return add_task(
+            [f = std::move(fct)](ThreadPool&) mutable { return f(); },
+            deadline, std::move(name));
+    }
+
+    /**
+     * Enqueue a task, waiting for room in the queue if it is full.
+     *
+     * Where add_task() throws an exception if the queue is at capacity, this function
+     * blocks the calling thread until a pending task leaves the queue (because it is
+     * started or canceled). The caller sleeps on a condition variable instead of polling,
+     * so producers that outpace the workers are throttled without burning CPU time.
+     * Waiting producers are served in no particular order.
+     *
+     * The variant with a timeout gives up after the specified time. The function object
+     * is then discarded without being executed.
+     *
+     * Calling this function from within a task of the same pool can lead to a deadlock
+     * if all workers end up waiting for room in the queue.
+     *
+     * \param fct      A function object or function pointer to be executed (see
+     *                 add_task())
+     * \param timeout  Maximum time to wait for room in the queue
+     * \param name     Optional name for the task (mainly for debugging)
+     *
+     * \returns a TaskHandle for the task. The variant with a timeout returns an optional
+     *          TaskHandle that is empty if the queue did not have room in time.
+     *
+     * \see try_add_task() for a variant that does not wait at all
+     *
+     * \since GUL version 2.14
+     */
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task_blocking(Function fct, TaskName name = {})
+    {
+        return *try_add_task_impl(std::move(fct), std::move(name),
+            SteadyTimePoint::max());
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function>>
+    add_task_blocking(Function fct, TaskName name = {})
+    {
+        return add_task_blocking(
+            [f = std::move(fct)](ThreadPool&) mutable { return f(); }, std::move(name));
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    optional<TaskHandle<invoke_result_t<Function, ThreadPool&>>>
+    add_task_blocking(Function fct, Duration timeout, TaskName name = {})
+    {
+        return try_add_task_impl(std::move(fct), std::move(name),
+            get_steady_time_after(timeout));
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    optional<TaskHandle<invoke_result_t<Function>>>
+    add_task_blocking(Function fct, Duration timeout, TaskName name = {})
+    {
+        return add_task_blocking(
+            [f = std::move(fct)](ThreadPool&) mutable { return f(); }, timeout,
+            std::move(name));
+    }
+
+    /**
+     * Enqueue a task if there is room in the queue.
+     *
+     * This is a non-throwing variant of add_task(): If the queue is at capacity, the
+     * function object is discarded and an empty optional is returned immediately.
+     *
+     * \param fct   A function object or function pointer to be executed (see add_task())
+     * \param name  Optional name for the task (mainly for debugging)
+     *
+     * \returns a TaskHandle for the task, or an empty optional if the queue is full.
+     *
+     * \see add_task_blocking() for a variant that waits for room in the queue
+     *
+     * \since GUL version 2.14
+     */
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    optional<TaskHandle<invoke_result_t<Function, ThreadPool&>>>
+    try_add_task(Function fct, TaskName name = {})
+    {
+        return try_add_task_impl(std::move(fct), std::move(name), SteadyTimePoint{});
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    optional<TaskHandle<invoke_result_t<Function>>>
+    try_add_task(Function fct, TaskName name = {})
+    {
+        return try_add_task(
+            [f = std::move(fct)](ThreadPool&) mutable { return f(); }, std::move(name));
+    }
+
+    /**
+     * Enqueue a batch of tasks.
+     *
+     * All tasks of the batch are added to the queue at once: Room for them is reserved
+     * in a single step, the queue is locked only once, and as many sleeping workers are
+     * woken up as there are tasks (or threads). Instead of one TaskHandle per task, a
+     * single BatchHandle is returned for the whole batch. The results of the functions
+     * are discarded, and the first exception thrown by one of them can be retrieved via
+     * BatchHandle::wait().
+     *
+     * \param first, last  A range of function objects or function pointers to be
+     *              executed. They are copied into the queue. Each of them may either take
+     *              no arguments (`T fct()`) or a reference to the ThreadPool by which it
+     *              gets executed (`T fct(ThreadPool&)`).
+     * \param name  Optional name for all tasks of the batch (mainly for debugging)
+     *
+     * \returns a BatchHandle for waiting on or canceling the tasks.
+     * \exception std::runtime_error is thrown if the queue does not have enough room for
+     *            all tasks. In this case, none of them is added.
+     *
+     * \code{.cpp}
+     * std::vector<std::function<void()>> jobs;
+     * for (int i = 0; i != 10000; ++i)
+     *     jobs.push_back([i]() { process(i); });
+     * auto batch = pool->add_tasks(jobs);
+     * \endcode
+     *
+     * \since GUL version 2.14
+     */
+    template <typename Iterator>
+    BatchHandle add_tasks(Iterator first, Iterator last, TaskName name = {})
+    {
+        using Function = std::decay_t<decltype(*first)>;
+
+        static_assert(
+            is_invocable<Function, ThreadPool&>::value
+            || is_invocable<Function>::value,
+            "Invalid function signature: Must be T fct() or T fct(ThreadPool&)");
+
+        const auto num_tasks = static_cast<std::size_t>(std::distance(first, last));
+        auto batch = std::make_shared<detail::BatchState>(num_tasks);
+
+        std::vector<Task> tasks;
+        tasks.reserve(num_tasks);
+
+        for (; first != last; ++first)
+        {
+            tasks.emplace_back(TaskId{ 0 },
+                TaskFunction{
+                    [f = Function(*first), b = batch.get()](ThreadPool& pool) mutable
+                    {
+                        try
+                        {
+                            call_task_function(f, pool,
+                                is_invocable<Function, ThreadPool&>{});
+                        }
+                        catch (...)
+                        {
+                            b->set_exception(std::current_exception());
+                        }
+                        b->finish(1);
+                    } },
+                nullptr, SteadyTimePoint{}, name, batch);
+        }
+
+        enqueue_tasks(tasks);
+
+        return BatchHandle{ std::move(batch), shared_from_this() };
+    }
+
+    template <typename Range,
+        typename = decltype(std::begin(std::declval<const Range&>()))>
+    BatchHandle add_tasks(const Range& range, TaskName name = {})
+    {
+        return add_tasks(std::begin(range), std::end(range), std::move(name));
+    }
+
+    /**
+     * Enqueue a task whose result is not needed.
+     *
+     * This is a leaner variant of add_task() for "fire and forget" work: No TaskHandle is
+     * created, the return value of the function is discarded, and exceptions thrown by
+     * it are silently ignored. If the function object fits into the small inline buffer
+     * of the task queue, adding the task does not allocate any memory from the heap in
+     * steady state. Detached tasks can only be canceled via cancel_pending_tasks().
+     *
+     * \param fct   A function object or function pointer to be executed. It may either
+     *              take no arguments (`void fct()`) or a reference to the ThreadPool by
+     *              which it gets executed (`void fct(ThreadPool&)`).
+     * \param start_time  Earliest time point at which the task is to be started
+     *
+     * \exception std::runtime_error is thrown if the queue is full.
+     *
+     * \since GUL version 2.14
+     */
+    template <typename Function>
+    void add_detached_task(Function fct, SteadyTimePoint start_time)
+    {
+        static_assert(
+            is_invocable<Function, ThreadPool&>::value
+            || is_invocable<Function>::value,
+            "Invalid function signature: Must be T fct() or T fct(ThreadPool&)");
+
+        enqueue_task(
+            make_task_function(std::move(fct), is_invocable<Function, ThreadPool&>{}),
+            nullptr, TaskName{}, SubmitOptions{ start_time });
+    }
+
+    template <typename Function>
+    void add_detached_task(Function fct, TimePoint start_time = {})
+    {
+        add_detached_task(std::move(fct), to_steady_time(start_time));
+    }
+
+    template <typename Function>
+    void add_detached_task(Function fct, Duration delay_before_start)
+    {
+        add_detached_task(std::move(fct), get_steady_time_after(delay_before_start));
+    }
+
+    /**
+     * Enqueue a task that is run repeatedly with the given period.
+     *
+     * A periodic task is a single task object that is put back into the queue after each
+     * run, with a new start time determined by the options:
+     * - In fixed-rate mode (the default), run n is scheduled at
+     *   `first_start + n * period`, so the interval does not drift with the execution
+     *   time of the function or with delays in starting it. If a run takes longer than
+     *   one period, the missed start times are skipped by default (see
+     *   PeriodicTaskOptions::skip_missed_ticks).
+     * - In fixed-delay mode, each run is scheduled one period after the end of the
+     *   previous one.
+     *
+     * Runs of the same periodic task never overlap. No memory is allocated for
+     * rescheduling the task, and the returned handle stays valid for the whole lifetime
+     * of the task. The task is only stopped by PeriodicTaskHandle::cancel(), by the
+     * destruction of the pool, or by cancel_pending_tasks() while it is waiting for its
+     * next run.
+     *
+     * \code{.cpp}
+     * auto pool = make_thread_pool(2);
+     * auto heartbeat = pool->add_periodic_task(
+     *     []() { std::cout << "tick\n"; }, std::chrono::seconds{ 1 });
+     * // ...
+     * heartbeat.cancel();
+     * \endcode
+     *
+     * \param fct      A function object or function pointer to be executed. It may either
+     *                 take no arguments (`void fct()`) or a reference to the ThreadPool
+     *                 by which it gets executed (`void fct(ThreadPool&)`). Its return
+     *                 value is discarded, and exceptions thrown by it are ignored.
+     * \param period   Time between two runs (must be positive)
+     * \param options  Options for scheduling the runs
+     * \param name     An optional name for the task (shown in get_pending_task_names()
+     *                 and get_running_task_names())
+     *
+     * \returns a PeriodicTaskHandle for the task.
+     *
+     * \exception std::invalid_argument is thrown if the period is not positive.
+     *            std::runtime_error is thrown if the queue is full. Once the task has
+     *            been added, rescheduling it does not count against the capacity.
+     *
+     * \since GUL version 2.14
+     */
+    template <typename Function>
+    PeriodicTaskHandle add_periodic_task(Function fct, Duration period,
+        PeriodicTaskOptions options = {}, TaskName name = {})
+    {
+        static_assert(
+            is_invocable<Function, ThreadPool&>::value
+            || is_invocable<Function>::value,
+            "Invalid function signature: Must be T fct() or T fct(ThreadPool&)");
+
+        if (period <= Duration::zero())
+            throw std::invalid_argument("Period of a periodic task must be positive");
+
+        auto control = std::make_shared<detail::PeriodicControlBlock>(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(period),
+            options.mode, options.skip_missed_ticks);
+
+        enqueue_periodic_task(
+            make_task_function(std::move(fct), is_invocable<Function, ThreadPool&>{}),
+            control, std::chrono::steady_clock::now() + options.initial_delay,
+            std::move(name));
+
+        return PeriodicTaskHandle{ std::move(control), shared_from_this() };
+    }
+
+    template <typename Function>
+    PeriodicTaskHandle add_periodic_task(Function fct, Duration period, TaskName name)
+    {
+        return add_periodic_task(std::move(fct), period, PeriodicTaskOptions{},
+            std::move(name));
+    }
+
+    /**
+     * Enqueue a task that may only be executed by the worker threads of a specific
+     * worker group.
+     *
+     * Worker groups are defined at construction time by the CPU sets to which the
+     * workers are pinned (see ThreadPoolOptions::cpu_sets and
+     * ThreadPoolOptions::numa_groups). This allows, for instance, to run a task on the
+     * NUMA node that holds the data it works on. Apart from the restriction to the
+     * worker group, the task behaves like one that was added with add_task(). Workers
+     * prefer tasks for their own worker group over other tasks. Worker groups are
+     * unrelated to a TaskGroup, which is a set of tasks.
+     *
+     * \param worker_group  Index of the worker group in the range
+     *                      [0, count_worker_groups())
+     * \param fct           A function object or function pointer to be executed (see
+     *                      add_task())
+     * \param name          An optional name for the task
+     *
+     * \returns a TaskHandle for the task.
+     *
+     * \exception std::out_of_range is thrown if the worker group index is invalid.
+     *            std::runtime_error is thrown if the queue is full.
+     *
+     * \since GUL version 2.14
+     */
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function, ThreadPool&>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task_to_worker_group(std::size_t worker_group, Function fct, TaskName name = {})
+    {
+        if (worker_group >= count_worker_groups())
+        {
+            throw std::out_of_range(cat("Invalid worker group ", worker_group,
+                " (pool has ", count_worker_groups(), " worker groups)"));
+        }
+
+        SubmitOptions options;
+        options.worker_group = worker_group;
+        return add_task_impl(std::move(fct), std::move(name), options);
+    }
+
+    template <typename Function,
+        std::enable_if_t<is_invocable<Function>::value, bool> = true>
+    TaskHandle<invoke_result_t<Function>>
+    add_task_to_worker_group(std::size_t worker_group, Function fct, TaskName name = {})
+    {
+        return add_task_to_worker_group(worker_group,
+            [f = std::move(fct)](ThreadPool&) mutable { return f(); }, std::move(name));
+    }
+
+    /**
+     * Remove all pending tasks from the queue.
+     *
+     * This call removes all tasks that have not yet been started from the queue. It has
+     * no impact on tasks that are currently being executed.
+     *
+     * \returns the number of tasks that were removed.
+     */
+    GUL_EXPORT
+    std::size_t cancel_pending_tasks();
+
+    /// Return the maximum number of pending tasks that can be queued.
+    GUL_EXPORT
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    /// Return the number of pending tasks.
+    GUL_EXPORT
+    std::size_t count_pending() const;
+
+    /**
+     * Return the number of threads in the pool.
+     *
+     * For an elastic pool, this is the current target number of threads. Threads that
+     * are being retired may still finish the task they are running.
+     */
+    GUL_EXPORT
+    std::size_t count_threads() const noexcept;
+
+    /**
+     * Return the number of worker groups in the pool (see add_task_to_worker_group()).
+     *
+     * A pool without CPU sets has a single worker group that contains all workers.
+     *
+     * \since GUL version 2.14
+     */
+    GUL_EXPORT
+    std::size_t count_worker_groups() const noexcept;
+
+    /**
+     * Return the cancellation token of the task that is running on the current thread.
+     *
+     * This function is meant to be called from within a task (via the ThreadPool&
+     * argument). The token stays valid for the lifetime of the task.
+     *
+     * \exception std::runtime_error is thrown if the current thread is not executing a
+     *            task of this pool.
+     *
+     * \since GUL version 2.14
+     */
+    GUL_EXPORT
+    CancellationToken get_cancellation_token() const;
+
+    /// Return a vector with the names of the tasks that are waiting to be executed.
+    GUL_EXPORT
+    std::vector<std::string> get_pending_task_names() const;
+
+    /// Return a vector with the names of the tasks that are currently running.
+    GUL_EXPORT
+    std::vector<std::string> get_running_task_names() const;
+
+    /**
+     * Return a snapshot of the runtime statistics of the pool.
+     *
+     * The counters are maintained by the workers without locking and at the cost of a
+     * few plain memory operations per task. Queue waiting times, execution times, and
+     * the busy and idle times of the workers are only measured if
+     * ThreadPoolOptions::measure_task_times is set, because this requires reading the
+     * clock. Taking the snapshot does not lock the pool.
+     *
+     * \since GUL version 2.14
+     */
+    GUL_EXPORT
+    ThreadPoolStatistics get_statistics() const;
+
+    /**
+     * Return the recorded task executions as a trace in the Chrome trace event format.
+     *
+     * If ThreadPoolOptions::trace_buffer_size is nonzero, each worker records the name,
+     * start time and end time of the task executions it performs in a ring buffer of that
+     * size. This function returns the contents of all buffers as a JSON document that
+     * can be loaded into chrome://tracing or the Perfetto UI, showing one timeline per
+     * worker thread. Timestamps are given in microseconds on the steady clock. Gaps in a
+     * timeline are times in which the worker was idle.
+     *
+     * \returns a JSON string. If tracing is disabled, the list of events is empty.
+     *
+     * \since GUL version 2.14
+     */
+    GUL_EXPORT
+    std::string get_trace_json() const;
+
+    /**
+     * Return the thread pool ID of the current thread.
+     *
+     * \returns a thread ID in the range [0, count_threads()).
+     *
+     * \exception std::runtime_error is thrown if this function is called from a thread
+     *            that is not part of the pool.
+     *
+     * \see get_thread_cpu_set() and get_thread_worker_group() for the placement of the
+     *      thread
+     *
+     * \since GUL version 2.13
+     */
+    GUL_EXPORT
+    ThreadId get_thread_id() const;
+
+    /**
+     * Return the CPU cores to which a worker thread is pinned.
+     *
+     * \param thread_id  ID of the worker thread in the range [0, count_threads())
+     *
+     * \returns a sorted list of CPU indices, or an empty vector if the thread is not
+     *          pinned.
+     *
+     * \exception std::out_of_range is thrown if the thread ID is invalid.
+     *
+     * \since GUL version 2.14
+     */
+    GUL_EXPORT
+    std::vector<unsigned int> get_thread_cpu_set(ThreadId thread_id) const;
+
+    /**
+     * Return the index of the worker group to which a worker thread belongs.
+     *
+     * \param thread_id  ID of the worker thread in the range [0, count_threads())
+     *
+     * \returns a worker group index in the range [0, count_worker_groups()).
+     *
+     * \exception std::out_of_range is thrown if the thread ID is invalid.
+     *
+     * \since GUL version 2.14
+     */
+    GUL_EXPORT
+    std::size_t get_thread_worker_group(ThreadId thread_id) const;
+
+    /// Determine whether the queue for pending tasks is full (at capacity).
+    GUL_EXPORT
+    bool is_full() const noexcept;
+
+    /**
+     * Return true if the pool has neither pending tasks nor tasks that are currently
+     * being executed.
+     */
+    GUL_EXPORT
+    bool is_idle() const;
+
+    /// Determine whether the thread pool has been requested to shut down.
+    GUL_EXPORT
+    bool is_shutdown_requested() const;
+
+    /**
+     * Create a new strand for tasks that must be executed one after another (see
+     * Strand).
+     *
+     * \since GUL version 2.14
+     */
+    GUL_EXPORT
+    Strand make_strand();
+
+    /**
+     * Create a new group for tasks that are to be waited for or canceled together (see
+     * TaskGroup).
+     *
+     * \since GUL version 2.14
+     */
+    GUL_EXPORT
+    TaskGroup make_task_group();
+
+    /**
+     * Change the number of worker threads.
+     *
+     * New threads are started immediately. If the number is reduced, the threads with
+     * the highest IDs are retired: They finish the task they are currently executing
+     * (if any) and then exit, handing over the tasks in their local queues to the other
+     * workers. The call does not wait for this to happen.
+     *
+     * \param num_threads  New number of threads in the range
+     *                     [ThreadPoolOptions::min_num_threads,
+     *                     ThreadPoolOptions::max_num_threads]
+     *
+     * \exception std::invalid_argument is thrown if the number of threads is out of
+     *            range.
+     *
+     * \since GUL version 2.14
+     */
+    GUL_EXPORT
+    void set_thread_count(std::size_t num_threads);
+
+    /**
+     * Create a thread pool with the desired number of threads and the specified capacity
+     * for enqueuing tasks.
+     *
+     * The thread pool is allocated in a shared pointer, which is necessary so that task
+     * handles can access the pool safely. A ThreadPool cannot be constructed directly.
+     *
+     * \returns a shared pointer to the created ThreadPool object.
+     */
+    GUL_EXPORT
+    static std::shared_ptr<ThreadPool> make_shared(
+        std::size_t num_threads, std::size_t capacity = default_capacity);
+
+    /**
+     * Create a thread pool according to the given set of options.
+     *
+     * The thread pool is allocated in a shared pointer, which is necessary so that task
+     * handles can access the pool safely. A ThreadPool cannot be constructed directly.
+     *
+     * \returns a shared pointer to the created ThreadPool object.
+     *
+     * \since GUL version 2.14
+     */
+    GUL_EXPORT
+    static std::shared_ptr<ThreadPool> make_shared(const ThreadPoolOptions& options);
+
+private:
+    struct DependentTask; // Defined in ThreadPool.cc
+    class TimerWheel; // Defined in ThreadPool.cc
+
+    /// Worker group index of tasks that can be executed by any worker.
+    constexpr static std::size_t no_worker_group{
+        std::numeric_limits<std::size_t>::max() };
+
+    /**
+     * Optional parameters for enqueuing a task (see add_task_impl() and enqueue_task()).
+     * The defaults describe a task that can be started immediately by any worker.
+     */
+    struct SubmitOptions
+    {
+        /// When the task is to be started (no earlier), or immediately by default
+        SteadyTimePoint start_time{};
+
+        /// Latest start time; the task expires if it has not been started by then
+        SteadyTimePoint deadline{ SteadyTimePoint::max() };
+
+        /// Tasks that must have finished before the task is enqueued (or null)
+        const TaskDependencies* dependencies{ nullptr };
+
+        /// Worker group that must execute the task (or no_worker_group)
+        std::size_t worker_group{ no_worker_group };
+
+        /// Strand on which the task is serialized with others (or null)
+        const Strand* strand{ nullptr };
+
+        /// Task group that the task joins (or null)
+        const TaskGroup* task_group{ nullptr };
+    };
+
+    /**
+     * A type-erased, move-only function object with the signature void(ThreadPool&).
+     *
+     * Function objects of up to inline_size bytes that can be moved without throwing are
+     * stored directly inside the TaskFunction. Larger ones are allocated on the heap.
+     */
+    class TaskFunction
+    {
+    public:
+        /// Size of the internal buffer for storing function objects.
+        constexpr static std::size_t inline_size = 8 * sizeof(void*);
+
+        TaskFunction() noexcept = default;
+
+        template <typename F,
+            std::enable_if_t<!std::is_same<std::decay_t<F>, TaskFunction>::value, bool>
+                = true>
+        explicit TaskFunction(F&& fct)
+        {
+            using Fct = std::decay_t<F>;
+            construct<Fct>(std::forward<F>(fct),
+                std::integral_constant<bool, fits_inline<Fct>()>{});
+        }
+
+        TaskFunction(TaskFunction&& other) noexcept
+        {
+            if (other.ops_)
+            {
+                other.ops_->move(&other.storage_, &storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+
+        TaskFunction& operator=(TaskFunction&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                if (other.ops_)
+                {
+                    other.ops_->move(&other.storage_, &storage_);
+                    ops_ = other.ops_;
+                    other.ops_ = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        ~TaskFunction() { reset(); }
+
+        void operator()(ThreadPool& pool) { ops_->invoke(&storage_, pool); }
+
+    private:
+        struct Ops
+        {
+            void (*invoke)(void* obj, ThreadPool& pool);
+            void (*move)(void* from, void* to) noexcept; // Move-construct and destroy
+            void (*destroy)(void* obj) noexcept;
+        };
+
+        std::aligned_storage_t<inline_size, alignof(std::max_align_t)> storage_;
+        const Ops* ops_{ nullptr };
+
+        template <typename Fct>
+        constexpr static bool fits_inline() noexcept
+        {
+            return sizeof(Fct) <= inline_size
+                && alignof(Fct) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible<Fct>::value;
+        }
+
+        template <typename Fct, typename F>
+        void construct(F&& fct, std::true_type /*inline*/)
+        {
+            ::new (static_cast<void*>(&storage_)) Fct(std::forward<F>(fct));
+            ops_ = get_inline_ops<Fct>();
+        }
+
+        template <typename Fct, typename F>
+        void construct(F&& fct, std::false_type /*inline*/)
+        {
+            ::new (static_cast<void*>(&storage_)) Fct*(new Fct(std::forward<F>(fct)));
+            ops_ = get_heap_ops<Fct>();
+        }
+
+        template <typename Fct>
+        static const Ops* get_inline_ops() noexcept
+        {
+            static const Ops ops{
+                [](void* obj, ThreadPool& pool) { (*static_cast<Fct*>(obj))(pool); },
+                [](void* from, void* to) noexcept
+                {
+                    ::new (to) Fct(std::move(*static_cast<Fct*>(from)));
+                    static_cast<Fct*>(from)->~Fct();
+                },
+                [](void* obj) noexcept { static_cast<Fct*>(obj)->~Fct(); }
+            };
+            return &ops;
+        }
+
+        template <typename Fct>
+        static const Ops* get_heap_ops() noexcept
+        {
+            static const Ops ops{
+                [](void* obj, ThreadPool& pool) { (**static_cast<Fct**>(obj))(pool); },
+                [](void* from, void* to) noexcept
+                {
+                    ::new (to) Fct*(*static_cast<Fct**>(from));
+                },
+                [](void* obj) noexcept { delete *static_cast<Fct**>(obj); }
+            };
+            return &ops;
+        }
+
+        void reset() noexcept
+        {
+            if (ops_)
+            {
+                ops_->destroy(&storage_);
+                ops_ = nullptr;
+            }
+        }
+    };
+
+    struct Task
+    {
+        TaskId id_{};
+        TaskFunction fct_;
+        std::shared_ptr<detail::TaskControlBlock> control_; // null for detached tasks
+        SteadyTimePoint start_time_{}; // When the task is to be started (no earlier)
+        TaskName name_;
+        std::shared_ptr<detail::BatchState> batch_; // non-null for tasks of a batch
+        detail::PeriodicControlBlock* periodic_{ nullptr }; // non-null for periodic tasks
+        std::size_t worker_group_{ no_worker_group }; // Workers that may execute it
+        Strand::State* strand_{ nullptr }; // non-null for tasks on a strand
+        SteadyTimePoint deadline_{ SteadyTimePoint::max() }; // Latest start time
+
+        Task() = default;
+
+        Task(TaskId task_id, TaskFunction fct,
+            std::shared_ptr<detail::TaskControlBlock> control, SteadyTimePoint start_time,
+            TaskName name, std::shared_ptr<detail::BatchState> batch = nullptr)
+        : id_{ task_id }
+        , fct_{ std::move(fct) }
+        , control_{ std::move(control) }
+        , start_time_{ start_time }
+        , name_{ std::move(name) }
+        , batch_{ std::move(batch) }
+        {}
+
+        /// Determine whether the task has been canceled while waiting in a queue.
+        bool is_canceled() const noexcept
+        {
+            if (control_)
+                return control_->state_.load(std::memory_order_relaxed)
+                    == TaskState::canceled;
+            if (batch_)
+                return batch_->canceled_.load(std::memory_order_relaxed);
+            return false;
+        }
+    };
+
+    /**
+     * A FIFO queue of tasks that also allows removal at the back.
+     *
+     * The tasks are stored in a vector that keeps its capacity: Tasks are removed from
+     * the front by advancing an index, and the vector is compacted once more than half
+     * of it consists of removed elements. Pushing and popping therefore does not
+     * allocate memory in steady state.
+     */
+    class TaskQueue
+    {
+    public:
+        using iterator = std::vector<Task>::iterator;
+        using const_iterator = std::vector<Task>::const_iterator;
+
+        iterator begin() noexcept
+        {
+            return tasks_.begin() + static_cast<std::ptrdiff_t>(head_);
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return tasks_.begin() + static_cast<std::ptrdiff_t>(head_);
+        }
+
+        iterator end() noexcept { return tasks_.end(); }
+        const_iterator end() const noexcept { return tasks_.end(); }
+
+        Task& back() noexcept { return tasks_.back(); }
+        Task& front() noexcept { return tasks_[head_]; }
+        const Task& front() const noexcept { return tasks_[head_]; }
+
+        void clear() noexcept;
+        bool empty() const noexcept { return head_ == tasks_.size(); }
+        void erase(iterator first, iterator last);
+        void pop_back();
+        void pop_front();
+        void push_back(Task&& task) { tasks_.push_back(std::move(task)); }
+        void reserve(std::size_t n) { tasks_.reserve(tasks_.size() + n); }
+        std::size_t size() const noexcept { return tasks_.size() - head_; }
+
+    private:
+        std::vector<Task> tasks_;
+        std::size_t head_{ 0 }; // Index of the first element
+    };
+
+    /**
+     * Per-thread data of a worker.
+     *
+     * Each worker owns a local task queue which is only used in work-stealing mode. The
+     * worker pops tasks from the back of its queue, while other workers steal from the
+     * front. The worker also records the name of the task it is currently executing.
+     */
+    struct Worker
+    {
+        /// A task execution recorded for tracing (see get_trace_json())
+        struct TraceEvent
+        {
+            TaskName name_;
+            SteadyTimePoint start_time_{};
+            SteadyTimePoint end_time_{};
+        };
+
+        /**
+         * Statistics of the worker. The counters are only modified by the worker thread
+         * itself (or before it is started), so they are updated with relaxed loads and
+         * stores instead of read-modify-write operations. get_statistics() reads them
+         * concurrently.
+         */
+        struct Counters
+        {
+            std::atomic<std::uint64_t> num_started_{ 0 };
+            std::atomic<std::uint64_t> num_completed_{ 0 };
+
+            /// Total execution time of tasks in ticks of the steady clock
+            std::atomic<SteadyTimePoint::rep> busy_ticks_{ 0 };
+
+            /// Total lifetime of retired threads of this worker in steady clock ticks
+            std::atomic<SteadyTimePoint::rep> active_ticks_{ 0 };
+
+            /// Start time of the running thread (time since epoch), or 0 if there is none
+            std::atomic<SteadyTimePoint::rep> active_since_{ 0 };
+
+            std::array<std::atomic<std::uint64_t>, ThreadPoolStatistics::num_bins>
+                queue_wait_times_{};
+            std::array<std::atomic<std::uint64_t>, ThreadPoolStatistics::num_bins>
+                execution_times_{};
+        };
+
+        Counters counters_;
+
+        /// Start time of the current task (only used by the worker thread)
+        SteadyTimePoint task_start_time_{};
+
+        std::mutex mutex_; // Protects the following variables
+        TaskQueue local_tasks_;
+        TaskName running_task_name_;
+        bool is_running_{ false };
+
+        /// Ring buffer of recent task executions (empty if tracing is disabled)
+        std::vector<TraceEvent> trace_events_;
+
+        /// Total number of task executions recorded in trace_events_
+        std::size_t num_trace_events_{ 0 };
+
+        /// Number of tasks in local_tasks_ (readable without locking the mutex)
+        std::atomic<std::size_t> num_local_tasks_{ 0 };
+
+        /// Worker group of the worker (only set in the constructor)
+        std::size_t worker_group_{ 0 };
+
+        /// Flag indicating that a thread is running for this worker (see threads_mutex_)
+        bool is_active_{ false };
+
+        /// CPU cores to which the worker is pinned (only set in the constructor)
+        std::vector<unsigned int> cpu_set_;
+    };
+
+    std::size_t capacity_{ 0 };
+
+    /// Determines whether workers use local task queues and steal work from each other.
+    bool work_stealing_{ false };
+
+    /// Determines whether queue waiting times and execution times are measured.
+    bool measure_task_times_{ false };
+
+    /// Determines whether ready tasks with a deadline are ordered by their deadlines.
+    bool earliest_deadline_first_{ false };
+
+    /// Number of trace events recorded per worker (0 if tracing is disabled)
+    std::size_t trace_buffer_size_{ 0 };
+
+    /// Lower and upper bound for the number of threads (only set in the constructor)
+    std::size_t min_num_threads_{ 0 };
+    std::size_t max_num_threads_{ 0 };
+
+    /// Parameters for growing and shrinking the pool (only set in the constructor)
+    std::chrono::steady_clock::duration queue_wait_threshold_{ 0 };
+    std::chrono::steady_clock::duration idle_timeout_{ 0 };
+
+    /// Time for which idle workers spin before sleeping (only set in the constructor)
+    std::chrono::steady_clock::duration spin_duration_{ 0 };
+
+    /**
+     * Target number of threads. Workers with an ID of at least this number retire.
+     * Changes are made under threads_mutex_, except for the retirement of idle workers,
+     * which decrements the value with a compare-exchange operation.
+     */
+    std::atomic<std::size_t> num_threads_{ 0 };
+
+    /// Flag indicating that a thread is currently starting a new worker thread
+    std::atomic<bool> is_growing_{ false };
+
+    /**
+     * Protects threads_ and Worker::is_active_. If both this mutex and mutex_ must be
+     * locked, this one has to be locked first.
+     */
+    std::mutex threads_mutex_;
+
+    /**
+     * The threads in the pool, one slot for each possible worker (max_num_threads_). A
+     * slot holds a std::thread object from the time its worker is started until it is
+     * joined (after it has retired or when the pool is destroyed).
+     */
+    std::vector<std::thread> threads_;
+
+    /**
+     * Per-thread data for each slot in threads_. The vector itself is only modified in
+     * the constructor and not protected by the mutex.
+     */
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    /**
+     * For worker threads, this is the index of the thread in the threads_ vector.
+     * For other threads, the value is meaningless and the variable is initialized to
+     * numeric_limits<ThreadId>::max().
+     */
+    thread_local static ThreadId thread_id_;
+
+    /**
+     * For worker threads, this is a pointer to the pool that owns the thread. For other
+     * threads, it is null.
+     */
+    thread_local static const ThreadPool* thread_pool_;
+
+    /// For worker threads, this is a pointer to the task being executed (or null).
+    thread_local static const Task* running_task_;
+
+    /**
+     * A condition variable used together with mutex_ to wake up a worker thread when a
+     * new task is added (or when shutdown is requested).
+     */
+    std::condition_variable cv_;
+
+    /// Number of pending tasks in all queues (not counting canceled ones)
+    std::atomic<std::size_t> num_pending_{ 0 };
+
+    /**
+     * Number of canceled tasks that still occupy a place in one of the queues. This is
+     * only used as a heuristic for deciding when to purge the queues, and it can become
+     * negative for a short time.
+     */
+    std::atomic<std::ptrdiff_t> num_canceled_{ 0 };
+
+    /// Number of tasks that are currently being executed
+    std::atomic<std::size_t> num_running_{ 0 };
+
+    /// Number of tasks in the local queues of all workers
+    std::atomic<std::size_t> num_local_tasks_{ 0 };
+
+    /// Number of workers waiting on cv_
+    std::atomic<std::size_t> num_sleeping_{ 0 };
+
+    /// Number of workers polling for new tasks (see spin_for_work())
+    std::atomic<std::size_t> num_spinning_{ 0 };
+
+    /// Flag set by producers instead of a notification while workers are spinning
+    std::atomic<bool> has_new_work_{ false };
+
+    /// Total number of tasks that have been canceled (for get_statistics())
+    std::atomic<std::uint64_t> num_tasks_canceled_{ 0 };
+
+    /// Total number of tasks that have expired (for get_statistics())
+    std::atomic<std::uint64_t> num_tasks_expired_{ 0 };
+
+    /// Number of producers waiting on producer_cv_ for room in the queue
+    std::atomic<std::size_t> num_waiting_producers_{ 0 };
+
+    /**
+     * A mutex and condition variable for waking up producers that wait for room in the
+     * queue (see try_reserve_pending_slot()). This mutex must not be held while locking
+     * any other mutex.
+     */
+    std::mutex producer_mutex_;
+    std::condition_variable producer_cv_;
+
+    std::atomic<TaskId> next_task_id_{ 0 };
+
+    mutable std::mutex mutex_; // Protects the following variables
+
+    /// Tasks that are ready to be started, in the order in which they became ready
+    TaskQueue ready_tasks_;
+
+    /**
+     * Tasks that are ready to be started and that must be executed by a worker of a
+     * specific worker group (one queue per worker group).
+     */
+    std::vector<TaskQueue> worker_group_tasks_;
+
+    /**
+     * Tasks with a start time in the future, organized as a min-heap on the start time
+     * (see is_later()).
+     */
+    std::vector<Task> delayed_tasks_;
+
+    /**
+     * Tasks with a deadline that are ready to be started, organized as a min-heap on the
+     * deadline (see has_later_deadline()). Only used if earliest_deadline_first_ is set;
+     * these tasks are started before the ones in ready_tasks_.
+     */
+    std::vector<Task> deadline_tasks_;
+
+    /**
+     * Optional hierarchical timer wheel that replaces delayed_tasks_ for storing tasks
+     * with a start time in the future (see ThreadPoolOptions::timer_wheel).
+     */
+    std::unique_ptr<TimerWheel> timer_wheel_;
+
+    /**
+     * Strands that have a task in ready_tasks_ or running on a worker. The pool keeps
+     * them alive until their last task has finished.
+     */
+    std::vector<std::shared_ptr<Strand::State>> active_strands_;
+
+    std::atomic<bool> shutdown_requested_{ false }; // Written only with mutex locked
+
+
+    /**
+     * Create a thread pool with the desired number of threads and the specified capacity
+     * for queuing tasks.
+     *
+     * This constructor may not be used directly. Use make_thread_pool() to allocate a
+     * ThreadPool object in a shared pointer.
+     *
+     * Upon construction, the desired number of threads is launched. The threads are
+     * joined when the ThreadPool object gets destroyed.
+     *
+     * \param options  Number of threads, capacity, and scheduling options
+     *
+     * \exception std::invalid_argument is thrown if the desired number of threads is
+     *            zero or greater than max_threads, or if the requested capacity is zero
+     *            or exceeds max_capacity.
+     */
+    explicit ThreadPool(const ThreadPoolOptions& options);
+
+    /**
+     * Cancel a pending task.
+     *
+     * This call atomically switches the state of the task from pending to canceled. The
+     * task itself stays in its queue and is discarded when a worker encounters it, or
+     * when canceled tasks are purged from the queues. This function has no impact on
+     * tasks that are currently being executed.
+     *
+     * \param control  Control block of the task to be canceled
+     *
+     * \returns true if the task was canceled, false if it was not pending anymore.
+     */
+    GUL_EXPORT
+    bool cancel_pending_task(detail::TaskControlBlock& control);
+
+    /**
+     * Cancel all tasks of a batch that have not been started yet.
+     *
+     * Like cancel_pending_task(), this leaves the tasks in their queues to be discarded
+     * later on.
+     *
+     * \returns the number of tasks that were canceled.
+     */
+    GUL_EXPORT
+    std::size_t cancel_pending_batch(detail::BatchState& batch);
+
+    /// Call a function object that takes a ThreadPool&, discarding its result.
+    template <typename Function>
+    static void call_task_function(Function& fct, ThreadPool& pool, std::true_type)
+    {
+        fct(pool);
+    }
+
+    /// Call a function object that takes no arguments, discarding its result.
+    template <typename Function>
+    static void call_task_function(Function& fct, ThreadPool&, std::false_type)
+    {
+        fct();
+    }
+
+    /**
+     * Put a task into the appropriate queue and wake up a worker.
+     *
+     * In work-stealing mode, tasks that are enqueued by a worker of this pool for
+     * immediate execution end up in the worker's local queue. All other tasks are put
+     * into the shared queue. Tasks with dependencies are held back until all of their
+     * predecessors have finished (see release_dependent_task()), and tasks on a strand
+     * until their predecessor in the strand has finished (see advance_strand()).
+     *
+     * The task group in the options is ignored; joining it is up to the caller (see
+     * add_task_impl()).
+     *
+     * \returns the ID assigned to the task.
+     * \exception std::runtime_error is thrown if the queue is full.
+     *            std::invalid_argument is thrown if the dependencies or the strand are
+     *            invalid.
+     */
+    GUL_EXPORT
+    TaskId enqueue_task(TaskFunction fct,
+        std::shared_ptr<detail::TaskControlBlock> control, TaskName name,
+        const SubmitOptions& options);
+
+    /**
+     * Put a task for which a pending slot has already been reserved into the
+     * appropriate queue (like enqueue_task(), but ignoring dependencies and strands).
+     * The slot is released if an exception is thrown.
+     *
+     * \returns the ID assigned to the task.
+     */
+    GUL_EXPORT
+    TaskId enqueue_reserved_task(TaskFunction fct,
+        std::shared_ptr<detail::TaskControlBlock> control, TaskName name,
+        const SubmitOptions& options);
+
+    /**
+     * Put a batch of tasks into the appropriate queue and wake up as many workers as
+     * needed. IDs are assigned to the tasks in the process.
+     *
+     * \exception std::runtime_error is thrown if the queue does not have room for all
+     *            tasks.
+     */
+    GUL_EXPORT
+    void enqueue_tasks(std::vector<Task>& tasks);
+
+    /**
+     * Put a new periodic task into the appropriate queue and wake up a worker.
+     *
+     * \exception std::runtime_error is thrown if the queue is full.
+     */
+    GUL_EXPORT
+    void enqueue_periodic_task(TaskFunction fct,
+        std::shared_ptr<detail::PeriodicControlBlock> control,
+        SteadyTimePoint first_start_time, TaskName name);
+
+    /**
+     * Complete a task that has missed its deadline as expired, without running it (or
+     * discard it if it has been canceled in the meantime).
+     */
+    void expire_task(Task& task) noexcept;
+
+    /**
+     * Wait for a task that is ready to be executed and mark it as running on the given
+     * worker. Canceled tasks are discarded on the way.
+     *
+     * \returns true if a task was assigned, or false if the pool is shutting down.
+     */
+    bool get_next_task(Worker& worker, Task& task);
+
+    /**
+     * Increase the target number of threads by one (unless the maximum has been reached)
+     * and start the new worker.
+     */
+    void grow() noexcept;
+
+    /**
+     * Register the membership of a task that has just been enqueued (see
+     * make_task_group_member()) as a continuation of the task, so that the task leaves
+     * the group when it finishes. If the group has been canceled since the task joined
+     * it, the task is canceled now.
+     */
+    GUL_EXPORT
+    void activate_task_group_member(std::unique_ptr<detail::TaskContinuation> member,
+        const std::shared_ptr<detail::TaskControlBlock>& control) noexcept;
+
+    /**
+     * Make a new task a member of a task group. This is done before the task is
+     * enqueued, so that TaskGroup::wait_all() and TaskGroup::cancel() cannot miss it.
+     * If enqueuing fails, destroying the returned membership removes the task from the
+     * group again.
+     *
+     * \exception std::invalid_argument is thrown if the task group is not associated
+     *            with this pool.
+     */
+    GUL_EXPORT
+    std::unique_ptr<detail::TaskContinuation>
+    make_task_group_member(const TaskGroup& group,
+        const std::shared_ptr<detail::TaskControlBlock>& control);
+
+    /**
+     * Create the shared state for a task with a result, wrap the function object so
+     * that it stores its result there, and enqueue it.
+     */
+    template <typename Function>
+    TaskHandle<invoke_result_t<Function, ThreadPool&>>
+    add_task_impl(Function fct, TaskName name, const SubmitOptions& options)
+    {
+        using Result = invoke_result_t<Function, ThreadPool&>;
+
+        const detail::RecyclingAllocator<detail::TaskResultBlock<Result>> allocator;
+
+        auto result = std::allocate_shared<detail::TaskResultBlock<Result>>(allocator);
+        auto* block = result.get(); // kept alive by the control block of the task
+
+        // The task joins its group first and leaves it again if it cannot be enqueued
+        std::unique_ptr<detail::TaskContinuation> member;
+        if (options.task_group)
+            member = make_task_group_member(*options.task_group, result);
+
+        const TaskId id = enqueue_task(
+            TaskFunction{
+                [f = std::move(fct), block](ThreadPool& pool) mutable
+                {
+                    block->fulfill(f, pool);
+                } },
+            result, std::move(name), options);
+
+        if (member)
+            activate_task_group_member(std::move(member), result);
+
+        return TaskHandle<Result>{ id, std::move(result), shared_from_this() };
+    }
+
+    /**
+     * Create the shared state for a task with a result, wait until the given time point
+     * for room in the queue, and enqueue the task.
+     *
+     * \returns a TaskHandle for the task, or an empty optional if no room was available
+     *          in time.
+     */
+    template <typename Function>
+    optional<TaskHandle<invoke_result_t<Function, ThreadPool&>>>
+    try_add_task_impl(Function fct, TaskName name, SteadyTimePoint wait_until)
+    {
+        using Result = invoke_result_t<Function, ThreadPool&>;
+
+        const detail::RecyclingAllocator<detail::TaskResultBlock<Result>> allocator;
+
+        auto result = std::allocate_shared<detail::TaskResultBlock<Result>>(allocator);
+        auto* block = result.get(); // kept alive by the control block of the task
+
+        TaskFunction task_fct{
+            [f = std::move(fct), block](ThreadPool& pool) mutable
+            {
+                block->fulfill(f, pool);
+            } };
+
+        if (!try_reserve_pending_slot(wait_until))
+            return nullopt;
+
+        const TaskId id = enqueue_reserved_task(std::move(task_fct), result,
+            std::move(name), SubmitOptions{});
+
+        return TaskHandle<Result>{ id, std::move(result), shared_from_this() };
+    }
+
+    /**
+     * Determine whether the queue for pending tasks is full (internal non-locking
+     * version).
+     */
+    GUL_EXPORT
+    bool is_full_i() const noexcept;
+
+    /**
+     * Heap comparison for delayed_tasks_: Return true if task a is to be started after
+     * task b. Tasks with the same start time are ordered by their ID.
+     */
+    static bool is_later(const Task& a, const Task& b) noexcept;
+
+    /**
+     * Heap comparison for deadline_tasks_: Return true if task a has a later deadline
+     * than task b. Tasks with the same deadline are ordered by their ID.
+     */
+    static bool has_later_deadline(const Task& a, const Task& b) noexcept;
+
+    /**
+     * Try to switch a task that has been taken from a queue into the running state and
+     * record it as running on the specified worker.
+     *
+     * \returns true if the task is now running, or false if it had been canceled.
+     */
+    bool start_task(Worker& worker, Task& task);
+
+    /**
+     * Start worker threads for all slots below the target number of threads that do not
+     * have an active worker. threads_mutex_ must be locked.
+     */
+    void start_worker_threads();
+
+    /**
+     * Wake up one worker to pick up a new task: Signal a spinning worker if there is
+     * one, or notify the condition variable otherwise. The mutex must not be locked.
+     */
+    void notify_one_worker() noexcept;
+
+    /**
+     * Let a spinning worker know that new work has arrived.
+     *
+     * \returns true if there is a spinning worker, false otherwise.
+     */
+    bool signal_spinning_worker() noexcept;
+
+    /**
+     * Poll for new work until a producer signals it, the local queues of the pool
+     * receive a task, the given time is reached, or the worker has to stop. The worker
+     * must have been counted in num_spinning_; it is removed from the count before
+     * returning.
+     */
+    void spin_for_work(SteadyTimePoint spin_end) noexcept;
+
+    /// Wrap a function object taking a ThreadPool& into a TaskFunction.
+    template <typename Function>
+    static TaskFunction make_task_function(Function fct, std::true_type /*takes_pool*/)
+    {
+        return TaskFunction{ std::move(fct) };
+    }
+
+    /// Wrap a function object taking no arguments into a TaskFunction.
+    template <typename Function>
+    static TaskFunction make_task_function(Function fct, std::false_type /*takes_pool*/)
+    {
+        return TaskFunction{ [f = std::move(fct)](ThreadPool&) mutable { f(); } };
+    }
+
+    /**
+     * The main loop run in the thread; picks one task off the queue and executes it, then
+     * repeats until asked to quit.
+     *
+     * \param thread_index  Index of the thread in the threads_ vector
+     */
+    void perform_work(std::size_t thread_index);
+
+    /**
+     * Put a task for which a pending slot has already been reserved into the appropriate
+     * queue and wake up a worker.
+     *
+     * The task is left untouched if an exception is thrown.
+     */
+    void push_task(Task&& task);
+
+    /**
+     * Move all delayed tasks whose start time has come from delayed_tasks_ to
+     * ready_tasks_. The mutex must be locked.
+     *
+     * \returns the time at which the next delayed task becomes due (or at which the timer
+     *          wheel needs to be advanced), or SteadyTimePoint::max() if there is none.
+     */
+    SteadyTimePoint promote_due_tasks();
+
+    /// Return the point in time on the steady clock after the given delay from now.
+    static SteadyTimePoint get_steady_time_after(Duration delay)
     {
-        return add_task(std::move(fct), TimePoint{}, std::move(name));
+        return std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
     }
 
     /**
-     * Remove all pending tasks from the queue.
+     * Convert a point in time on the system clock into the corresponding point in time
+     * on the steady clock. A default-constructed TimePoint (meaning "immediately") is
+     * converted into a default-constructed SteadyTimePoint.
+     */
+    GUL_EXPORT
+    static SteadyTimePoint to_steady_time(TimePoint t);
+
+    /**
+     * Determine whether so many canceled tasks have accumulated in the queues that they
+     * should be purged: more than 64, and more than there are pending tasks.
+     */
+    bool must_purge_canceled_tasks() const noexcept;
+
+    /**
+     * Remove all canceled tasks from the queues. The mutex must be locked.
      *
-     * This call removes all tasks that have not yet been started from the queue. It has
-     * no impact on tasks that are currently being executed.
+     * This is done by idle workers and by the functions that add tasks whenever
+     * must_purge_canceled_tasks() returns true, so that canceled tasks cannot accumulate
+     * in the queues even while all workers are busy. As the number of removed tasks is
+     * at least proportional to the size of the queues, the cost per canceled task is
+     * constant on average.
+     */
+    void purge_canceled_tasks();
+
+    /**
+     * Take the most recently added task from the local queue of the given worker.
      *
-     * \returns the number of tasks that were removed.
+     * \returns true if a task was found, false if the local queue is empty.
      */
-    GUL_EXPORT
-    std::size_t cancel_pending_tasks();
+    bool pop_local_task(Worker& worker, Task& task);
 
-    /// Return the maximum number of pending tasks that can be queued.
-    GUL_EXPORT
-    std::size_t capacity() const noexcept { return capacity_; }
+    /**
+     * Put the next task of a strand into the shared queue after its predecessor has
+     * finished or has been discarded, skipping canceled tasks. If no task is left, the
+     * strand becomes inactive. The mutex must not be locked.
+     */
+    void advance_strand(Strand::State& strand) noexcept;
 
-    /// Return the number of pending tasks.
-    GUL_EXPORT
-    std::size_t count_pending() const;
+    /**
+     * Remove a strand from the list of active strands. The mutex must be locked.
+     *
+     * \returns the pool's reference to the strand, which should be released after
+     *          unlocking the mutex.
+     */
+    std::shared_ptr<Strand::State> deactivate_strand_i(Strand::State& strand) noexcept;
 
-    /// Return the number of threads in the pool.
-    GUL_EXPORT
-    std::size_t count_threads() const noexcept;
+    /**
+     * Put a task on a strand into the shared queue if the strand is inactive, or into
+     * the queue of the strand otherwise. A pending slot must have been reserved.
+     */
+    void push_strand_task(Task&& task, const Strand& strand);
 
-    /// Return a vector with the names of the tasks that are waiting to be executed.
-    GUL_EXPORT
-    std::vector<std::string> get_pending_task_names() const;
+    /**
+     * Enqueue a task whose predecessors have all finished, or cancel it if any of them
+     * has been canceled (or if it cannot be enqueued).
+     */
+    void release_dependent_task(Task& task, bool cancel) noexcept;
 
-    /// Return a vector with the names of the tasks that are currently running.
-    GUL_EXPORT
-    std::vector<std::string> get_running_task_names() const;
+    /**
+     * Put a periodic task back into the queue after a run, with the start time of its
+     * next run. If the task has been stopped in the meantime (or if it cannot be
+     * enqueued), it is canceled instead.
+     */
+    void reschedule_periodic_task(Task& task) noexcept;
 
     /**
-     * Return the thread pool ID of the current thread.
-     *
-     * \returns a thread ID in the range [0, count_threads()).
-     *
-     * \exception std::runtime_error is thrown if this function is called from a thread
-     *            that is not part of the pool.
+     * Release the given number of pending slots and wake up producers that are waiting
+     * for room in the queue (see try_reserve_pending_slot()).
+     */
+    void release_pending_slots(std::size_t num_tasks = 1) noexcept;
+
+    /**
+     * Reserve room for the given number of additional pending tasks.
+     * \exception std::runtime_error is thrown if the queue does not have enough room.
+     */
+    void reserve_pending_slots(std::size_t num_tasks = 1);
+
+    /**
+     * Reserve room for one additional pending task, waiting until the given time point
+     * if the queue is full. SteadyTimePoint::max() waits indefinitely, a time point in
+     * the past (e.g. SteadyTimePoint{}) does not wait at all.
      *
-     * \since GUL version 2.13
+     * \returns true if a slot was reserved, false if the queue remained full.
      */
     GUL_EXPORT
-    ThreadId get_thread_id() const;
+    bool try_reserve_pending_slot(SteadyTimePoint wait_until);
 
-    /// Determine whether the queue for pending tasks is full (at capacity).
-    GUL_EXPORT
-    bool is_full() const noexcept;
+    /**
+     * Retire the calling worker thread if its ID is not lower than the target number of
+     * threads. The tasks in its local queue are moved to the shared queue.
+     *
+     * \returns true if the worker must exit, false if it has to continue working.
+     */
+    bool retire_worker(Worker& worker, ThreadId thread_id);
 
     /**
-     * Return true if the pool has neither pending tasks nor tasks that are currently
-     * being executed.
+     * Determine whether the pool should start an additional worker because the oldest
+     * task in the shared queue has been waiting for too long. The mutex must be locked.
      */
-    GUL_EXPORT
-    bool is_idle() const;
+    bool should_grow_i() const noexcept;
 
-    /// Determine whether the thread pool has been requested to shut down.
-    GUL_EXPORT
-    bool is_shutdown_requested() const;
+    /**
+     * Determine whether the time at which an immediate task becomes ready has to be
+     * recorded in its start time (for measuring its waiting time).
+     */
+    bool must_record_ready_time() const noexcept;
 
     /**
-     * Create a thread pool with the desired number of threads and the specified capacity
-     * for enqueuing tasks.
-     *
-     * The thread pool is allocated in a shared pointer, which is necessary so that task
-     * handles can access the pool safely. A ThreadPool cannot be constructed directly.
+     * Try to take the oldest task from the local queue of another worker.
      *
-     * \returns a shared pointer to the created ThreadPool object.
+     * \returns true if a task was stolen, false otherwise.
      */
-    GUL_EXPORT
-    static std::shared_ptr<ThreadPool> make_shared(
-        std::size_t num_threads, std::size_t capacity = default_capacity);
+    bool steal_task(Task& task);
 
-private:
     /**
-     * An enum describing the internal state of a task on the ThreadPool.
+     * Wait until a task is available in one of the queues and take it out.
+     *
+     * The returned task may have been canceled in the meantime, see start_task().
      *
-     * This enum just describes if the task is pending, running, or neither. The pool has
-     * no further knowledge about the task, but a TaskHandle can additionally determine if
-     * a task has completed or been canceled.
+     * \returns true if a task was taken, or false if the pool is shutting down.
      */
-    enum class InternalTaskState
+    bool wait_for_task(Worker& worker, Task& task);
+
+    /// Wake up to the given number of sleeping workers, if there are any.
+    void wake_sleeping_workers(std::size_t max_num_workers = 1);
+};
+
+/**
+ * A set of tasks on which another task depends.
+ *
+ * TaskDependencies are usually created with after() or after_any() and passed to
+ * ThreadPool::add_task(). Depending on the mode, a task with dependencies is enqueued
+ * after all of its predecessors have finished, or as soon as one of them has completed.
+ *
+ * \since GUL version 2.14
+ */
+class TaskDependencies
+{
+public:
+    /// Determines when a task with dependencies is enqueued.
+    enum class Mode
     {
-        /// The task is waiting to be started
-        pending = static_cast<int>(TaskState::pending),
-        /// The task is currently being executed
-        running = static_cast<int>(TaskState::running),
-        /// The thread pool has no knowledge about this task
-        unknown
+        /// Enqueue when all predecessors have completed; cancel if any is canceled.
+        all,
+        /// Enqueue when any predecessor has completed; cancel if all are canceled.
+        any
     };
 
-    struct NamedTask
+    /// Construct an empty set of dependencies.
+    explicit TaskDependencies(Mode mode = Mode::all) noexcept
+        : mode_{ mode }
+    {}
+
+    /**
+     * Add a predecessor.
+     * \exception std::invalid_argument is thrown if the handle is not associated with a
+     *            task.
+     */
+    template <typename T>
+    TaskDependencies& add(const ThreadPool::TaskHandle<T>& handle)
     {
-        NamedTask(std::string name)
-        : name_{ std::move(name) }
-        {}
+        if (not handle.control_)
+            throw std::invalid_argument("Task handle is not associated with a task");
 
-        virtual ~NamedTask() = default;
-        virtual void operator()(ThreadPool& pool) = 0;
+        predecessors_.push_back(Predecessor{ handle.control_, handle.pool_ });
+        return *this;
+    }
 
-        std::string name_;
-    };
+    /// Determine whether there are no predecessors.
+    bool empty() const noexcept { return predecessors_.empty(); }
 
-    template <typename FunctionType>
-    struct NamedTaskImpl : public NamedTask
+    /**
+     * Return the index of the first predecessor (in the order in which they were added)
+     * that has completed, or size() if none of them has.
+     */
+    std::size_t find_complete() const noexcept
     {
-    public:
-        NamedTaskImpl(FunctionType fct, std::string name)
-        : NamedTask{ std::move(name) }
-        , fct_{ std::move(fct) }
-        {}
-
-        void operator()(ThreadPool& pool) override { fct_(pool); }
+        for (std::size_t i = 0; i != predecessors_.size(); ++i)
+        {
+            if (predecessors_[i].control_->state_.load(std::memory_order_acquire)
+                == TaskState::complete)
+            {
+                return i;
+            }
+        }
+        return predecessors_.size();
+    }
 
-        FunctionType fct_;
-    };
+    /// Return the mode of the dependencies.
+    Mode get_mode() const noexcept { return mode_; }
 
-    struct Task
+    /**
+     * Return the ThreadPool that the predecessors belong to.
+     *
+     * \exception std::logic_error is thrown if there are no predecessors or if the pool
+     *            does not exist anymore.
+     */
+    std::shared_ptr<ThreadPool> get_thread_pool() const
     {
-        TaskId id_{};
-        std::unique_ptr<NamedTask> named_task_;
-        TimePoint start_time_{}; // When the task is to be started (at least no earlier)
+        if (predecessors_.empty())
+            throw std::logic_error("Dependencies without predecessors have no pool");
 
-        Task() = default;
+        return detail::lock_pool_or_throw(predecessors_.front().pool_);
+    }
 
-        Task(TaskId task_id, std::unique_ptr<NamedTask> named_task, TimePoint start_time)
-        : id_{ task_id }
-        , named_task_{ std::move(named_task) }
-        , start_time_{ start_time }
-        {}
+private:
+    friend class ThreadPool;
+
+    struct Predecessor
+    {
+        std::shared_ptr<detail::TaskControlBlock> control_;
+        std::weak_ptr<ThreadPool> pool_;
     };
 
-    std::size_t capacity_{ 0 };
+    std::vector<Predecessor> predecessors_;
+    Mode mode_{ Mode::all };
+};
+
+/**
+ * Create a set of dependencies from one or more task handles.
+ *
+ * \code{.cpp}
+ * auto a = pool->add_task([]() { step_a(); });
+ * auto b = pool->add_task([]() { step_b(); });
+ * pool->add_task([]() { step_c(); }, after(a, b)); // starts when a and b have finished
+ * \endcode
+ *
+ * \exception std::invalid_argument is thrown if one of the handles is not associated
+ *            with a task.
+ *
+ * \since GUL version 2.14
+ */
+template <typename... Ts>
+TaskDependencies after(const ThreadPool::TaskHandle<Ts>&... handles)
+{
+    TaskDependencies dependencies;
+    (void)std::initializer_list<int>{ (dependencies.add(handles), 0)... };
+    return dependencies;
+}
+
+/**
+ * Create a set of dependencies that is fulfilled as soon as any of the given tasks has
+ * completed.
+ *
+ * A task with these dependencies is enqueued when the first of the predecessors has
+ * completed. It is canceled only if all of them are canceled.
+ *
+ * \exception std::invalid_argument is thrown if one of the handles is not associated
+ *            with a task.
+ *
+ * \since GUL version 2.14
+ */
+template <typename... Ts>
+TaskDependencies after_any(const ThreadPool::TaskHandle<Ts>&... handles)
+{
+    TaskDependencies dependencies{ TaskDependencies::Mode::any };
+    (void)std::initializer_list<int>{ (dependencies.add(handles), 0)... };
+    return dependencies;
+}
+
+/**
+ * Create a task that completes when all of the given tasks have completed.
+ *
+ * The returned task is enqueued on the pool of the given tasks, but it does not occupy a
+ * thread while waiting. It is canceled if any of the given tasks is canceled. Its
+ * handle is mainly useful for attaching continuations:
+ *
+ * \code{.cpp}
+ * auto a = pool->add_task([]() { return fetch_a(); });
+ * auto b = pool->add_task([]() { return fetch_b(); });
+ * when_all(a, b).then([&]() { combine(a.get_result(), b.get_result()); });
+ * \endcode
+ *
+ * \exception std::invalid_argument is thrown if one of the handles is not associated
+ *            with a task or if the tasks belong to different pools.
+ *            std::logic_error is thrown if the pool does not exist anymore.
+ *            std::runtime_error is thrown if the queue of the pool is full.
+ *
+ * \since GUL version 2.14
+ */
+template <typename T, typename... Ts>
+ThreadPool::TaskHandle<void>
+when_all(const ThreadPool::TaskHandle<T>& handle,
+    const ThreadPool::TaskHandle<Ts>&... handles)
+{
+    const auto dependencies = after(handle, handles...);
+    return dependencies.get_thread_pool()->add_task([]() {}, dependencies);
+}
+
+/**
+ * Create a task that completes when all tasks in a range of handles have completed.
+ *
+ * \see when_all(const ThreadPool::TaskHandle<T>&, const ThreadPool::TaskHandle<Ts>&...)
+ *
+ * \exception std::invalid_argument is additionally thrown if the range is empty.
+ *
+ * \since GUL version 2.14
+ */
+template <typename Iterator,
+    typename = typename std::iterator_traits<Iterator>::iterator_category>
+ThreadPool::TaskHandle<void> when_all(Iterator first, Iterator last)
+{
+    TaskDependencies dependencies;
+    for (; first != last; ++first)
+        dependencies.add(*first);
+
+    if (dependencies.empty())
+        throw std::invalid_argument("when_all() needs at least one task");
+
+    return dependencies.get_thread_pool()->add_task([]() {}, dependencies);
+}
+
+/**
+ * Create a task that completes as soon as any of the given tasks has completed.
+ *
+ * The result of the returned task is the index of a completed task among the arguments.
+ * If several tasks have completed by the time the returned task runs, this is the one
+ * with the lowest index. The returned task is canceled only if all of the given tasks
+ * are canceled.
+ *
+ * \code{.cpp}
+ * auto primary = pool->add_task([]() { return query(primary_server); });
+ * auto backup = pool->add_task([]() { return query(backup_server); });
+ * auto first = when_any(primary, backup).get_result(); // 0 or 1
+ * \endcode
+ *
+ * \exception std::invalid_argument is thrown if one of the handles is not associated
+ *            with a task or if the tasks belong to different pools.
+ *            std::logic_error is thrown if the pool does not exist anymore.
+ *            std::runtime_error is thrown if the queue of the pool is full.
+ *
+ * \since GUL version 2.14
+ */
+template <typename T, typename... Ts>
+ThreadPool::TaskHandle<std::size_t>
+when_any(const ThreadPool::TaskHandle<T>& handle,
+    const ThreadPool::TaskHandle<Ts>&... handles)
+{
+    auto dependencies = after_any(handle, handles...);
+    auto pool = dependencies.get_thread_pool();
+    return pool->add_task(
+        [dependencies]() { return dependencies.find_complete(); }, dependencies);
+}
+
+/**
+ * Create a task that completes as soon as any task in a range of handles has completed.
+ *
+ * The result of the returned task is the position of a completed task in the range.
+ *
+ * \see when_any(const ThreadPool::TaskHandle<T>&, const ThreadPool::TaskHandle<Ts>&...)
+ *
+ * \exception std::invalid_argument is additionally thrown if the range is empty.
+ *
+ * \since GUL version 2.14
+ */
+template <typename Iterator,
+    typename = typename std::iterator_traits<Iterator>::iterator_category>
+ThreadPool::TaskHandle<std::size_t> when_any(Iterator first, Iterator last)
+{
+    TaskDependencies dependencies{ TaskDependencies::Mode::any };
+    for (; first != last; ++first)
+        dependencies.add(*first);
+
+    if (dependencies.empty())
+        throw std::invalid_argument("when_any() needs at least one task");
+
+    auto pool = dependencies.get_thread_pool();
+    return pool->add_task(
+        [dependencies]() { return dependencies.find_complete(); }, dependencies);
+}
+
+/**
+ * A set of options for creating a ThreadPool.
+ *
+ * \code{.cpp}
+ * ThreadPoolOptions options;
+ * options.num_threads = 32;
+ * options.work_stealing = true;
+ * auto pool = make_thread_pool(options);
+ * \endcode
+ *
+ * \since GUL version 2.14
+ */
+struct ThreadPoolOptions
+{
+    /// Number of worker threads (initially, if the pool is elastic).
+    std::size_t num_threads{ 1 };
 
     /**
-     * The threads in the pool. This variable is only modified in the constructor and not
-     * protected by the mutex.
+     * Minimum number of worker threads for an elastic pool (0 means num_threads).
+     *
+     * Workers that have been idle for idle_timeout are retired until this number is
+     * reached.
      */
-    std::vector<std::thread> threads_;
+    std::size_t min_num_threads{ 0 };
 
     /**
-     * For worker threads, this is the index of the thread in the threads_ vector.
-     * For other threads, the value is meaningless and the variable is initialized to
-     * numeric_limits<ThreadId>::max().
+     * Maximum number of worker threads for an elastic pool (0 means num_threads).
+     *
+     * If the oldest task in the shared queue has been waiting for longer than
+     * queue_wait_threshold while no worker is idle, a new worker is started until this
+     * number is reached.
      */
-    thread_local static ThreadId thread_id_;
+    std::size_t max_num_threads{ 0 };
 
     /**
-     * A condition variable used together with mutex_ to wake up a worker thread when a
-     * new task is added (or when shutdown is requested).
+     * Maximum time that a ready task may wait in the shared queue before the pool starts
+     * an additional worker (if max_num_threads permits). The waiting time is checked
+     * whenever a task is submitted to or taken from the shared queue. A value of zero
+     * disables automatic growth.
      */
-    std::condition_variable cv_;
-
-    mutable std::mutex mutex_; // Protects the following variables
-    std::vector<Task> pending_tasks_;
-    std::vector<TaskId> running_task_ids_;
-    std::vector<std::string> running_task_names_;
-    TaskId next_task_id_ = 0;
-    bool shutdown_requested_{ false };
+    ThreadPool::Duration queue_wait_threshold{ std::chrono::milliseconds{ 10 } };
 
+    /**
+     * Time after which an idle worker causes the pool to retire a thread (if
+     * min_num_threads permits). A value of zero disables automatic shrinking.
+     */
+    ThreadPool::Duration idle_timeout{ std::chrono::seconds{ 60 } };
 
     /**
-     * Create a thread pool with the desired number of threads and the specified capacity
-     * for queuing tasks.
-     *
-     * This constructor may not be used directly. Use make_thread_pool() to allocate a
-     * ThreadPool object in a shared pointer.
+     * Time for which an idle worker keeps polling for new tasks before it goes to sleep
+     * on a condition variable. A zero value (the default) sends idle workers to sleep
+     * right away.
      *
-     * Upon construction, the desired number of threads is launched. The threads are
-     * joined when the ThreadPool object gets destroyed.
-     *
-     * \param num_threads  Desired number of threads
-     * \param capacity     Maximum number of pending tasks that can be queued
-     *
-     * \exception std::invalid_argument is thrown if the desired number of threads is
-     *            zero or greater than max_threads, or if the requested capacity is zero
-     *            or exceeds max_capacity.
+     * A spinning worker picks up a new task within a fraction of a microsecond, whereas
+     * waking up a sleeping thread typically takes tens of microseconds. Submitting a
+     * task also becomes cheaper while a worker spins because no notification needs to be
+     * sent. The price is CPU time: After a short busy-wait, a spinning worker yields
+     * the CPU between its checks, but it still keeps a core busy if no other threads
+     * are waiting to run.
      */
-    ThreadPool(std::size_t num_threads, std::size_t capacity);
+    ThreadPool::Duration spin_duration{ 0 };
+
+    /// Maximum number of pending tasks that can be queued.
+    std::size_t capacity{ ThreadPool::default_capacity };
 
     /**
-     * Remove the pending task associated with the specified ID.
+     * Store delayed tasks in a hierarchical timer wheel instead of a binary heap.
      *
-     * This call looks for a pending task with the given ID. If one is found, it is
-     * immediately removed and true is returned. If none is found, false is returned.
-     * This function has no impact on tasks that are currently being executed.
+     * The timer wheel inserts delayed tasks in constant time with a resolution of one
+     * millisecond, which pays off for workloads that schedule large numbers of timeouts
+     * that are mostly canceled before they expire. A task never starts earlier than its
+     * start time, but it can start up to one millisecond late, and tasks that become due
+     * within the same millisecond are not guaranteed to start in the order of their start
+     * times.
+     */
+    bool timer_wheel{ false };
+
+    /**
+     * Measure how long tasks wait in the queue and how long they run (see
+     * ThreadPool::get_statistics()). This requires reading the steady clock when a task
+     * is submitted, started, and finished.
+     */
+    bool measure_task_times{ false };
+
+    /**
+     * Number of task executions that each worker records for ThreadPool::get_trace_json()
+     * (0 disables tracing). When the buffer of a worker is full, its oldest entries are
+     * overwritten. Each entry stores a copy of the task name; the string buffers are
+     * reused, so that recording does not allocate memory in steady state.
+     */
+    std::size_t trace_buffer_size{ 0 };
+
+    /**
+     * CPU sets to which the worker threads are pinned.
      *
-     * \param task_id  Unique ID for the task to be removed
+     * Each entry is a list of CPU indices and defines one worker group: Worker `i` is
+     * pinned to the CPUs in `cpu_sets[i % cpu_sets.size()]` and belongs to worker group
+     * `i % cpu_sets.size()`. Tasks can be submitted to a specific worker group with
+     * ThreadPool::add_task_to_worker_group(). There must be at least as many threads as
+     * CPU sets. If the vector is empty (the default), the workers are not pinned and
+     * form a single worker group.
      *
-     * \returns true if a task was removed, false if no pending task with the given ID was
-     *          found.
+     * Pinning is currently only supported on Linux. Elsewhere, and if the operating
+     * system rejects a CPU set, the workers run unpinned, but the worker groups still
+     * exist.
      */
-    GUL_EXPORT
-    bool cancel_pending_task(TaskId task_id);
+    std::vector<std::vector<unsigned int>> cpu_sets;
 
     /**
-     * Determine the state of the task with the specified ID.
+     * Group the worker threads by NUMA node.
      *
-     * \param task_id  Unique ID of the task
-     *
-     * \returns InternalTaskState::pending if the task is still waiting to be started,
-     *     InternalTaskState::running if the task is currently being executed, or
-     *     InternalTaskState::unknown if the thread pool has no knowledge of this task ID.
+     * If this flag is set, cpu_sets must be empty. The pool then uses the CPUs of each
+     * NUMA node of the system as one CPU set (on Linux, as reported in
+     * /sys/devices/system/node), so that each worker is pinned to one node and tasks can
+     * be submitted to the workers of a node. If there are more nodes than threads, only
+     * the first nodes are used. If no NUMA information is available, the pool behaves
+     * as if the flag was not set.
      */
-    GUL_EXPORT
-    InternalTaskState get_task_state(TaskId task_id) const;
+    bool numa_groups{ false };
 
     /**
-     * Determine whether the queue for pending tasks is full (internal non-locking
-     * version).
+     * Enable work stealing.
+     *
+     * If this flag is set, each worker thread gets its own local task queue. A task that
+     * is added by a worker thread of the same pool and that is due for immediate
+     * execution is pushed onto the worker's local queue instead of the shared queue.
+     * Workers execute tasks from their own queue in LIFO order, and idle workers steal
+     * the oldest tasks from their peers. This reduces contention on the shared queue for
+     * workloads with many short tasks that spawn further tasks, but it means that tasks
+     * are no longer guaranteed to start in the order in which they were added.
      */
-    GUL_EXPORT
-    bool is_full_i() const noexcept;
+    bool work_stealing{ false };
 
     /**
-     * The main loop run in the thread; picks one task off the queue and executes it, then
-     * repeats until asked to quit.
+     * Start ready tasks with a deadline in the order of their deadlines (see
+     * ThreadPool::add_task(Function, ThreadPool::Deadline, TaskName)).
      *
-     * \param thread_index  Index of the thread in the threads_ vector
+     * If this flag is set, tasks with a deadline are kept in a priority queue and are
+     * always started before tasks without a deadline, the most urgent one first. Under
+     * sustained overload, this can starve tasks without a deadline. Tasks with a
+     * deadline that are added by a worker in work-stealing mode also go to the shared
+     * priority queue instead of the local queue of the worker.
      */
-    void perform_work(std::size_t thread_index);
+    bool earliest_deadline_first{ false };
 };
 
 /**
@@ -628,6 +3582,21 @@ inline std::shared_ptr<ThreadPool> make_thread_pool(
     return ThreadPool::make_shared(num_threads, capacity);
 }
 
+/**
+ * Create a thread pool according to the given set of options.
+ *
+ * The thread pool is allocated in a shared pointer, which is necessary so that task
+ * handles can access the pool safely. A ThreadPool cannot be constructed directly.
+ *
+ * \returns a shared pointer to the created ThreadPool object.
+ *
+ * \since GUL version 2.14
+ */
+inline std::shared_ptr<ThreadPool> make_thread_pool(const ThreadPoolOptions& options)
+{
+    return ThreadPool::make_shared(options);
+}
+
 /// @}
 
 } // namespace gul14
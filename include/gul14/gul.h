@@ -42,6 +42,7 @@
 #include "gul14/case_ascii.h"
 #include "gul14/cat.h"
 // #include "gul14/catch.h" not included because it is only useful for unit tests
+#include "gul14/CompletionQueue.h"
 // #include "gul14/date.h" not included by default to reduce compile times
 #include "gul14/escape.h"
 #include "gul14/expected.h"
@@ -51,7 +52,9 @@
 #include "gul14/join_split.h"
 #include "gul14/num_util.h"
 #include "gul14/optional.h"
+#include "gul14/parallel.h"
 #include "gul14/replace.h"
+#include "gul14/ShardedThreadPool.h"
 #include "gul14/SlidingBuffer.h"
 #include "gul14/SmallVector.h"
 #include "gul14/span.h"
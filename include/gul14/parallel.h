@@ -0,0 +1,412 @@
+/**
+ * \file    parallel.h
+ * \authors \ref contributors
+ * \date    Created on October 15, 2026
+ * \brief   Data-parallel algorithms running on a ThreadPool.
+ *
+ * \copyright Copyright 2026 Deutsches Elektronen-Synchrotron (DESY), Hamburg
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2.1 of the license, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#ifndef GUL14_PARALLEL_H_
+#define GUL14_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gul14/optional.h"
+#include "gul14/span.h"
+#include "gul14/ThreadPool.h"
+
+namespace gul14 {
+
+namespace detail {
+
+/**
+ * Shared state of a data-parallel algorithm: Hands out chunks of an index range to the
+ * participating threads and collects the first exception thrown by one of them.
+ *
+ * Chunks are handed out with guided self-scheduling: Each chunk covers a fixed fraction
+ * of the remaining indices, so that the first chunks are large (little synchronization
+ * overhead) and the last ones are small (good load balancing at the end).
+ */
+class ParallelState
+{
+public:
+    ParallelState(std::size_t num_elements, std::size_t num_participants) noexcept
+        : num_elements_{ num_elements }
+        , divisor_{ 2 * num_participants }
+    {}
+
+    /**
+     * Claim the next chunk of indices.
+     * \returns true if a chunk [begin, end) was assigned, false if no indices are left.
+     */
+    bool next_chunk(std::size_t& begin, std::size_t& end) noexcept
+    {
+        std::size_t pos = next_.load(std::memory_order_relaxed);
+        std::size_t chunk_size;
+
+        do
+        {
+            if (pos >= num_elements_)
+                return false;
+
+            const std::size_t remaining = num_elements_ - pos;
+            chunk_size = std::max<std::size_t>(1, remaining / divisor_);
+        }
+        while (!next_.compare_exchange_weak(pos, pos + chunk_size,
+            std::memory_order_relaxed));
+
+        begin = pos;
+        end = pos + chunk_size;
+        return true;
+    }
+
+    /// Record an exception and make sure no further chunks are handed out.
+    void fail(std::exception_ptr e) noexcept
+    {
+        next_.store(num_elements_, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!exception_)
+            exception_ = std::move(e);
+    }
+
+    /// Rethrow the first recorded exception, if any.
+    void rethrow_if_failed()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (exception_)
+            std::rethrow_exception(exception_);
+    }
+
+private:
+    const std::size_t num_elements_;
+    const std::size_t divisor_;
+    std::atomic<std::size_t> next_{ 0 };
+    std::mutex mutex_;
+    std::exception_ptr exception_;
+};
+
+/**
+ * Determine how many threads should work on a range of the given size: All threads of
+ * the pool plus the calling thread, but not more than there are elements.
+ */
+inline std::size_t get_num_participants(const ThreadPool& pool, std::size_t num_elements)
+{
+    return std::min(pool.count_threads() + 1, num_elements);
+}
+
+/**
+ * Process the index range [0, num_elements) with the calling thread and up to
+ * num_participants - 1 helper tasks on the pool.
+ *
+ * The body is called as body(participant, begin, end) for disjoint chunks of the range,
+ * where participant is 0 for the calling thread and 1...num_participants - 1 for the
+ * helpers. When the calling thread runs out of work, helper tasks that have not been
+ * started are removed from the queue. Only then does the function wait for the others,
+ * so it is safe to call it from within a task running on the same pool.
+ */
+template <typename Body>
+void run_parallel(ThreadPool& pool, std::size_t num_elements,
+    std::size_t num_participants, Body& body)
+{
+    ParallelState state{ num_elements, num_participants };
+
+    const auto work = [&state, &body](std::size_t participant) noexcept
+        {
+            try
+            {
+                std::size_t begin, end;
+                while (state.next_chunk(begin, end))
+                    body(participant, begin, end);
+            }
+            catch (...)
+            {
+                state.fail(std::current_exception());
+            }
+        };
+
+    using Work = std::remove_const_t<decltype(work)>;
+
+    struct Helper
+    {
+        const Work* work_;
+        std::size_t participant_;
+
+        void operator()() const { (*work_)(participant_); }
+    };
+
+    ThreadPool::BatchHandle batch;
+
+    if (num_participants > 1)
+    {
+        std::vector<Helper> helpers;
+        helpers.reserve(num_participants - 1);
+        for (std::size_t i = 1; i != num_participants; ++i)
+            helpers.push_back(Helper{ &work, i });
+
+        try
+        {
+            batch = pool.add_tasks(helpers);
+        }
+        catch (const std::runtime_error&)
+        {
+            // The queue is full: The calling thread does all of the work.
+        }
+    }
+
+    work(0);
+
+    batch.cancel();
+    batch.wait();
+
+    state.rethrow_if_failed();
+}
+
+} // namespace detail
+
+/**
+ * \addtogroup parallel_h gul14/parallel.h
+ * \brief Data-parallel algorithms running on a ThreadPool.
+ * @{
+ */
+
+/**
+ * Call a function for each element of a range, distributing the work over the threads
+ * of a ThreadPool.
+ *
+ * The range is split into chunks whose size adapts to the amount of remaining work.
+ * The calling thread participates in processing the chunks, so the function can also be
+ * used from within a task on the same pool without risk of a deadlock. It returns when
+ * all elements have been processed. The order in which the elements are processed is
+ * unspecified.
+ *
+ * \param pool         The ThreadPool to use for the helper tasks
+ * \param first, last  A range of random-access iterators
+ * \param fct          A function object that is called as `fct(element)` for each
+ *                     element. It is called concurrently from multiple threads.
+ *
+ * If fct throws an exception, no further chunks are started, and the first exception is
+ * rethrown to the caller after all running chunks have finished.
+ *
+ * \code{.cpp}
+ * auto pool = make_thread_pool(4);
+ * std::vector<double> values = get_values();
+ * parallel_for(*pool, values.begin(), values.end(), [](double& v) { v = std::sqrt(v); });
+ * \endcode
+ *
+ * \since GUL version 2.14
+ */
+template <typename RandomAccessIterator, typename Function>
+void parallel_for(ThreadPool& pool, RandomAccessIterator first, RandomAccessIterator last,
+    Function fct)
+{
+    using Diff = typename std::iterator_traits<RandomAccessIterator>::difference_type;
+
+    const auto num_elements = static_cast<std::size_t>(last - first);
+
+    auto body = [first, &fct](std::size_t, std::size_t begin, std::size_t end)
+        {
+            const auto chunk_end = first + static_cast<Diff>(end);
+            for (auto it = first + static_cast<Diff>(begin); it != chunk_end; ++it)
+                fct(*it);
+        };
+
+    detail::run_parallel(pool, num_elements,
+        detail::get_num_participants(pool, num_elements), body);
+}
+
+/**
+ * Call a function for each element of a span, distributing the work over the threads
+ * of a ThreadPool.
+ *
+ * \see parallel_for(ThreadPool&, RandomAccessIterator, RandomAccessIterator, Function)
+ *
+ * \since GUL version 2.14
+ */
+template <typename ElementT, std::size_t extent, typename Function>
+void parallel_for(ThreadPool& pool, span<ElementT, extent> elements, Function fct)
+{
+    parallel_for(pool, elements.begin(), elements.end(), std::move(fct));
+}
+
+/**
+ * Apply a function to each element of an input range and store the results in an output
+ * range, distributing the work over the threads of a ThreadPool.
+ *
+ * This is the parallel equivalent of the unary std::transform(). The calling thread
+ * participates in the work.
+ *
+ * \param pool         The ThreadPool to use for the helper tasks
+ * \param first, last  The input range (random-access iterators)
+ * \param d_first      Beginning of the output range (a random-access iterator); the
+ *                     output range may be identical to the input range.
+ * \param fct          A function object that is called as `fct(element)` for each input
+ *                     element. It is called concurrently from multiple threads.
+ *
+ * \returns an iterator to the element past the last element written.
+ *
+ * If fct throws an exception, no further chunks are started, and the first exception is
+ * rethrown to the caller after all running chunks have finished.
+ *
+ * \since GUL version 2.14
+ */
+template <typename RandomAccessIterator, typename OutputIterator, typename Function>
+OutputIterator parallel_transform(ThreadPool& pool, RandomAccessIterator first,
+    RandomAccessIterator last, OutputIterator d_first, Function fct)
+{
+    using Diff = typename std::iterator_traits<RandomAccessIterator>::difference_type;
+    using OutDiff = typename std::iterator_traits<OutputIterator>::difference_type;
+
+    const auto num_elements = static_cast<std::size_t>(last - first);
+
+    auto body = [first, d_first, &fct](std::size_t, std::size_t begin, std::size_t end)
+        {
+            const auto chunk_end = first + static_cast<Diff>(end);
+            auto out = d_first + static_cast<OutDiff>(begin);
+            for (auto it = first + static_cast<Diff>(begin); it != chunk_end; ++it, ++out)
+                *out = fct(*it);
+        };
+
+    detail::run_parallel(pool, num_elements,
+        detail::get_num_participants(pool, num_elements), body);
+
+    return d_first + static_cast<OutDiff>(num_elements);
+}
+
+/**
+ * Apply a function to each element of an input span and store the results in an output
+ * span, distributing the work over the threads of a ThreadPool.
+ *
+ * \exception std::invalid_argument is thrown if the output span is smaller than the
+ *            input span.
+ *
+ * \see parallel_transform(ThreadPool&, RandomAccessIterator, RandomAccessIterator,
+ *      OutputIterator, Function)
+ *
+ * \since GUL version 2.14
+ */
+template <typename InputT, std::size_t in_extent, typename OutputT,
+    std::size_t out_extent, typename Function>
+void parallel_transform(ThreadPool& pool, span<InputT, in_extent> input,
+    span<OutputT, out_extent> output, Function fct)
+{
+    if (output.size() < input.size())
+        throw std::invalid_argument("Output span is smaller than input span");
+
+    parallel_transform(pool, input.begin(), input.end(), output.begin(), std::move(fct));
+}
+
+/**
+ * Combine all elements of a range with a binary operation, distributing the work over
+ * the threads of a ThreadPool.
+ *
+ * This is the parallel equivalent of std::reduce(): Each participating thread reduces
+ * its chunks to a partial result, and the partial results are combined at the end. The
+ * calling thread participates in the work. Because the elements are grouped and
+ * combined in an unspecified order, the operation must be associative and commutative.
+ *
+ * \param pool         The ThreadPool to use for the helper tasks
+ * \param first, last  A range of random-access iterators
+ * \param init         The initial value of the reduction
+ * \param op           A binary function object that is called as `op(T, T)`. It is
+ *                     called concurrently from multiple threads.
+ *
+ * \returns the reduction of init and all elements of the range.
+ *
+ * If op throws an exception, no further chunks are started, and the first exception is
+ * rethrown to the caller after all running chunks have finished.
+ *
+ * \code{.cpp}
+ * std::vector<double> values = get_values();
+ * double sum = parallel_reduce(*pool, values.begin(), values.end(), 0.0,
+ *     std::plus<double>{});
+ * \endcode
+ *
+ * \since GUL version 2.14
+ */
+template <typename RandomAccessIterator, typename T, typename BinaryOp>
+T parallel_reduce(ThreadPool& pool, RandomAccessIterator first, RandomAccessIterator last,
+    T init, BinaryOp op)
+{
+    using Diff = typename std::iterator_traits<RandomAccessIterator>::difference_type;
+
+    const auto num_elements = static_cast<std::size_t>(last - first);
+    const auto num_participants = detail::get_num_participants(pool, num_elements);
+
+    // One partial result per participating thread
+    std::vector<optional<T>> partial_results(num_participants);
+
+    auto body = [first, &op, &partial_results](std::size_t participant, std::size_t begin,
+        std::size_t end)
+        {
+            const auto chunk_end = first + static_cast<Diff>(end);
+            auto it = first + static_cast<Diff>(begin);
+
+            T value = *it;
+            for (++it; it != chunk_end; ++it)
+                value = op(std::move(value), *it);
+
+            auto& partial = partial_results[participant];
+            if (partial)
+                *partial = op(std::move(*partial), std::move(value));
+            else
+                partial = std::move(value);
+        };
+
+    detail::run_parallel(pool, num_elements, num_participants, body);
+
+    for (auto& partial : partial_results)
+    {
+        if (partial)
+            init = op(std::move(init), std::move(*partial));
+    }
+
+    return init;
+}
+
+/**
+ * Combine all elements of a span with a binary operation, distributing the work over
+ * the threads of a ThreadPool.
+ *
+ * \see parallel_reduce(ThreadPool&, RandomAccessIterator, RandomAccessIterator, T,
+ *      BinaryOp)
+ *
+ * \since GUL version 2.14
+ */
+template <typename ElementT, std::size_t extent, typename T, typename BinaryOp>
+T parallel_reduce(ThreadPool& pool, span<ElementT, extent> elements, T init, BinaryOp op)
+{
+    return parallel_reduce(pool, elements.begin(), elements.end(), std::move(init),
+        std::move(op));
+}
+
+/// @}
+
+} // namespace gul14
+
+#endif // GUL14_PARALLEL_H_
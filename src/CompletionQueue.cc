@@ -0,0 +1,238 @@
+/**
+ * \file    CompletionQueue.cc
+ * \authors \ref contributors
+ * \date    Created on October 16, 2026
+ * \brief   Implementation of the CompletionQueue class.
+ *
+ * \copyright Copyright 2026 Deutsches Elektronen-Synchrotron (DESY), Hamburg
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2.1 of the license, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <system_error>
+
+#include "gul14/CompletionQueue.h"
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace gul14 {
+
+/// A notification in the lock-free list of a completion queue
+struct CompletionQueue::Node
+{
+    Completion completion_;
+    Node* next_{ nullptr };
+};
+
+/**
+ * The shared state of a completion queue. It is kept alive by the queue and by all
+ * watches that have not been run yet.
+ *
+ * Notifications are pushed onto a lock-free stack (newest first) by the threads that
+ * finish the tasks. The consumer takes the whole stack at once and reverses it.
+ */
+struct CompletionQueue::State
+{
+    State();
+    ~State();
+
+    /// Push a chain of nodes (from first to last) and signal the descriptor if needed.
+    void push(Node* first, Node* last) noexcept;
+
+    /// Make the file descriptor readable.
+    void signal() noexcept;
+
+    /// Make the file descriptor unreadable again.
+    void reset() noexcept;
+
+    std::atomic<Node*> head_{ nullptr };
+    int read_fd_{ -1 };
+    int write_fd_{ -1 };
+};
+
+/// A continuation that posts a notification when its task has finished
+struct CompletionQueue::Watch final : detail::TaskContinuation
+{
+    Watch(std::shared_ptr<State> state, ThreadPool::TaskId id)
+        : state_{ std::move(state) }
+        , node_{ new Node{ Completion{ id, TaskState::pending } } }
+    {}
+
+    void run(TaskState final_state) noexcept override
+    {
+        node_->completion_.state = final_state;
+        Node* node = node_.release();
+        state_->push(node, node);
+    }
+
+    std::shared_ptr<State> state_;
+    std::unique_ptr<Node> node_; // Allocated up front so that run() cannot fail
+};
+
+
+//
+// CompletionQueue::State
+//
+
+CompletionQueue::State::State()
+{
+#if defined(__linux__)
+    read_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (read_fd_ < 0)
+        throw std::system_error(errno, std::generic_category(), "Cannot create eventfd");
+    write_fd_ = read_fd_;
+#elif defined(__unix__) || defined(__APPLE__)
+    int fds[2];
+    if (pipe(fds) != 0)
+        throw std::system_error(errno, std::generic_category(), "Cannot create pipe");
+
+    for (int fd : fds)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+#endif
+}
+
+CompletionQueue::State::~State()
+{
+    Node* node = head_.load(std::memory_order_acquire);
+    while (node)
+    {
+        Node* next = node->next_;
+        delete node;
+        node = next;
+    }
+
+#if defined(__linux__) || defined(__unix__) || defined(__APPLE__)
+    if (write_fd_ != read_fd_)
+        close(write_fd_);
+    if (read_fd_ >= 0)
+        close(read_fd_);
+#endif
+}
+
+void CompletionQueue::State::push(Node* first, Node* last) noexcept
+{
+    Node* head = head_.load(std::memory_order_relaxed);
+    do
+    {
+        last->next_ = head;
+    }
+    while (!head_.compare_exchange_weak(head, first, std::memory_order_release,
+        std::memory_order_relaxed));
+
+    // Only the first notification after a harvest() needs to wake up the consumer
+    if (head == nullptr)
+        signal();
+}
+
+void CompletionQueue::State::reset() noexcept
+{
+#if defined(__linux__)
+    eventfd_t value;
+    eventfd_read(read_fd_, &value);
+#elif defined(__unix__) || defined(__APPLE__)
+    char buffer[64];
+    while (read(read_fd_, buffer, sizeof(buffer)) > 0)
+    {}
+#endif
+}
+
+void CompletionQueue::State::signal() noexcept
+{
+#if defined(__linux__)
+    eventfd_write(write_fd_, 1);
+#elif defined(__unix__) || defined(__APPLE__)
+    const char byte = 0;
+    // A full pipe is readable anyway, so a failed write does not lose the signal
+    static_cast<void>(write(write_fd_, &byte, 1));
+#endif
+}
+
+
+//
+// CompletionQueue
+//
+
+CompletionQueue::CompletionQueue()
+    : state_{ std::make_shared<State>() }
+{}
+
+CompletionQueue::~CompletionQueue() = default;
+
+int CompletionQueue::get_fd() const noexcept
+{
+    return state_->read_fd_;
+}
+
+std::size_t CompletionQueue::harvest(std::vector<Completion>& completions)
+{
+    // Reset the descriptor before taking the notifications: A notification that
+    // arrives afterwards finds an empty list and signals the descriptor again.
+    state_->reset();
+
+    Node* first = state_->head_.exchange(nullptr, std::memory_order_acquire);
+    if (first == nullptr)
+        return 0;
+
+    std::size_t num = 1;
+    Node* last = first;
+    while (last->next_)
+    {
+        last = last->next_;
+        ++num;
+    }
+
+    const std::size_t old_size = completions.size();
+
+    try
+    {
+        completions.resize(old_size + num);
+    }
+    catch (...)
+    {
+        state_->push(first, last); // Nothing is lost
+        throw;
+    }
+
+    // The list holds the newest notification first
+    std::size_t i = old_size + num;
+    while (first)
+    {
+        Node* next = first->next_;
+        completions[--i] = first->completion_;
+        delete first;
+        first = next;
+    }
+
+    return num;
+}
+
+void CompletionQueue::watch_task(detail::TaskControlBlock& control, ThreadPool::TaskId id)
+{
+    control.add_continuation(std::make_unique<Watch>(state_, id));
+}
+
+} // namespace gul14
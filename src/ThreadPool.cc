@@ -21,7 +21,12 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <fstream>
 #include <limits>
+#include <unordered_set>
 
 #include <gul14/cat.h>
 #include <gul14/ThreadPool.h>
@@ -29,6 +34,14 @@
 
 #include <signal.h>
 
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace gul14 {
 
 namespace detail {
@@ -42,241 +55,2915 @@ std::shared_ptr<ThreadPool> lock_pool_or_throw(std::weak_ptr<ThreadPool> pool)
     return shared_ptr;
 }
 
-} // namespace detail
+namespace {
 
+// Size classes of the recycling cache (multiples of 16 bytes up to 256 bytes)
+constexpr std::size_t recycling_granularity = 16;
+constexpr std::size_t recycling_num_classes = 16;
+constexpr std::size_t recycling_max_blocks_per_class = 256;
 
-//
-// ThreadPool
-//
+// Number of blocks that are exchanged between a thread-local cache and the shared depot
+// at once, and maximum number of such batches per size class in the depot
+constexpr std::size_t recycling_batch_size = 64;
+constexpr std::size_t recycling_max_batches_per_class = 64;
 
-ThreadPool::ThreadPool(std::size_t num_threads, std::size_t capacity)
-    : capacity_(capacity)
+struct FreeBlock
 {
-    if (num_threads == 0 || num_threads > max_threads)
+    FreeBlock* next_;
+};
+
+/**
+ * A process-wide depot of freed memory blocks, sorted into size classes. Each entry is
+ * a list of recycling_batch_size blocks.
+ *
+ * Thread-local caches hand over a batch when they are full and fetch one when they are
+ * empty. This way, blocks that are freed by the worker threads of a pool find their way
+ * back to the threads that submit tasks.
+ */
+struct RecyclingDepot
+{
+    std::mutex mutex_;
+    std::array<std::array<FreeBlock*, recycling_max_batches_per_class>,
+        recycling_num_classes> batches_{};
+    std::array<std::size_t, recycling_num_classes> num_batches_{};
+};
+
+RecyclingDepot& get_recycling_depot()
+{
+    // The depot is deliberately leaked, so that it remains usable during the
+    // destruction of static and thread-local objects
+    static auto* depot = new RecyclingDepot;
+    return *depot;
+}
+
+// A thread-local cache of freed memory blocks, sorted into size classes.
+struct RecyclingCache
+{
+    std::array<FreeBlock*, recycling_num_classes> heads_{};
+    std::array<std::size_t, recycling_num_classes> sizes_{};
+
+    ~RecyclingCache();
+};
+
+thread_local bool recycling_cache_destroyed = false;
+thread_local RecyclingCache recycling_cache;
+
+RecyclingCache::~RecyclingCache()
+{
+    recycling_cache_destroyed = true;
+
+    for (FreeBlock* block : heads_)
     {
-        throw std::invalid_argument(
-            cat("Illegal number of threads for thread pool: ", num_threads));
+        while (block)
+        {
+            FreeBlock* next = block->next_;
+            ::operator delete(block);
+            block = next;
+        }
     }
+}
 
-    if (capacity == 0 || capacity > max_capacity)
-        throw std::invalid_argument(cat("Illegal capacity for thread pool: ", capacity));
-
-    threads_.reserve(num_threads);
-    for (std::size_t i = 0; i != num_threads; ++i)
-        threads_.emplace_back([this, i]() { perform_work(i); });
+// Return the size class index for a given allocation size (at least
+// recycling_num_classes if the size is too big to be cached).
+std::size_t get_size_class(std::size_t size) noexcept
+{
+    if (size == 0)
+        return 0;
+    return (size - 1) / recycling_granularity;
 }
 
-ThreadPool::~ThreadPool()
+} // anonymous namespace
+
+void* allocate_recycled(std::size_t size)
 {
-    std::unique_lock<std::mutex> lock(mutex_);
-    shutdown_requested_ = true;
-    lock.unlock();
-    cv_.notify_all();
+    const std::size_t size_class = get_size_class(size);
 
-    for (auto& t : threads_)
+    if (size_class >= recycling_num_classes)
+        return ::operator new(size);
+
+    if (!recycling_cache_destroyed)
     {
-        if (t.joinable())
-            t.join();
+        RecyclingCache& cache = recycling_cache;
+        FreeBlock* block = cache.heads_[size_class];
+
+        if (!block)
+        {
+            // Fetch a batch of blocks that were freed on other threads
+            RecyclingDepot& depot = get_recycling_depot();
+            std::lock_guard<std::mutex> lock(depot.mutex_);
+            std::size_t& num_batches = depot.num_batches_[size_class];
+            if (num_batches != 0)
+            {
+                block = depot.batches_[size_class][--num_batches];
+                cache.sizes_[size_class] = recycling_batch_size;
+            }
+        }
+
+        if (block)
+        {
+            cache.heads_[size_class] = block->next_;
+            --cache.sizes_[size_class];
+            return block;
+        }
     }
+
+    // Always allocate the full size class so that blocks can be freely reused
+    return ::operator new((size_class + 1) * recycling_granularity);
 }
 
-bool ThreadPool::cancel_pending_task(const TaskId task_id)
+void deallocate_recycled(void* ptr, std::size_t size) noexcept
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    const std::size_t size_class = get_size_class(size);
 
-    auto it = std::find_if(pending_tasks_.begin(), pending_tasks_.end(),
-        [task_id](const Task& t) { return t.id_ == task_id; });
-    if (it != pending_tasks_.end())
+    if (size_class < recycling_num_classes && !recycling_cache_destroyed)
     {
-        pending_tasks_.erase(it);
-        return true;
+        RecyclingCache& cache = recycling_cache;
+
+        if (cache.sizes_[size_class] >= recycling_max_blocks_per_class)
+        {
+            // Hand a batch over to the depot, or release it if the depot is full
+            FreeBlock* batch = cache.heads_[size_class];
+            FreeBlock* last = batch;
+            for (std::size_t i = 1; i != recycling_batch_size; ++i)
+                last = last->next_;
+            cache.heads_[size_class] = last->next_;
+            cache.sizes_[size_class] -= recycling_batch_size;
+            last->next_ = nullptr;
+
+            {
+                RecyclingDepot& depot = get_recycling_depot();
+                std::lock_guard<std::mutex> lock(depot.mutex_);
+                std::size_t& num_batches = depot.num_batches_[size_class];
+                if (num_batches != recycling_max_batches_per_class)
+                {
+                    depot.batches_[size_class][num_batches++] = batch;
+                    batch = nullptr;
+                }
+            }
+
+            while (batch)
+            {
+                FreeBlock* next = batch->next_;
+                ::operator delete(batch);
+                batch = next;
+            }
+        }
+
+        auto block = static_cast<FreeBlock*>(ptr);
+        block->next_ = cache.heads_[size_class];
+        cache.heads_[size_class] = block;
+        ++cache.sizes_[size_class];
+        return;
     }
 
-    return false;
+    ::operator delete(ptr);
 }
 
-std::size_t ThreadPool::cancel_pending_tasks()
+namespace {
+
+// Marks the continuation list of a finished task as closed
+struct ClosedMarker final : TaskContinuation
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    void run(TaskState) noexcept override {}
+};
 
-    std::size_t num_removed = pending_tasks_.size();
-    pending_tasks_.clear();
+ClosedMarker closed_marker;
 
-    return num_removed;
+bool is_finished(TaskState state) noexcept
+{
+    return state == TaskState::complete || state == TaskState::canceled
+        || state == TaskState::expired;
 }
 
-std::size_t ThreadPool::count_pending() const
+#if defined(__linux__)
+
+static_assert(sizeof(std::atomic<TaskState>) == sizeof(int),
+    "The task state must be usable as a futex word");
+
+// Sleep until the state is changed from old_state and waiters are woken up (or until a
+// spurious wakeup occurs). Returns immediately if the state differs from old_state.
+void wait_for_state_change(const std::atomic<TaskState>& state, TaskState old_state)
+    noexcept
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return pending_tasks_.size();
+    syscall(SYS_futex, &state, FUTEX_WAIT_PRIVATE, static_cast<int>(old_state),
+        nullptr, nullptr, 0);
 }
 
-std::size_t ThreadPool::count_threads() const noexcept
+// Wake up all threads waiting for a change of the state.
+void wake_state_waiters(const std::atomic<TaskState>& state) noexcept
 {
-    return threads_.size();
+    syscall(SYS_futex, &state, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
 }
 
-std::vector<std::string> ThreadPool::get_pending_task_names() const
+#else
+
+// Without futexes, waiters sleep on one of a few condition variables shared by all
+// tasks, selected by the address of the state.
+struct ParkingSlot
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
 
-    std::vector<std::string> names;
-    names.resize(pending_tasks_.size());
+std::array<ParkingSlot, 16> parking_slots;
 
-    std::transform(pending_tasks_.begin(), pending_tasks_.end(), names.begin(),
-        [](const Task& t) { return t.named_task_->name_; });
+ParkingSlot& get_parking_slot(const std::atomic<TaskState>& state) noexcept
+{
+    const auto address = reinterpret_cast<std::uintptr_t>(&state);
+    return parking_slots[(address / alignof(TaskControlBlock)) % parking_slots.size()];
+}
 
-    return names;
+void wait_for_state_change(const std::atomic<TaskState>& state, TaskState old_state)
+    noexcept
+{
+    ParkingSlot& slot = get_parking_slot(state);
+    std::unique_lock<std::mutex> lock(slot.mutex_);
+
+    while (state.load(std::memory_order_acquire) == old_state)
+        slot.cv_.wait(lock);
 }
 
-std::vector<std::string> ThreadPool::get_running_task_names() const
+void wake_state_waiters(const std::atomic<TaskState>& state) noexcept
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return running_task_names_;
+    ParkingSlot& slot = get_parking_slot(state);
+
+    // Locking the mutex ensures that a waiter has either seen the new state or is
+    // already waiting on the condition variable
+    {
+        std::lock_guard<std::mutex> lock(slot.mutex_);
+    }
+    slot.cv_.notify_all();
 }
 
-ThreadPool::InternalTaskState ThreadPool::get_task_state(const TaskId task_id) const
+#endif
+
+} // anonymous namespace
+
+TaskControlBlock::~TaskControlBlock()
 {
-    std::lock_guard<std::mutex> lock(mutex_);
+    // Continuations of a task that never finished are destroyed without running them
+    TaskContinuation* c = continuations_.load(std::memory_order_acquire);
+    if (c == &closed_marker)
+        return;
+
+    while (c)
+    {
+        TaskContinuation* next = c->next_;
+        delete c;
+        c = next;
+    }
+}
 
-    const auto itr = std::find(
-        running_task_ids_.begin(), running_task_ids_.end(), task_id);
-    if (itr != running_task_ids_.end())
-        return InternalTaskState::running;
+void TaskControlBlock::add_continuation(
+    std::unique_ptr<TaskContinuation> continuation) noexcept
+{
+    TaskContinuation* head = continuations_.load(std::memory_order_acquire);
 
-    const auto itp = std::find_if(
-        pending_tasks_.begin(), pending_tasks_.end(),
-        [task_id](const Task& t) { return t.id_ == task_id; });
-    if (itp != pending_tasks_.end())
-        return InternalTaskState::pending;
+    do
+    {
+        if (head == &closed_marker)
+        {
+            continuation->run(state_.load(std::memory_order_acquire));
+            return;
+        }
+        continuation->next_ = head;
+    }
+    while (!continuations_.compare_exchange_weak(head, continuation.get(),
+        std::memory_order_acq_rel, std::memory_order_acquire));
 
-    return InternalTaskState::unknown;
+    continuation.release(); // now owned by the list
 }
 
-ThreadPool::ThreadId ThreadPool::get_thread_id() const
+void TaskControlBlock::run_continuations() noexcept
 {
-    if (thread_id_ == std::numeric_limits<ThreadId>::max())
-        throw std::runtime_error("This thread is not part of the pool");
+    // Pairs with the fence in wait(): Either the waiter sees the final state, or we see
+    // its flag and wake it up.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (has_waiters_.load(std::memory_order_relaxed))
+        wake_state_waiters(state_);
 
-    return thread_id_;
+    TaskContinuation* c = continuations_.exchange(&closed_marker,
+        std::memory_order_acq_rel);
+
+    // Reverse the list so that continuations run in the order of their registration
+    TaskContinuation* reversed = nullptr;
+    while (c)
+    {
+        TaskContinuation* next = c->next_;
+        c->next_ = reversed;
+        reversed = c;
+        c = next;
+    }
+
+    const TaskState final_state = state_.load(std::memory_order_acquire);
+
+    while (reversed)
+    {
+        std::unique_ptr<TaskContinuation> continuation{ reversed };
+        reversed = reversed->next_;
+        continuation->run(final_state);
+    }
 }
 
-bool ThreadPool::is_full() const noexcept
+TaskState TaskControlBlock::wait() noexcept
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return is_full_i();
+    TaskState state = state_.load(std::memory_order_acquire);
+    if (is_finished(state))
+        return state;
+
+    has_waiters_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    for (;;)
+    {
+        state = state_.load(std::memory_order_acquire);
+        if (is_finished(state))
+            return state;
+
+        wait_for_state_change(state_, state);
+    }
 }
 
-bool ThreadPool::is_full_i() const noexcept
+} // namespace detail
+
+namespace {
+
+// Add a value to a counter that is only modified by the calling thread (see
+// ThreadPool::Worker::Counters). This avoids the cost of an atomic read-modify-write.
+template <typename T>
+inline void add_to_counter(std::atomic<T>& counter, T value) noexcept
 {
-    return pending_tasks_.size() >= capacity_;
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+        std::memory_order_relaxed);
 }
 
-bool ThreadPool::is_idle() const
+// Return the index of the histogram bin for the given duration (see
+// ThreadPoolStatistics::Histogram).
+std::size_t get_histogram_bin(std::chrono::steady_clock::duration duration) noexcept
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return pending_tasks_.empty() && running_task_ids_.empty();
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration)
+        .count();
+
+    std::size_t bin = 0;
+    while (bin + 1 < ThreadPoolStatistics::num_bins
+        && us >= (std::chrono::microseconds::rep{ 1 } << bin))
+    {
+        ++bin;
+    }
+
+    return bin;
 }
 
-bool ThreadPool::is_shutdown_requested() const
+// Escape a string for use in a JSON string literal.
+std::string escape_json(string_view str)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return shutdown_requested_;
+    std::string result;
+    result.reserve(str.size());
+
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                static const char hex_digits[] = "0123456789abcdef";
+                result += "\\u00";
+                result += hex_digits[(c >> 4) & 0xf];
+                result += hex_digits[c & 0xf];
+            }
+            else
+            {
+                result += c;
+            }
+        }
+    }
+
+    return result;
 }
 
-std::shared_ptr<ThreadPool> ThreadPool::make_shared(
-    std::size_t num_threads, std::size_t capacity)
+// Format a duration in microseconds with three decimals (for Chrome trace files).
+std::string format_microseconds(std::chrono::steady_clock::duration duration)
 {
-    // We cannot use std::make_shared() because the constructor is private.
-    return std::shared_ptr<ThreadPool>(new ThreadPool(num_threads, capacity));
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+        .count();
+    const std::string fraction = std::to_string(ns % 1000);
+
+    return cat(ns / 1000, '.', std::string(3 - fraction.size(), '0'), fraction);
 }
 
-void ThreadPool::perform_work(const ThreadPool::ThreadId thread_id)
+// Parse a list of CPU indices in the format used by the Linux kernel (e.g. "0-3,8,10").
+std::vector<unsigned int> parse_cpu_list(const std::string& str)
 {
-#if defined(__APPLE__) || defined(__GNUC__)
-    // On unixoid systems, we block a number of signals in the worker threads because we
-    // do not explicitly handle them. Otherwise, a worker thread receiving a signal might
-    // terminate the whole process.
+    std::vector<unsigned int> cpus;
+    std::size_t pos = 0;
 
-    sigset_t mask;
+    while (pos < str.size())
+    {
+        std::size_t end = str.find(',', pos);
+        if (end == std::string::npos)
+            end = str.size();
 
-    sigemptyset(&mask);
-    sigaddset(&mask, SIGALRM);
-    sigaddset(&mask, SIGINT);
-    sigaddset(&mask, SIGPIPE);
-    sigaddset(&mask, SIGTERM);
-    sigaddset(&mask, SIGURG);
-    sigaddset(&mask, SIGUSR1);
-    sigaddset(&mask, SIGUSR2);
+        const std::string range = str.substr(pos, end - pos);
+        const std::size_t dash = range.find('-');
 
-    pthread_sigmask(SIG_BLOCK, &mask, 0);
+        try
+        {
+            const auto first = std::stoul(range.substr(0, dash));
+            const auto last = dash == std::string::npos
+                ? first : std::stoul(range.substr(dash + 1));
+
+            for (auto cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(static_cast<unsigned int>(cpu));
+        }
+        catch (const std::exception&)
+        {
+            // Ignore malformed entries (including empty ones)
+        }
+
+        pos = end + 1;
+    }
+
+    return cpus;
+}
+
+// Return the CPUs of each NUMA node of the system, or an empty vector if unknown.
+std::vector<std::vector<unsigned int>> get_numa_cpu_sets()
+{
+    std::vector<std::vector<unsigned int>> cpu_sets;
+
+    std::ifstream online_file{ "/sys/devices/system/node/online" };
+    std::string online;
+    if (!std::getline(online_file, online))
+        return cpu_sets;
+
+    for (unsigned int node : parse_cpu_list(online))
+    {
+        std::ifstream cpu_file{ cat("/sys/devices/system/node/node", node, "/cpulist") };
+        std::string cpu_list;
+        if (!std::getline(cpu_file, cpu_list))
+            continue;
+
+        auto cpus = parse_cpu_list(cpu_list);
+        if (!cpus.empty())
+            cpu_sets.push_back(std::move(cpus));
+    }
+
+    return cpu_sets;
+}
+
+// Pin the calling thread to the given CPUs if supported (errors are ignored).
+void pin_current_thread(const std::vector<unsigned int>& cpus)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (unsigned int cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpus;
 #endif
+}
 
-    // Assign thread-local thread ID
-    thread_id_ = thread_id;
+} // anonymous namespace
 
-    std::unique_lock<std::mutex> lock(mutex_);
 
-    while (!shutdown_requested_)
+//
+// ThreadPool::DependentTask
+//
+
+/**
+ * A task that waits for its predecessors to finish. It is kept alive by the
+ * continuations registered with the predecessors, one of which hands the task over to
+ * the pool: In "all" mode, this is the last predecessor to finish; in "any" mode, it is
+ * the first one to complete (or the last one if all of them are canceled).
+ */
+struct ThreadPool::DependentTask
+{
+    struct Continuation : detail::TaskContinuation
     {
-        // mutex is locked
-        if (pending_tasks_.empty())
+        explicit Continuation(std::shared_ptr<DependentTask> dependent)
+            : dependent_{ std::move(dependent) }
+        {}
+
+        void run(TaskState final_state) noexcept override
         {
-            cv_.wait(lock); // acquires the lock when done
-            continue;
+            dependent_->on_predecessor_finished(final_state);
+        }
+
+        std::shared_ptr<DependentTask> dependent_;
+    };
+
+    DependentTask(ThreadPool& pool, Task&& task, std::size_t num_predecessors,
+        TaskDependencies::Mode mode)
+        : pool_(pool)
+        , task_{ std::move(task) }
+        , num_unfinished_predecessors_{ num_predecessors }
+        , mode_{ mode }
+    {}
+
+    void on_predecessor_finished(TaskState final_state) noexcept
+    {
+        if (mode_ == TaskDependencies::Mode::any)
+        {
+            const bool is_last =
+                num_unfinished_predecessors_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            const bool is_complete = final_state == TaskState::complete;
+
+            if ((is_complete || is_last)
+                && !released_.exchange(true, std::memory_order_acq_rel))
+            {
+                pool_.release_dependent_task(task_, !is_complete);
+            }
+            return;
         }
 
-        const auto now = std::chrono::system_clock::now();
-        auto task_it = std::find_if(pending_tasks_.begin(), pending_tasks_.end(),
-            [now](const Task& t) { return t.start_time_ <= now; });
+        if (final_state != TaskState::complete)
+            predecessor_canceled_ = true;
+
+        if (num_unfinished_predecessors_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            pool_.release_dependent_task(task_, predecessor_canceled_);
+    }
+
+    ThreadPool& pool_;
+    Task task_;
+    std::atomic<std::size_t> num_unfinished_predecessors_;
+    std::atomic<bool> predecessor_canceled_{ false };
+    std::atomic<bool> released_{ false };
+    const TaskDependencies::Mode mode_;
+};
+
+
+//
+// ThreadPool::TimerWheel
+//
+
+/**
+ * A hierarchical timer wheel for delayed tasks.
+ *
+ * Time is divided into ticks of one millisecond, counted from the construction of the
+ * wheel. The wheel has four levels of 256 slots each. A task that is due less than 256
+ * ticks after the current tick is stored on level 0 in the slot for its exact tick; tasks
+ * that are due further in the future are stored on level 1, 2, or 3 with a resolution of
+ * 256, 256^2, or 256^3 ticks. Whenever the current tick crosses a slot boundary of a
+ * higher level, the tasks of that slot are redistributed ("cascaded") to the lower
+ * levels. Tasks that are due more than 2^32 ticks (about 50 days) in the future are
+ * parked in the last slot of level 3 that can be reached and cascaded repeatedly.
+ *
+ * Inserting a task is a constant-time operation. The wheel is not thread-safe; it is
+ * protected by the mutex of the thread pool.
+ */
+class ThreadPool::TimerWheel
+{
+public:
+    TimerWheel() : origin_{ std::chrono::steady_clock::now() }
+    {}
+
+    /**
+     * Move all tasks that are due at the given time to the ready queue.
+     *
+     * \returns the time at which the wheel needs to be advanced again, or
+     *          SteadyTimePoint::max() if the wheel is empty.
+     */
+    SteadyTimePoint advance(SteadyTimePoint now, TaskQueue& ready_tasks)
+    {
+        const Tick target = get_tick_before(now);
+
+        if (size_ == 0)
+        {
+            current_ = std::max(current_, target);
+            return SteadyTimePoint::max();
+        }
 
-        if (task_it == pending_tasks_.end())
+        while (current_ < target)
         {
-            task_it = std::min_element(pending_tasks_.begin(), pending_tasks_.end(),
-                [](const Task& a, const Task& b) { return a.start_time_ < b.start_time_; });
+            if (sizes_[0] == 0)
+            {
+                // Nothing on level 0: Skip ahead to the tick before the next cascade
+                const Tick last_before_cascade = current_ | (num_slots - 1);
+                if (last_before_cascade >= target)
+                {
+                    current_ = target;
+                    break;
+                }
+                current_ = last_before_cascade;
+            }
 
-            // Note: We may not pass task_it->start_time_ directly to wait_until() because
-            // it may get invalidated when the mutex is unlocked.
-            const auto start_time = task_it->start_time_;
+            const Tick tick = current_ + 1;
 
-            cv_.wait_until(lock, start_time); // acquires the lock when done
-            continue;
+            // Cascaded tasks are placed relative to the tick being processed, so that a
+            // task due less than 256 ticks from now goes to level 0 and not back into
+            // the slot that has just been emptied. Tasks due at this very tick end up in
+            // the level 0 slot that is emptied below.
+            current_ = tick;
+
+            for (std::size_t level = 1; level != num_levels; ++level)
+            {
+                if ((tick & ((Tick{ 1 } << (level * bits_per_level)) - 1)) != 0)
+                    break;
+                cascade(level, get_slot_index(tick, level));
+            }
+
+            auto& slot = slots_[0][get_slot_index(tick, 0)];
+            for (Task& task : slot)
+                ready_tasks.push_back(std::move(task));
+            sizes_[0] -= slot.size();
+            size_ -= slot.size();
+            slot.clear();
         }
 
-        auto named_task_ptr = std::move(task_it->named_task_);
-        auto id = task_it->id_;
-        auto name = std::move(named_task_ptr->name_);
-        pending_tasks_.erase(task_it);
+        return get_next_expiry();
+    }
 
-        running_task_ids_.push_back(id);
-        running_task_names_.push_back(name);
+    /// Discard all tasks.
+    void clear()
+    {
+        for (auto& level : slots_)
+        {
+            for (auto& slot : level)
+                slot.clear();
+        }
+        sizes_.fill(0);
+        size_ = 0;
+    }
 
-        lock.unlock();
+    /// Call the given function for each task in the wheel.
+    template <typename Function>
+    void for_each(Function fct)
+    {
+        for (auto& level : slots_)
+        {
+            for (auto& slot : level)
+                std::for_each(slot.begin(), slot.end(), fct);
+        }
+    }
 
-        try
+    /// Call the given function for each task in the wheel.
+    template <typename Function>
+    void for_each(Function fct) const
+    {
+        for (const auto& level : slots_)
         {
-            (*named_task_ptr)(*this);
+            for (const auto& slot : level)
+                std::for_each(slot.begin(), slot.end(), fct);
         }
-        catch (...)
+    }
+
+    /**
+     * Insert a task into the wheel.
+     *
+     * \returns true if the task was inserted, or false if it is already due (in which
+     *          case it is left untouched).
+     */
+    bool insert(Task& task)
+    {
+        if (size_ == 0)
         {
-            // This should not happen because the packaged_task should catch all
-            // exceptions itself. But in case of something unexpected, we'll try
-            // to continue...
+            current_ = std::max(current_,
+                get_tick_before(std::chrono::steady_clock::now()));
         }
 
-        lock.lock();
+        if (task.start_time_ <= origin_)
+            return false;
 
-        auto it = std::find(running_task_ids_.begin(), running_task_ids_.end(), id);
-        if (it != running_task_ids_.end())
+        const Tick due = get_tick_after(task.start_time_);
+        if (due <= current_)
+            return false;
+
+        place(std::move(task), due);
+        return true;
+    }
+
+    /**
+     * Remove all tasks for which the given predicate returns true.
+     * \returns the number of removed tasks.
+     */
+    template <typename Predicate>
+    std::size_t remove_if(Predicate pred)
+    {
+        std::size_t num_removed = 0;
+
+        for (std::size_t level = 0; level != num_levels; ++level)
         {
-            const auto idx = it - running_task_ids_.begin();
-            running_task_ids_.erase(it);
-            running_task_names_.erase(running_task_names_.begin() + idx);
+            for (auto& slot : slots_[level])
+            {
+                auto it = std::remove_if(slot.begin(), slot.end(), pred);
+                const auto num = static_cast<std::size_t>(slot.end() - it);
+                slot.erase(it, slot.end());
+                sizes_[level] -= num;
+                num_removed += num;
+            }
         }
+
+        size_ -= num_removed;
+        return num_removed;
     }
-}
 
-thread_local ThreadPool::ThreadId
-ThreadPool::thread_id_{ std::numeric_limits<ThreadPool::ThreadId>::max() };
+    /// Return the number of tasks in the wheel.
+    std::size_t size() const noexcept { return size_; }
+
+private:
+    using Tick = std::uint64_t;
+    using TickDuration = std::chrono::milliseconds;
+
+    static constexpr std::size_t bits_per_level = 8;
+    static constexpr std::size_t num_levels = 4;
+    static constexpr std::size_t num_slots = std::size_t{ 1 } << bits_per_level;
+    static constexpr Tick max_delta = (Tick{ 1 } << (bits_per_level * num_levels)) - 1;
+
+    const SteadyTimePoint origin_; // Start of tick 0
+    Tick current_{ 0 }; // Last tick whose tasks have been moved to the ready queue
+    std::size_t size_{ 0 }; // Total number of tasks in the wheel
+    std::array<std::size_t, num_levels> sizes_{}; // Number of tasks per level
+    std::array<std::array<std::vector<Task>, num_slots>, num_levels> slots_;
+
+    // Redistribute the tasks from the given slot to the lower levels.
+    void cascade(std::size_t level, std::size_t slot_index)
+    {
+        std::vector<Task> tasks;
+        tasks.swap(slots_[level][slot_index]);
+        sizes_[level] -= tasks.size();
+        size_ -= tasks.size();
+
+        for (Task& task : tasks)
+            place(std::move(task), get_tick_after(task.start_time_));
+    }
+
+    // Return the time at which the next task becomes due or the next cascade is needed.
+    SteadyTimePoint get_next_expiry() const
+    {
+        if (size_ == 0)
+            return SteadyTimePoint::max();
+
+        const Tick next_cascade = (current_ | (num_slots - 1)) + 1;
+        Tick next = size_ == sizes_[0] ? current_ + num_slots : next_cascade;
+
+        if (sizes_[0] != 0)
+        {
+            for (Tick tick = current_ + 1; tick < next; ++tick)
+            {
+                if (!slots_[0][get_slot_index(tick, 0)].empty())
+                {
+                    next = tick;
+                    break;
+                }
+            }
+        }
+
+        return origin_ + TickDuration{ next };
+    }
+
+    static std::size_t get_slot_index(Tick tick, std::size_t level) noexcept
+    {
+        return static_cast<std::size_t>(tick >> (level * bits_per_level))
+            & (num_slots - 1);
+    }
+
+    // Return the last tick that has started at or before the given time.
+    Tick get_tick_before(SteadyTimePoint t) const
+    {
+        if (t <= origin_)
+            return 0;
+        return static_cast<Tick>(
+            std::chrono::duration_cast<TickDuration>(t - origin_).count());
+    }
+
+    // Return the first tick that starts at or after the given time.
+    Tick get_tick_after(SteadyTimePoint t) const
+    {
+        const auto delta = t - origin_;
+        auto ticks = std::chrono::duration_cast<TickDuration>(delta);
+        if (ticks < delta)
+            ++ticks;
+        return static_cast<Tick>(ticks.count());
+    }
+
+    // Store a task in the slot for the given tick (which must not be earlier than
+    // current_).
+    void place(Task&& task, Tick due)
+    {
+        if (due < current_)
+            due = current_;
+        else if (due - current_ > max_delta)
+            due = current_ + max_delta;
+
+        const Tick delta = due - current_;
+
+        std::size_t level = 0;
+        while (level + 1 != num_levels
+            && delta >= (Tick{ 1 } << ((level + 1) * bits_per_level)))
+        {
+            ++level;
+        }
+
+        slots_[level][get_slot_index(due, level)].push_back(std::move(task));
+        ++sizes_[level];
+        ++size_;
+    }
+};
+
+
+//
+// ThreadPool::Strand::State
+//
+
+/**
+ * The state of a strand. A strand is active while one of its tasks is in the shared
+ * queue of the pool or running; its later tasks wait in the queue of the strand. All
+ * members are protected by the mutex of the thread pool.
+ */
+struct ThreadPool::Strand::State
+{
+    /// Value of active_index_ for a strand that is not active
+    constexpr static std::size_t inactive = std::numeric_limits<std::size_t>::max();
+
+    /// Tasks waiting for their predecessor in the strand to finish
+    TaskQueue queue_;
+
+    /// Index of the strand in ThreadPool::active_strands_, or inactive
+    std::size_t active_index_{ inactive };
+};
+
+/**
+ * The state of a task group: An intrusive list of the memberships of all unfinished
+ * tasks in the group.
+ */
+struct ThreadPool::TaskGroup::State
+{
+    std::mutex mutex_; // Protects members_ and is used together with cv_
+    std::condition_variable cv_;
+
+    /// First membership in the list of unfinished tasks
+    Member* members_{ nullptr };
+
+    /// Number of unfinished tasks (only modified with the mutex locked)
+    std::atomic<std::size_t> num_unfinished_{ 0 };
+};
+
+/**
+ * The membership of a task in a task group. It is registered as a continuation of the
+ * task, so that the task leaves the group when it finishes in whatever way.
+ */
+struct ThreadPool::TaskGroup::Member : detail::TaskContinuation
+{
+    explicit Member(std::shared_ptr<State> group)
+        : group_{ std::move(group) }
+    {}
+
+    // Leave the group if the task is destroyed without having been finished
+    ~Member() override { leave(); }
+
+    void run(TaskState) noexcept override { leave(); }
+
+    /**
+     * Mark the task as enqueued, so that TaskGroup::cancel() can cancel it directly.
+     * Return true if the group has been canceled since the task joined it.
+     */
+    bool activate() noexcept
+    {
+        std::lock_guard<std::mutex> lock(group_->mutex_);
+        is_enqueued_ = true;
+        return is_cancel_pending_;
+    }
+
+    /// Insert the membership at the front of the list of the group.
+    void join(const std::shared_ptr<detail::TaskControlBlock>& control) noexcept
+    {
+        control_ = control;
+
+        std::lock_guard<std::mutex> lock(group_->mutex_);
+        next_member_ = group_->members_;
+        if (next_member_)
+            next_member_->prev_member_ = this;
+        group_->members_ = this;
+        ++group_->num_unfinished_;
+        is_joined_ = true;
+    }
+
+    /// Remove the membership from the list and wake up waiters if it was the last one.
+    void leave() noexcept
+    {
+        if (!is_joined_)
+            return;
+        is_joined_ = false;
+
+        std::lock_guard<std::mutex> lock(group_->mutex_);
+        if (prev_member_)
+            prev_member_->next_member_ = next_member_;
+        else
+            group_->members_ = next_member_;
+        if (next_member_)
+            next_member_->prev_member_ = prev_member_;
+
+        if (--group_->num_unfinished_ == 0)
+            group_->cv_.notify_all();
+    }
+
+    std::shared_ptr<State> group_;
+    std::weak_ptr<detail::TaskControlBlock> control_;
+    Member* prev_member_{ nullptr }; // Protected by the mutex of the group
+    Member* next_member_{ nullptr }; // Protected by the mutex of the group
+    bool is_enqueued_{ false }; // Protected by the mutex of the group
+    bool is_cancel_pending_{ false }; // Protected by the mutex of the group
+    bool is_joined_{ false }; // Only accessed by the owner of the membership
+};
+
+
+//
+// ThreadPool
+//
+
+ThreadPool::ThreadPool(const ThreadPoolOptions& options)
+    : capacity_(options.capacity)
+    , work_stealing_(options.work_stealing)
+    , measure_task_times_(options.measure_task_times)
+    , earliest_deadline_first_(options.earliest_deadline_first)
+    , trace_buffer_size_(options.trace_buffer_size)
+{
+    const std::size_t num_threads = options.num_threads;
+
+    if (num_threads == 0 || num_threads > max_threads)
+    {
+        throw std::invalid_argument(
+            cat("Illegal number of threads for thread pool: ", num_threads));
+    }
+
+    if (capacity_ == 0 || capacity_ > max_capacity)
+        throw std::invalid_argument(cat("Illegal capacity for thread pool: ", capacity_));
+
+    min_num_threads_ = options.min_num_threads == 0
+        ? num_threads : options.min_num_threads;
+    max_num_threads_ = options.max_num_threads == 0
+        ? num_threads : options.max_num_threads;
+
+    if (min_num_threads_ > num_threads || max_num_threads_ < num_threads
+        || max_num_threads_ > max_threads)
+    {
+        throw std::invalid_argument(cat("Illegal thread limits for thread pool: ",
+            min_num_threads_, " to ", max_num_threads_, " (with ", num_threads,
+            " initial threads)"));
+    }
+
+    using SteadyDuration = std::chrono::steady_clock::duration;
+    queue_wait_threshold_ = std::max(SteadyDuration::zero(),
+        std::chrono::duration_cast<SteadyDuration>(options.queue_wait_threshold));
+    idle_timeout_ = std::max(SteadyDuration::zero(),
+        std::chrono::duration_cast<SteadyDuration>(options.idle_timeout));
+    spin_duration_ = std::max(SteadyDuration::zero(),
+        std::chrono::duration_cast<SteadyDuration>(options.spin_duration));
+
+    if (options.timer_wheel)
+        timer_wheel_ = std::make_unique<TimerWheel>();
+
+    auto cpu_sets = options.cpu_sets;
+
+    if (options.numa_groups)
+    {
+        if (!cpu_sets.empty())
+            throw std::invalid_argument("CPU sets cannot be combined with NUMA groups");
+
+        cpu_sets = get_numa_cpu_sets();
+        if (cpu_sets.size() > min_num_threads_)
+            cpu_sets.resize(min_num_threads_);
+    }
+
+    if (cpu_sets.size() > min_num_threads_)
+    {
+        throw std::invalid_argument(cat("Thread pool needs at least one thread per CPU "
+            "set (", cpu_sets.size(), " CPU sets, ", min_num_threads_, " threads)"));
+    }
+
+    for (auto& cpu_set : cpu_sets)
+    {
+        if (cpu_set.empty())
+            throw std::invalid_argument("Empty CPU set for thread pool");
+
+        std::sort(cpu_set.begin(), cpu_set.end());
+        cpu_set.erase(std::unique(cpu_set.begin(), cpu_set.end()), cpu_set.end());
+    }
+
+    const std::size_t num_groups = std::max<std::size_t>(cpu_sets.size(), 1);
+    worker_group_tasks_.resize(num_groups);
+
+    workers_.reserve(max_num_threads_);
+    for (std::size_t i = 0; i != max_num_threads_; ++i)
+    {
+        workers_.push_back(std::make_unique<Worker>());
+        workers_.back()->worker_group_ = i % num_groups;
+        if (!cpu_sets.empty())
+            workers_.back()->cpu_set_ = cpu_sets[i % num_groups];
+        workers_.back()->trace_events_.resize(trace_buffer_size_);
+    }
+
+    threads_.resize(max_num_threads_);
+    num_threads_ = num_threads;
+
+    std::lock_guard<std::mutex> threads_lock(threads_mutex_);
+    start_worker_threads();
+}
+
+ThreadPool::~ThreadPool()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    shutdown_requested_ = true;
+    lock.unlock();
+    cv_.notify_all();
+
+    // Exiting workers briefly lock threads_mutex_, so we must not hold it while joining
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> threads_lock(threads_mutex_);
+        threads.swap(threads_);
+    }
+
+    for (auto& t : threads)
+    {
+        if (t.joinable())
+            t.join();
+    }
+
+    // Mark all tasks that have not been started as canceled
+    cancel_pending_tasks();
+}
+
+void ThreadPool::activate_task_group_member(
+    std::unique_ptr<detail::TaskContinuation> member,
+    const std::shared_ptr<detail::TaskControlBlock>& control) noexcept
+{
+    const bool must_cancel = static_cast<TaskGroup::Member&>(*member).activate();
+
+    // If the task has already finished, it leaves the group again right away
+    control->add_continuation(std::move(member));
+
+    if (must_cancel && !cancel_pending_task(*control))
+        control->cancel_requested_.store(true, std::memory_order_release);
+}
+
+void ThreadPool::advance_strand(Strand::State& strand) noexcept
+{
+    Task next;
+
+    for (;;)
+    {
+        {
+            std::shared_ptr<Strand::State> retired; // released after unlocking
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            auto& queue = strand.queue_;
+            while (!queue.empty() && queue.front().is_canceled())
+            {
+                queue.pop_front();
+                --num_canceled_;
+            }
+
+            if (queue.empty())
+            {
+                retired = deactivate_strand_i(strand);
+                return;
+            }
+
+            next = std::move(queue.front());
+            queue.pop_front();
+
+            if (must_record_ready_time())
+                next.start_time_ = std::chrono::steady_clock::now();
+
+            try
+            {
+                ready_tasks_.push_back(std::move(next));
+                next = Task{};
+            }
+            catch (...)
+            {
+                // Out of memory: Cancel the task below and continue with the next one
+            }
+        }
+
+        if (!next.control_)
+        {
+            notify_one_worker();
+            return;
+        }
+
+        cancel_pending_task(*next.control_);
+        --num_canceled_; // The task does not occupy a place in any queue
+        next = Task{};
+    }
+}
+
+bool ThreadPool::cancel_pending_task(detail::TaskControlBlock& control)
+{
+    auto expected = TaskState::pending;
+    if (!control.state_.compare_exchange_strong(expected, TaskState::canceled,
+            std::memory_order_acq_rel))
+    {
+        return false;
+    }
+
+    release_pending_slots();
+    ++num_canceled_;
+    num_tasks_canceled_.fetch_add(1, std::memory_order_relaxed);
+
+    control.run_continuations();
+
+    return true;
+}
+
+std::size_t ThreadPool::cancel_pending_batch(detail::BatchState& batch)
+{
+    batch.canceled_.store(true, std::memory_order_relaxed);
+
+    const std::size_t num_canceled =
+        batch.num_unstarted_.exchange(0, std::memory_order_acq_rel);
+
+    if (num_canceled == 0)
+        return 0;
+
+    release_pending_slots(num_canceled);
+    num_canceled_ += static_cast<std::ptrdiff_t>(num_canceled);
+    num_tasks_canceled_.fetch_add(num_canceled, std::memory_order_relaxed);
+    batch.finish(num_canceled);
+
+    return num_canceled;
+}
+
+std::size_t ThreadPool::cancel_pending_tasks()
+{
+    std::size_t num_removed = 0;
+    std::vector<std::shared_ptr<Strand::State>> retired_strands; // released when unlocked
+
+    const auto discard = [this, &num_removed](Task& t)
+        {
+            if (t.control_)
+            {
+                if (cancel_pending_task(*t.control_))
+                    ++num_removed;
+
+                // The canceled task is removed from its queue right away
+                --num_canceled_;
+            }
+            else if (t.batch_)
+            {
+                if (t.batch_->try_claim())
+                {
+                    release_pending_slots();
+                    num_tasks_canceled_.fetch_add(1, std::memory_order_relaxed);
+                    ++num_removed;
+                    t.batch_->finish(1);
+                }
+                else
+                {
+                    --num_canceled_; // The batch had been canceled before
+                }
+            }
+            else
+            {
+                release_pending_slots();
+                num_tasks_canceled_.fetch_add(1, std::memory_order_relaxed);
+                ++num_removed;
+            }
+        };
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Strands whose current task is still in the shared queue become inactive. Those
+    // with a running task are advanced (to an empty queue) when it finishes.
+    for (const auto& strand : active_strands_)
+    {
+        std::for_each(strand->queue_.begin(), strand->queue_.end(), discard);
+        strand->queue_.clear();
+    }
+
+    for (const Task& t : ready_tasks_)
+    {
+        if (t.strand_)
+            retired_strands.push_back(deactivate_strand_i(*t.strand_));
+    }
+
+    std::for_each(ready_tasks_.begin(), ready_tasks_.end(), discard);
+    ready_tasks_.clear();
+
+    std::for_each(deadline_tasks_.begin(), deadline_tasks_.end(), discard);
+    deadline_tasks_.clear();
+
+    for (auto& group_queue : worker_group_tasks_)
+    {
+        std::for_each(group_queue.begin(), group_queue.end(), discard);
+        group_queue.clear();
+    }
+
+    std::for_each(delayed_tasks_.begin(), delayed_tasks_.end(), discard);
+    delayed_tasks_.clear();
+
+    if (timer_wheel_)
+    {
+        timer_wheel_->for_each(discard);
+        timer_wheel_->clear();
+    }
+
+    for (auto& worker_ptr : workers_)
+    {
+        Worker& worker = *worker_ptr;
+        std::lock_guard<std::mutex> worker_lock(worker.mutex_);
+
+        std::for_each(worker.local_tasks_.begin(), worker.local_tasks_.end(), discard);
+        num_local_tasks_ -= worker.local_tasks_.size();
+        worker.local_tasks_.clear();
+        worker.num_local_tasks_ = 0;
+    }
+
+    return num_removed;
+}
+
+std::size_t ThreadPool::count_pending() const
+{
+    return num_pending_;
+}
+
+std::size_t ThreadPool::count_threads() const noexcept
+{
+    return num_threads_;
+}
+
+std::size_t ThreadPool::count_worker_groups() const noexcept
+{
+    return worker_group_tasks_.size();
+}
+
+void ThreadPool::enqueue_periodic_task(TaskFunction fct,
+    std::shared_ptr<detail::PeriodicControlBlock> control,
+    SteadyTimePoint first_start_time, TaskName name)
+{
+    reserve_pending_slots();
+
+    Task task{ next_task_id_++, std::move(fct), control, first_start_time,
+        std::move(name) };
+    task.periodic_ = control.get();
+
+    try
+    {
+        push_task(std::move(task));
+    }
+    catch (...)
+    {
+        release_pending_slots();
+        throw;
+    }
+}
+
+std::shared_ptr<ThreadPool::Strand::State>
+ThreadPool::deactivate_strand_i(Strand::State& strand) noexcept
+{
+    const std::size_t index = strand.active_index_;
+    strand.active_index_ = Strand::State::inactive;
+
+    auto retired = std::move(active_strands_[index]);
+
+    if (index + 1 != active_strands_.size())
+    {
+        active_strands_[index] = std::move(active_strands_.back());
+        active_strands_[index]->active_index_ = index;
+    }
+    active_strands_.pop_back();
+
+    return retired;
+}
+
+ThreadPool::TaskId
+ThreadPool::enqueue_task(TaskFunction fct,
+    std::shared_ptr<detail::TaskControlBlock> control, TaskName name,
+    const SubmitOptions& options)
+{
+    if (options.strand)
+    {
+        const Strand* strand = options.strand;
+        const auto self = shared_from_this();
+
+        if (!strand->state_)
+            throw std::invalid_argument("Strand is not associated with a thread pool");
+
+        if (strand->pool_.owner_before(self) || self.owner_before(strand->pool_))
+            throw std::invalid_argument("Strand belongs to another thread pool");
+
+        reserve_pending_slots();
+
+        const TaskId id = next_task_id_++;
+
+        try
+        {
+            Task task{ id, std::move(fct), std::move(control), options.start_time,
+                std::move(name) };
+            task.deadline_ = options.deadline;
+            push_strand_task(std::move(task), *strand);
+        }
+        catch (...)
+        {
+            release_pending_slots();
+            throw;
+        }
+
+        return id;
+    }
+
+    const TaskDependencies* dependencies = options.dependencies;
+    if (dependencies && !dependencies->empty())
+    {
+        const auto& predecessors = dependencies->predecessors_;
+        const auto self = shared_from_this();
+
+        for (const auto& predecessor : predecessors)
+        {
+            if (predecessor.pool_.owner_before(self)
+                || self.owner_before(predecessor.pool_))
+            {
+                throw std::invalid_argument(
+                    "Dependencies must be tasks on the same thread pool");
+            }
+        }
+
+        reserve_pending_slots();
+
+        const TaskId id = next_task_id_++;
+        std::vector<std::unique_ptr<detail::TaskContinuation>> continuations;
+
+        try
+        {
+            Task task{ id, std::move(fct), std::move(control), options.start_time,
+                std::move(name) };
+            task.deadline_ = options.deadline;
+
+            auto dependent = std::make_shared<DependentTask>(*this, std::move(task),
+                predecessors.size(), dependencies->get_mode());
+
+            continuations.reserve(predecessors.size());
+            for (std::size_t i = 0; i != predecessors.size(); ++i)
+            {
+                continuations.push_back(
+                    std::make_unique<DependentTask::Continuation>(dependent));
+            }
+        }
+        catch (...)
+        {
+            release_pending_slots();
+            throw;
+        }
+
+        // The last predecessor to finish releases the task (possibly right here)
+        for (std::size_t i = 0; i != predecessors.size(); ++i)
+            predecessors[i].control_->add_continuation(std::move(continuations[i]));
+
+        return id;
+    }
+
+    reserve_pending_slots();
+
+    return enqueue_reserved_task(std::move(fct), std::move(control), std::move(name),
+        options);
+}
+
+ThreadPool::TaskId
+ThreadPool::enqueue_reserved_task(TaskFunction fct,
+    std::shared_ptr<detail::TaskControlBlock> control, TaskName name,
+    const SubmitOptions& options)
+{
+    const TaskId id = next_task_id_++;
+
+    try
+    {
+        Task task{ id, std::move(fct), std::move(control), options.start_time,
+            std::move(name) };
+        task.worker_group_ = options.worker_group;
+        task.deadline_ = options.deadline;
+        push_task(std::move(task));
+    }
+    catch (...)
+    {
+        release_pending_slots();
+        throw;
+    }
+
+    return id;
+}
+
+void ThreadPool::enqueue_tasks(std::vector<Task>& tasks)
+{
+    const std::size_t num_tasks = tasks.size();
+    if (num_tasks == 0)
+        return;
+
+    const auto assign_ids = [this, &tasks]()
+        {
+            TaskId id = next_task_id_.fetch_add(tasks.size());
+            for (Task& task : tasks)
+                task.id_ = id++;
+        };
+
+    if (work_stealing_ && thread_pool_ == this)
+    {
+        reserve_pending_slots(num_tasks);
+
+        Worker& worker = *workers_[thread_id_];
+
+        try
+        {
+            std::lock_guard<std::mutex> worker_lock(worker.mutex_);
+            worker.local_tasks_.reserve(num_tasks);
+            assign_ids();
+            for (Task& task : tasks)
+                worker.local_tasks_.push_back(std::move(task));
+            worker.num_local_tasks_ += num_tasks;
+        }
+        catch (...)
+        {
+            release_pending_slots(num_tasks);
+            throw;
+        }
+
+        num_local_tasks_ += num_tasks;
+        wake_sleeping_workers(num_tasks);
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (must_purge_canceled_tasks())
+            purge_canceled_tasks();
+
+        reserve_pending_slots(num_tasks);
+
+        try
+        {
+            ready_tasks_.reserve(num_tasks);
+        }
+        catch (...)
+        {
+            release_pending_slots(num_tasks);
+            throw;
+        }
+
+        assign_ids();
+
+        if (must_record_ready_time())
+        {
+            const auto now = std::chrono::steady_clock::now();
+            for (Task& task : tasks)
+                task.start_time_ = now;
+        }
+
+        for (Task& task : tasks)
+            ready_tasks_.push_back(std::move(task)); // cannot throw after reserve()
+    }
+
+    signal_spinning_worker();
+
+    if (num_tasks >= num_threads_)
+    {
+        cv_.notify_all();
+    }
+    else
+    {
+        for (std::size_t i = 0; i != num_tasks; ++i)
+            cv_.notify_one();
+    }
+}
+
+void ThreadPool::expire_task(Task& task) noexcept
+{
+    // Only tasks with a TaskHandle can have a deadline
+    auto expected = TaskState::pending;
+    if (!task.control_->state_.compare_exchange_strong(expected, TaskState::expired,
+            std::memory_order_acq_rel))
+    {
+        // The task has been canceled while waiting in the queue
+        --num_canceled_;
+        return;
+    }
+
+    release_pending_slots();
+    num_tasks_expired_.fetch_add(1, std::memory_order_relaxed);
+
+    task.control_->run_continuations();
+}
+
+ThreadPool::CancellationToken ThreadPool::get_cancellation_token() const
+{
+    if (thread_pool_ != this || running_task_ == nullptr)
+        throw std::runtime_error("This thread is not executing a task of the pool");
+
+    const Task& task = *running_task_;
+
+    // The token shares ownership of the state that holds its flag
+    if (task.periodic_)
+    {
+        return CancellationToken{ std::shared_ptr<const std::atomic<bool>>{
+            task.control_, &task.periodic_->stop_requested_ } };
+    }
+    if (task.control_)
+    {
+        return CancellationToken{ std::shared_ptr<const std::atomic<bool>>{
+            task.control_, &task.control_->cancel_requested_ } };
+    }
+    if (task.batch_)
+    {
+        return CancellationToken{ std::shared_ptr<const std::atomic<bool>>{
+            task.batch_, &task.batch_->canceled_ } };
+    }
+
+    return CancellationToken{};
+}
+
+bool ThreadPool::get_next_task(Worker& worker, Task& task)
+{
+    while (wait_for_task(worker, task))
+    {
+        if (start_task(worker, task))
+            return true;
+
+        if (task.strand_)
+            advance_strand(*task.strand_);
+
+        task = Task{};
+    }
+
+    return false;
+}
+
+std::vector<std::string> ThreadPool::get_pending_task_names() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::vector<std::string> names;
+    const std::size_t num_delayed = delayed_tasks_.size()
+        + (timer_wheel_ ? timer_wheel_->size() : 0);
+    names.reserve(deadline_tasks_.size() + ready_tasks_.size() + num_delayed);
+
+    for (const Task& t : deadline_tasks_)
+    {
+        if (!t.is_canceled())
+            names.emplace_back(t.name_.c_str());
+    }
+
+    for (const Task& t : ready_tasks_)
+    {
+        if (!t.is_canceled())
+            names.emplace_back(t.name_.c_str());
+    }
+
+    for (const auto& group_queue : worker_group_tasks_)
+    {
+        for (const Task& t : group_queue)
+        {
+            if (!t.is_canceled())
+                names.emplace_back(t.name_.c_str());
+        }
+    }
+
+    for (const auto& strand : active_strands_)
+    {
+        for (const Task& t : strand->queue_)
+        {
+            if (!t.is_canceled())
+                names.emplace_back(t.name_.c_str());
+        }
+    }
+
+    // List delayed tasks in the order in which they are going to be started
+    std::vector<const Task*> delayed;
+    delayed.reserve(num_delayed);
+    const auto add_delayed = [&delayed](const Task& t)
+        {
+            if (!t.is_canceled())
+                delayed.push_back(&t);
+        };
+    std::for_each(delayed_tasks_.begin(), delayed_tasks_.end(), add_delayed);
+    if (timer_wheel_)
+        timer_wheel_->for_each(add_delayed);
+
+    std::sort(delayed.begin(), delayed.end(),
+        [](const Task* a, const Task* b) { return is_later(*b, *a); });
+
+    for (const Task* t : delayed)
+        names.emplace_back(t->name_.c_str());
+
+    for (auto& worker_ptr : workers_)
+    {
+        std::lock_guard<std::mutex> worker_lock(worker_ptr->mutex_);
+        for (const Task& t : worker_ptr->local_tasks_)
+        {
+            if (!t.is_canceled())
+                names.emplace_back(t.name_.c_str());
+        }
+    }
+
+    return names;
+}
+
+std::vector<std::string> ThreadPool::get_running_task_names() const
+{
+    std::vector<std::string> names;
+
+    for (auto& worker_ptr : workers_)
+    {
+        std::lock_guard<std::mutex> worker_lock(worker_ptr->mutex_);
+        if (worker_ptr->is_running_)
+            names.emplace_back(worker_ptr->running_task_name_.c_str());
+    }
+
+    return names;
+}
+
+ThreadPoolStatistics ThreadPool::get_statistics() const
+{
+    ThreadPoolStatistics stats;
+
+    stats.num_submitted = next_task_id_.load(std::memory_order_relaxed);
+    stats.num_canceled = num_tasks_canceled_.load(std::memory_order_relaxed);
+    stats.num_expired = num_tasks_expired_.load(std::memory_order_relaxed);
+    stats.workers.resize(workers_.size());
+
+    const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+
+    for (std::size_t i = 0; i != workers_.size(); ++i)
+    {
+        const auto& counters = workers_[i]->counters_;
+        auto& worker_stats = stats.workers[i];
+
+        stats.num_started += counters.num_started_.load(std::memory_order_relaxed);
+        worker_stats.num_completed =
+            counters.num_completed_.load(std::memory_order_relaxed);
+        stats.num_completed += worker_stats.num_completed;
+
+        for (std::size_t bin = 0; bin != ThreadPoolStatistics::num_bins; ++bin)
+        {
+            stats.queue_wait_times[bin] +=
+                counters.queue_wait_times_[bin].load(std::memory_order_relaxed);
+            stats.execution_times[bin] +=
+                counters.execution_times_[bin].load(std::memory_order_relaxed);
+        }
+
+        if (!measure_task_times_)
+            continue;
+
+        auto active_ticks = counters.active_ticks_.load(std::memory_order_relaxed);
+        const auto active_since = counters.active_since_.load(std::memory_order_relaxed);
+        if (active_since != 0)
+            active_ticks += now - active_since;
+
+        const auto busy_ticks = counters.busy_ticks_.load(std::memory_order_relaxed);
+
+        worker_stats.busy_time = ThreadPoolStatistics::Duration{ busy_ticks };
+        worker_stats.idle_time = ThreadPoolStatistics::Duration{
+            active_ticks > busy_ticks ? active_ticks - busy_ticks : 0 };
+    }
+
+    return stats;
+}
+
+std::string ThreadPool::get_trace_json() const
+{
+    std::string json = "{\"traceEvents\":[";
+    std::vector<Worker::TraceEvent> events;
+
+    for (std::size_t thread_id = 0; thread_id != workers_.size(); ++thread_id)
+    {
+        Worker& worker = *workers_[thread_id];
+
+        // Copy the events so that the worker is not held up by the formatting
+        {
+            std::lock_guard<std::mutex> worker_lock(worker.mutex_);
+
+            const std::size_t num_events = worker.num_trace_events_;
+            if (num_events == 0)
+                continue;
+
+            const std::size_t first =
+                num_events > trace_buffer_size_ ? num_events - trace_buffer_size_ : 0;
+
+            events.clear();
+            for (std::size_t i = first; i != num_events; ++i)
+                events.push_back(worker.trace_events_[i % trace_buffer_size_]);
+        }
+
+        if (json.back() != '[')
+            json += ',';
+
+        json += cat(R"({"name":"thread_name","ph":"M","pid":1,"tid":)", thread_id,
+            R"(,"args":{"name":"Worker )", thread_id, "\"}}");
+
+        for (const auto& event : events)
+        {
+            json += cat(R"(,{"name":")",
+                event.name_.empty() ? "(unnamed)" : escape_json(event.name_.c_str()),
+                R"(","ph":"X","pid":1,"tid":)", thread_id,
+                R"(,"ts":)", format_microseconds(event.start_time_.time_since_epoch()),
+                R"(,"dur":)", format_microseconds(event.end_time_ - event.start_time_),
+                '}');
+        }
+    }
+
+    json += R"(],"displayTimeUnit":"ms"})";
+
+    return json;
+}
+
+std::vector<unsigned int> ThreadPool::get_thread_cpu_set(ThreadId thread_id) const
+{
+    if (thread_id >= workers_.size())
+        throw std::out_of_range(cat("Invalid thread ID: ", thread_id));
+
+    return workers_[thread_id]->cpu_set_;
+}
+
+std::size_t ThreadPool::get_thread_worker_group(ThreadId thread_id) const
+{
+    if (thread_id >= workers_.size())
+        throw std::out_of_range(cat("Invalid thread ID: ", thread_id));
+
+    return workers_[thread_id]->worker_group_;
+}
+
+ThreadPool::ThreadId ThreadPool::get_thread_id() const
+{
+    if (thread_pool_ != this)
+        throw std::runtime_error("This thread is not part of the pool");
+
+    return thread_id_;
+}
+
+void ThreadPool::grow() noexcept
+{
+    if (is_growing_.exchange(true))
+        return; // Another thread is already starting a worker
+
+    {
+        std::lock_guard<std::mutex> threads_lock(threads_mutex_);
+
+        auto num_threads = num_threads_.load();
+        if (!shutdown_requested_ && num_threads < max_num_threads_
+            && num_threads_.compare_exchange_strong(num_threads, num_threads + 1))
+        {
+            try
+            {
+                start_worker_threads();
+            }
+            catch (...)
+            {
+                // Growing the pool is best effort; we simply keep the current workers.
+                --num_threads_;
+            }
+        }
+    }
+
+    is_growing_ = false;
+}
+
+bool ThreadPool::is_full() const noexcept
+{
+    return is_full_i();
+}
+
+bool ThreadPool::is_full_i() const noexcept
+{
+    return num_pending_ >= capacity_;
+}
+
+bool ThreadPool::is_idle() const
+{
+    // A task is counted as running before it stops being counted as pending, so there is
+    // no moment in which an active task is invisible to this check.
+    return num_pending_ == 0 && num_running_ == 0;
+}
+
+bool ThreadPool::has_later_deadline(const Task& a, const Task& b) noexcept
+{
+    if (a.deadline_ != b.deadline_)
+        return a.deadline_ > b.deadline_;
+    return a.id_ > b.id_;
+}
+
+bool ThreadPool::is_later(const Task& a, const Task& b) noexcept
+{
+    if (a.start_time_ != b.start_time_)
+        return a.start_time_ > b.start_time_;
+    return a.id_ > b.id_;
+}
+
+bool ThreadPool::is_shutdown_requested() const
+{
+    return shutdown_requested_;
+}
+
+
+std::shared_ptr<ThreadPool> ThreadPool::make_shared(
+    std::size_t num_threads, std::size_t capacity)
+{
+    ThreadPoolOptions options;
+    options.num_threads = num_threads;
+    options.capacity = capacity;
+    return make_shared(options);
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::make_shared(const ThreadPoolOptions& options)
+{
+    // We cannot use std::make_shared() because the constructor is private.
+    return std::shared_ptr<ThreadPool>(new ThreadPool(options));
+}
+
+void ThreadPool::set_thread_count(std::size_t num_threads)
+{
+    if (num_threads < min_num_threads_ || num_threads > max_num_threads_)
+    {
+        throw std::invalid_argument(cat("Illegal number of threads for thread pool: ",
+            num_threads, " (must be between ", min_num_threads_, " and ",
+            max_num_threads_, ")"));
+    }
+
+    {
+        std::lock_guard<std::mutex> threads_lock(threads_mutex_);
+
+        if (shutdown_requested_)
+            return;
+
+        num_threads_ = num_threads;
+        start_worker_threads();
+    }
+
+    // Wake up workers that have to retire. Briefly acquire the mutex so that the
+    // notification cannot slip in between a worker's last check and its call to wait().
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+    cv_.notify_all();
+}
+
+void ThreadPool::perform_work(const ThreadPool::ThreadId thread_id)
+{
+#if defined(__APPLE__) || defined(__GNUC__)
+    // On unixoid systems, we block a number of signals in the worker threads because we
+    // do not explicitly handle them. Otherwise, a worker thread receiving a signal might
+    // terminate the whole process.
+
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGALRM);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGPIPE);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGURG);
+    sigaddset(&mask, SIGUSR1);
+    sigaddset(&mask, SIGUSR2);
+
+    pthread_sigmask(SIG_BLOCK, &mask, 0);
+#endif
+
+    // Assign thread-local thread ID and pool
+    thread_id_ = thread_id;
+    thread_pool_ = this;
+
+    Worker& worker = *workers_[thread_id];
+    Task task;
+
+    if (!worker.cpu_set_.empty())
+        pin_current_thread(worker.cpu_set_);
+
+    do
+    {
+        while (get_next_task(worker, task))
+        {
+            running_task_ = &task;
+
+            try
+            {
+                task.fct_(*this);
+            }
+            catch (...)
+            {
+                // Tasks with a handle store exceptions in their promise, and exceptions
+                // from detached tasks are deliberately ignored.
+            }
+
+            running_task_ = nullptr;
+
+            SteadyTimePoint end_time{};
+
+            if (measure_task_times_ || trace_buffer_size_ != 0)
+                end_time = std::chrono::steady_clock::now();
+
+            if (measure_task_times_)
+            {
+                const auto run_time = end_time - worker.task_start_time_;
+                add_to_counter(worker.counters_.busy_ticks_, run_time.count());
+                add_to_counter(worker.counters_.execution_times_[
+                    get_histogram_bin(run_time)], std::uint64_t{ 1 });
+            }
+            add_to_counter(worker.counters_.num_completed_, std::uint64_t{ 1 });
+
+            if (task.periodic_)
+            {
+                reschedule_periodic_task(task);
+            }
+            else if (task.control_)
+            {
+                task.control_->state_.store(TaskState::complete,
+                    std::memory_order_release);
+                task.control_->run_continuations();
+            }
+
+            if (task.strand_)
+                advance_strand(*task.strand_);
+
+            task = Task{};
+
+            {
+                std::lock_guard<std::mutex> worker_lock(worker.mutex_);
+
+                if (trace_buffer_size_ != 0)
+                {
+                    auto& event = worker.trace_events_[
+                        worker.num_trace_events_++ % trace_buffer_size_];
+                    event.name_ = std::move(worker.running_task_name_);
+                    event.start_time_ = worker.task_start_time_;
+                    event.end_time_ = end_time;
+                }
+
+                worker.is_running_ = false;
+                if (!worker.running_task_name_.empty())
+                    worker.running_task_name_ = TaskName{};
+            }
+
+            --num_running_;
+        }
+    }
+    while (!retire_worker(worker, thread_id));
+}
+
+ThreadPool::Strand ThreadPool::make_strand()
+{
+    return Strand{ std::make_shared<Strand::State>(), shared_from_this() };
+}
+
+ThreadPool::TaskGroup ThreadPool::make_task_group()
+{
+    return TaskGroup{ std::make_shared<TaskGroup::State>(), shared_from_this() };
+}
+
+std::unique_ptr<detail::TaskContinuation>
+ThreadPool::make_task_group_member(const TaskGroup& group,
+    const std::shared_ptr<detail::TaskControlBlock>& control)
+{
+    if (!group.state_)
+        throw std::invalid_argument("Task group is not associated with a thread pool");
+
+    const auto self = shared_from_this();
+    if (group.pool_.owner_before(self) || self.owner_before(group.pool_))
+        throw std::invalid_argument("Task group belongs to another thread pool");
+
+    auto member = std::make_unique<TaskGroup::Member>(group.state_);
+    member->join(control);
+    return member;
+}
+
+bool ThreadPool::must_record_ready_time() const noexcept
+{
+    return measure_task_times_
+        || (queue_wait_threshold_ != SteadyTimePoint::duration::zero()
+            && num_threads_ < max_num_threads_);
+}
+
+bool ThreadPool::pop_local_task(Worker& worker, Task& task)
+{
+    std::lock_guard<std::mutex> worker_lock(worker.mutex_);
+
+    if (worker.local_tasks_.empty())
+        return false;
+
+    task = std::move(worker.local_tasks_.back());
+    worker.local_tasks_.pop_back();
+    --worker.num_local_tasks_;
+    --num_local_tasks_;
+
+    return true;
+}
+
+ThreadPool::SteadyTimePoint ThreadPool::promote_due_tasks()
+{
+    if (timer_wheel_)
+    {
+        if (timer_wheel_->size() == 0)
+            return SteadyTimePoint::max();
+        return timer_wheel_->advance(std::chrono::steady_clock::now(), ready_tasks_);
+    }
+
+    if (delayed_tasks_.empty())
+        return SteadyTimePoint::max();
+
+    const auto now = std::chrono::steady_clock::now();
+
+    while (!delayed_tasks_.empty())
+    {
+        if (delayed_tasks_.front().start_time_ > now)
+            return delayed_tasks_.front().start_time_;
+
+        std::pop_heap(delayed_tasks_.begin(), delayed_tasks_.end(), is_later);
+        ready_tasks_.push_back(std::move(delayed_tasks_.back()));
+        delayed_tasks_.pop_back();
+    }
+
+    return SteadyTimePoint::max();
+}
+
+bool ThreadPool::must_purge_canceled_tasks() const noexcept
+{
+    const auto num_canceled = num_canceled_.load();
+    return num_canceled > 64 && static_cast<std::size_t>(num_canceled) > num_pending_;
+}
+
+void ThreadPool::purge_canceled_tasks()
+{
+    const auto is_canceled = [](const Task& t) { return t.is_canceled(); };
+
+    std::ptrdiff_t num_removed = 0;
+
+    // A canceled task of a strand stays in the shared queue: When a worker takes it, it
+    // passes the turn on to the next task of the strand.
+    auto it = std::remove_if(ready_tasks_.begin(), ready_tasks_.end(),
+        [](const Task& t) { return !t.strand_ && t.is_canceled(); });
+    num_removed += ready_tasks_.end() - it;
+    ready_tasks_.erase(it, ready_tasks_.end());
+
+    for (const auto& strand : active_strands_)
+    {
+        auto& queue = strand->queue_;
+        auto strand_it = std::remove_if(queue.begin(), queue.end(), is_canceled);
+        num_removed += queue.end() - strand_it;
+        queue.erase(strand_it, queue.end());
+    }
+
+    for (auto& group_queue : worker_group_tasks_)
+    {
+        auto group_it = std::remove_if(
+            group_queue.begin(), group_queue.end(), is_canceled);
+        num_removed += group_queue.end() - group_it;
+        group_queue.erase(group_it, group_queue.end());
+    }
+
+    auto deadline_it = std::remove_if(
+        deadline_tasks_.begin(), deadline_tasks_.end(), is_canceled);
+    num_removed += deadline_tasks_.end() - deadline_it;
+    deadline_tasks_.erase(deadline_it, deadline_tasks_.end());
+    std::make_heap(deadline_tasks_.begin(), deadline_tasks_.end(), has_later_deadline);
+
+    auto delayed_it = std::remove_if(
+        delayed_tasks_.begin(), delayed_tasks_.end(), is_canceled);
+    num_removed += delayed_tasks_.end() - delayed_it;
+    delayed_tasks_.erase(delayed_it, delayed_tasks_.end());
+    std::make_heap(delayed_tasks_.begin(), delayed_tasks_.end(), is_later);
+
+    if (timer_wheel_)
+        num_removed += static_cast<std::ptrdiff_t>(timer_wheel_->remove_if(is_canceled));
+
+    for (auto& worker_ptr : workers_)
+    {
+        Worker& worker = *worker_ptr;
+        std::lock_guard<std::mutex> worker_lock(worker.mutex_);
+
+        auto local_it = std::remove_if(
+            worker.local_tasks_.begin(), worker.local_tasks_.end(), is_canceled);
+        const auto num_local_removed = static_cast<std::size_t>(
+            worker.local_tasks_.end() - local_it);
+        worker.local_tasks_.erase(local_it, worker.local_tasks_.end());
+        worker.num_local_tasks_ -= num_local_removed;
+        num_local_tasks_ -= num_local_removed;
+        num_removed += static_cast<std::ptrdiff_t>(num_local_removed);
+    }
+
+    num_canceled_ -= num_removed;
+}
+
+void ThreadPool::push_task(Task&& task)
+{
+    const bool is_ready = task.start_time_ == SteadyTimePoint{}
+        || task.start_time_ <= std::chrono::steady_clock::now();
+
+    // Record when the task became ready, so that its waiting time can be determined
+    if (task.start_time_ == SteadyTimePoint{} && must_record_ready_time())
+        task.start_time_ = std::chrono::steady_clock::now();
+
+    if (task.worker_group_ != no_worker_group)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (must_purge_canceled_tasks())
+                purge_canceled_tasks();
+            worker_group_tasks_[task.worker_group_].push_back(std::move(task));
+        }
+
+        // Only workers of the group can take the task, so we cannot pick just one
+        signal_spinning_worker();
+        cv_.notify_all();
+        return;
+    }
+
+    const bool by_deadline = is_ready && earliest_deadline_first_
+        && task.deadline_ != SteadyTimePoint::max();
+
+    if (work_stealing_ && is_ready && !by_deadline && thread_pool_ == this)
+    {
+        Worker& worker = *workers_[thread_id_];
+
+        if (must_purge_canceled_tasks())
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            purge_canceled_tasks();
+        }
+
+        {
+            std::lock_guard<std::mutex> worker_lock(worker.mutex_);
+            worker.local_tasks_.push_back(std::move(task));
+            ++worker.num_local_tasks_;
+        }
+
+        ++num_local_tasks_;
+        wake_sleeping_workers();
+        return;
+    }
+
+    bool grow_pool = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (must_purge_canceled_tasks())
+            purge_canceled_tasks();
+
+        if (by_deadline)
+        {
+            deadline_tasks_.push_back(std::move(task));
+            std::push_heap(deadline_tasks_.begin(), deadline_tasks_.end(),
+                has_later_deadline);
+            grow_pool = should_grow_i();
+        }
+        else if (is_ready || (timer_wheel_ && !timer_wheel_->insert(task)))
+        {
+            ready_tasks_.push_back(std::move(task));
+            grow_pool = should_grow_i();
+        }
+        else if (!timer_wheel_)
+        {
+            delayed_tasks_.push_back(std::move(task));
+            std::push_heap(delayed_tasks_.begin(), delayed_tasks_.end(), is_later);
+        }
+    }
+
+    notify_one_worker();
+
+    if (grow_pool)
+        grow();
+}
+
+void ThreadPool::push_strand_task(Task&& task, const Strand& strand)
+{
+    auto& state = *strand.state_;
+    task.strand_ = &state;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (must_purge_canceled_tasks())
+            purge_canceled_tasks();
+
+        if (state.active_index_ != Strand::State::inactive)
+        {
+            state.queue_.push_back(std::move(task));
+            return;
+        }
+
+        if (must_record_ready_time())
+            task.start_time_ = std::chrono::steady_clock::now();
+
+        active_strands_.push_back(strand.state_);
+
+        try
+        {
+            ready_tasks_.push_back(std::move(task));
+        }
+        catch (...)
+        {
+            active_strands_.pop_back();
+            throw;
+        }
+
+        state.active_index_ = active_strands_.size() - 1;
+    }
+
+    notify_one_worker();
+}
+
+void ThreadPool::release_dependent_task(Task& task, bool cancel) noexcept
+{
+    if (!cancel)
+    {
+        try
+        {
+            push_task(std::move(task));
+            return;
+        }
+        catch (...)
+        {
+            // Out of memory: Cancel the task instead
+        }
+    }
+
+    cancel_pending_task(*task.control_);
+
+    // The task does not occupy a place in any queue
+    --num_canceled_;
+}
+
+void ThreadPool::reschedule_periodic_task(Task& task) noexcept
+{
+    auto& periodic = *task.periodic_;
+    const auto now = std::chrono::steady_clock::now();
+
+    if (periodic.mode_ == PeriodicTaskOptions::Mode::fixed_delay)
+    {
+        task.start_time_ = now + periodic.period_;
+    }
+    else
+    {
+        task.start_time_ += periodic.period_;
+        if (periodic.skip_missed_ticks_ && task.start_time_ <= now)
+        {
+            const auto num_missed = (now - task.start_time_) / periodic.period_ + 1;
+            task.start_time_ += num_missed * periodic.period_;
+        }
+    }
+
+    ++periodic.num_runs_;
+
+    // The task becomes pending before the stop flag is checked. Therefore, either we see
+    // the flag or PeriodicTaskHandle::cancel() sees the pending task and cancels it.
+    ++num_pending_;
+    periodic.state_.store(TaskState::pending);
+
+    if (!periodic.stop_requested_.load())
+    {
+        try
+        {
+            push_task(std::move(task));
+            return;
+        }
+        catch (...)
+        {
+            periodic.stop_requested_ = true;
+        }
+    }
+
+    auto expected = TaskState::pending;
+    if (periodic.state_.compare_exchange_strong(expected, TaskState::canceled))
+    {
+        release_pending_slots();
+        num_tasks_canceled_.fetch_add(1, std::memory_order_relaxed);
+        periodic.run_continuations();
+    }
+    else
+    {
+        --num_canceled_; // canceled by the handle, but there is no entry in a queue
+    }
+}
+
+void ThreadPool::release_pending_slots(std::size_t num_tasks) noexcept
+{
+    num_pending_ -= num_tasks;
+
+    // A producer announces itself before checking num_pending_, so either it sees the
+    // released slots or we see it waiting.
+    if (num_waiting_producers_ != 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(producer_mutex_);
+        }
+
+        if (num_tasks == 1)
+            producer_cv_.notify_one();
+        else
+            producer_cv_.notify_all();
+    }
+}
+
+void ThreadPool::reserve_pending_slots(std::size_t num_tasks)
+{
+    auto num_pending = num_pending_.load();
+
+    do
+    {
+        if (num_tasks > capacity_ || num_pending > capacity_ - num_tasks)
+        {
+            if (num_tasks == 1)
+            {
+                throw std::runtime_error(cat(
+                    "Cannot add task: Pending queue has reached capacity (", num_pending,
+                    ')'));
+            }
+
+            throw std::runtime_error(cat("Cannot add ", num_tasks,
+                " tasks: Not enough room in pending queue (", num_pending, '/',
+                capacity_, ')'));
+        }
+    }
+    while (!num_pending_.compare_exchange_weak(num_pending, num_pending + num_tasks));
+}
+
+bool ThreadPool::try_reserve_pending_slot(SteadyTimePoint wait_until)
+{
+    const auto try_reserve = [this]()
+        {
+            auto num_pending = num_pending_.load();
+
+            do
+            {
+                if (num_pending >= capacity_)
+                    return false;
+            }
+            while (!num_pending_.compare_exchange_weak(num_pending, num_pending + 1));
+
+            return true;
+        };
+
+    if (try_reserve())
+        return true;
+
+    if (wait_until <= std::chrono::steady_clock::now())
+        return false;
+
+    std::unique_lock<std::mutex> lock(producer_mutex_);
+
+    ++num_waiting_producers_;
+
+    bool reserved = true;
+
+    if (wait_until == SteadyTimePoint::max())
+        producer_cv_.wait(lock, try_reserve);
+    else
+        reserved = producer_cv_.wait_until(lock, wait_until, try_reserve);
+
+    --num_waiting_producers_;
+
+    return reserved;
+}
+
+bool ThreadPool::retire_worker(Worker& worker, ThreadId thread_id)
+{
+    std::lock_guard<std::mutex> threads_lock(threads_mutex_);
+
+    if (shutdown_requested_)
+        return true;
+
+    if (thread_id < num_threads_)
+        return false;
+
+    worker.is_active_ = false;
+
+    auto& counters = worker.counters_;
+    add_to_counter(counters.active_ticks_,
+        std::chrono::steady_clock::now().time_since_epoch().count()
+            - counters.active_since_.load(std::memory_order_relaxed));
+    counters.active_since_.store(0, std::memory_order_relaxed);
+
+    // Hand over the tasks from the local queue to the remaining workers
+    if (work_stealing_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::lock_guard<std::mutex> worker_lock(worker.mutex_);
+
+            for (Task& task : worker.local_tasks_)
+                ready_tasks_.push_back(std::move(task));
+
+            num_local_tasks_ -= worker.local_tasks_.size();
+            worker.local_tasks_.clear();
+            worker.num_local_tasks_ = 0;
+        }
+
+        cv_.notify_all();
+    }
+
+    return true;
+}
+
+bool ThreadPool::should_grow_i() const noexcept
+{
+    if (queue_wait_threshold_ == SteadyTimePoint::duration::zero()
+        || num_sleeping_ != 0 || ready_tasks_.empty()
+        || num_threads_ >= max_num_threads_)
+    {
+        return false;
+    }
+
+    const auto ready_time = ready_tasks_.front().start_time_;
+    if (ready_time == SteadyTimePoint{})
+        return false;
+
+    return std::chrono::steady_clock::now() - ready_time > queue_wait_threshold_;
+}
+
+bool ThreadPool::start_task(Worker& worker, Task& task)
+{
+    if (task.deadline_ != SteadyTimePoint::max()
+        && std::chrono::steady_clock::now() > task.deadline_)
+    {
+        expire_task(task);
+        return false;
+    }
+
+    if (task.control_)
+    {
+        auto expected = TaskState::pending;
+        if (!task.control_->state_.compare_exchange_strong(expected, TaskState::running,
+                std::memory_order_acq_rel))
+        {
+            // The task has been canceled while waiting in the queue
+            --num_canceled_;
+            return false;
+        }
+    }
+    else if (task.batch_ && !task.batch_->try_claim())
+    {
+        // The batch has been canceled while the task was waiting in the queue
+        --num_canceled_;
+        return false;
+    }
+
+    ++num_running_;
+    release_pending_slots();
+
+    add_to_counter(worker.counters_.num_started_, std::uint64_t{ 1 });
+
+    if (measure_task_times_ || trace_buffer_size_ != 0)
+        worker.task_start_time_ = std::chrono::steady_clock::now();
+
+    if (measure_task_times_)
+    {
+        if (task.start_time_ != SteadyTimePoint{})
+        {
+            add_to_counter(worker.counters_.queue_wait_times_[
+                get_histogram_bin(worker.task_start_time_ - task.start_time_)],
+                std::uint64_t{ 1 });
+        }
+    }
+
+    std::lock_guard<std::mutex> worker_lock(worker.mutex_);
+    worker.is_running_ = true;
+
+    if (!task.name_.empty())
+    {
+        // Periodic tasks are rescheduled with their name, all others hand it over
+        if (task.periodic_)
+            worker.running_task_name_ = task.name_;
+        else
+            worker.running_task_name_ = std::move(task.name_);
+    }
+
+    return true;
+}
+
+void ThreadPool::start_worker_threads()
+{
+    const std::size_t num_threads = num_threads_;
+
+    for (std::size_t i = 0; i != num_threads; ++i)
+    {
+        Worker& worker = *workers_[i];
+        if (worker.is_active_)
+            continue;
+
+        // Join a retired thread that used to occupy the slot (it has already exited or
+        // is about to do so)
+        if (threads_[i].joinable())
+            threads_[i].join();
+
+        worker.counters_.active_since_.store(
+            std::chrono::steady_clock::now().time_since_epoch().count(),
+            std::memory_order_relaxed);
+
+        threads_[i] = std::thread([this, i]() { perform_work(i); });
+        worker.is_active_ = true;
+    }
+}
+
+bool ThreadPool::steal_task(Task& task)
+{
+    const auto num_workers = workers_.size();
+    const auto own_idx = thread_id_;
+
+    for (std::size_t i = 1; i < num_workers; ++i)
+    {
+        Worker& victim = *workers_[(own_idx + i) % num_workers];
+
+        if (victim.num_local_tasks_ == 0)
+            continue;
+
+        std::unique_lock<std::mutex> victim_lock(victim.mutex_, std::try_to_lock);
+        if (!victim_lock.owns_lock() || victim.local_tasks_.empty())
+            continue;
+
+        task = std::move(victim.local_tasks_.front());
+        victim.local_tasks_.pop_front();
+        --victim.num_local_tasks_;
+        --num_local_tasks_;
+
+        return true;
+    }
+
+    return false;
+}
+
+ThreadPool::SteadyTimePoint ThreadPool::to_steady_time(TimePoint t)
+{
+    using SteadyDuration = std::chrono::steady_clock::duration;
+
+    if (t == TimePoint{})
+        return SteadyTimePoint{};
+
+    const auto get_offset = []()
+        {
+            return std::chrono::steady_clock::now().time_since_epoch()
+                - std::chrono::duration_cast<SteadyDuration>(
+                    std::chrono::system_clock::now().time_since_epoch());
+        };
+
+    // The offset between the clocks is cached so that equal system time points are
+    // converted into equal steady time points. It is only updated if the system clock
+    // has been adjusted.
+    static std::atomic<SteadyDuration::rep> cached_offset{ get_offset().count() };
+
+    const auto offset = get_offset();
+    auto cached = SteadyDuration{ cached_offset.load(std::memory_order_relaxed) };
+    if (offset - cached > std::chrono::milliseconds{ 1 }
+        || cached - offset > std::chrono::milliseconds{ 1 })
+    {
+        cached = offset;
+        cached_offset.store(offset.count(), std::memory_order_relaxed);
+    }
+
+    return SteadyTimePoint{
+        std::chrono::duration_cast<SteadyDuration>(t.time_since_epoch()) + cached };
+}
+
+bool ThreadPool::wait_for_task(Worker& worker, Task& task)
+{
+    if (shutdown_requested_ || thread_id_ >= num_threads_)
+        return false;
+
+    if (work_stealing_ && pop_local_task(worker, task))
+        return true;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Time at which the worker started to wait in vain (for retiring idle workers)
+    SteadyTimePoint idle_since{};
+
+    // Time at which the worker stops spinning and goes to sleep
+    SteadyTimePoint spin_end{};
+
+    while (!shutdown_requested_)
+    {
+        // mutex is locked
+        if (thread_id_ >= num_threads_)
+            return false; // The worker has to retire
+
+        if (must_purge_canceled_tasks())
+            purge_canceled_tasks();
+
+        const auto wakeup_time = promote_due_tasks();
+
+        auto& group_queue = worker_group_tasks_[worker.worker_group_];
+        if (!group_queue.empty())
+        {
+            task = std::move(group_queue.front());
+            group_queue.pop_front();
+            return true;
+        }
+
+        if (!deadline_tasks_.empty() || !ready_tasks_.empty())
+        {
+            if (!deadline_tasks_.empty())
+            {
+                std::pop_heap(deadline_tasks_.begin(), deadline_tasks_.end(),
+                    has_later_deadline);
+                task = std::move(deadline_tasks_.back());
+                deadline_tasks_.pop_back();
+            }
+            else
+            {
+                task = std::move(ready_tasks_.front());
+                ready_tasks_.pop_front();
+            }
+
+            // Notifications are elided while a worker spins, so this one might have been
+            // the only one to learn about the remaining tasks: Pass the news on.
+            const bool wake_next = spin_duration_.count() != 0
+                && (!deadline_tasks_.empty() || !ready_tasks_.empty());
+            const bool grow_pool = should_grow_i();
+
+            if (wake_next || grow_pool)
+            {
+                lock.unlock();
+                if (wake_next)
+                    notify_one_worker();
+                if (grow_pool)
+                    grow();
+            }
+
+            return true;
+        }
+
+        auto wait_until_time = wakeup_time;
+
+        if (idle_timeout_ != SteadyTimePoint::duration::zero()
+            && num_threads_ > min_num_threads_)
+        {
+            const auto now = std::chrono::steady_clock::now();
+
+            if (idle_since == SteadyTimePoint{})
+            {
+                idle_since = now;
+            }
+            else if (now - idle_since >= idle_timeout_)
+            {
+                // Retire the worker with the highest ID (which may be this one)
+                auto num_threads = num_threads_.load();
+                if (num_threads > min_num_threads_
+                    && num_threads_.compare_exchange_strong(num_threads, num_threads - 1))
+                {
+                    cv_.notify_all();
+                }
+                idle_since = now;
+                continue;
+            }
+
+            wait_until_time = std::min(wait_until_time, idle_since + idle_timeout_);
+        }
+
+        // Spin for a while before going to sleep, so that a new task can be picked up
+        // without the latency of waking up from the condition variable
+        if (spin_duration_.count() != 0)
+        {
+            const auto now = std::chrono::steady_clock::now();
+
+            if (spin_end == SteadyTimePoint{})
+                spin_end = now + spin_duration_;
+
+            if (now < spin_end)
+            {
+                // Announce the spinning worker before releasing the lock, so that every
+                // producer that finds the queue empty also sees it spinning
+                ++num_spinning_;
+                lock.unlock();
+                spin_for_work(std::min(spin_end, wait_until_time));
+                lock.lock();
+                continue;
+            }
+        }
+
+        if (work_stealing_)
+        {
+            if (num_local_tasks_ != 0)
+            {
+                lock.unlock();
+                if (pop_local_task(worker, task) || steal_task(task))
+                    return true;
+                std::this_thread::yield();
+                lock.lock();
+                continue;
+            }
+
+            // Announce that we are about to sleep, then check the local queues once more.
+            // wake_sleeping_workers() modifies the same variables in the opposite order,
+            // so either we see the new task or the producer sees us sleeping.
+            ++num_sleeping_;
+            if (num_local_tasks_ != 0)
+            {
+                --num_sleeping_;
+                continue;
+            }
+        }
+        else
+        {
+            ++num_sleeping_;
+        }
+
+        if (wait_until_time == SteadyTimePoint::max())
+            cv_.wait(lock); // acquires the lock when done
+        else
+            cv_.wait_until(lock, wait_until_time); // acquires the lock when done
+
+        --num_sleeping_;
+    }
+
+    return false;
+}
+
+void ThreadPool::notify_one_worker() noexcept
+{
+    if (!signal_spinning_worker())
+        cv_.notify_one();
+}
+
+bool ThreadPool::signal_spinning_worker() noexcept
+{
+    if (num_spinning_ == 0)
+        return false;
+
+    has_new_work_.store(true, std::memory_order_release);
+    return true;
+}
+
+void ThreadPool::spin_for_work(SteadyTimePoint spin_end) noexcept
+{
+    // Busy-wait for a few rounds, then yield the CPU to other threads between the checks
+    constexpr unsigned int num_busy_rounds = 64;
+
+    for (unsigned int round = 0; ; ++round)
+    {
+        if (has_new_work_.load(std::memory_order_relaxed)
+            && has_new_work_.exchange(false, std::memory_order_acquire))
+        {
+            break;
+        }
+
+        if (shutdown_requested_ || thread_id_ >= num_threads_
+            || (work_stealing_ && num_local_tasks_ != 0)
+            || std::chrono::steady_clock::now() >= spin_end)
+        {
+            break;
+        }
+
+        if (round >= num_busy_rounds)
+            std::this_thread::yield();
+    }
+
+    --num_spinning_;
+}
+
+void ThreadPool::wake_sleeping_workers(std::size_t max_num_workers)
+{
+    const std::size_t num_sleeping = num_sleeping_;
+    if (num_sleeping == 0)
+        return;
+
+    // Briefly acquire the mutex so that the notification cannot slip in between a
+    // worker's last check of the queues and its call to cv_.wait().
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+    }
+
+    if (max_num_workers >= num_sleeping)
+    {
+        cv_.notify_all();
+    }
+    else
+    {
+        for (std::size_t i = 0; i != max_num_workers; ++i)
+            cv_.notify_one();
+    }
+}
+
+
+//
+// ThreadPool::TaskGroup
+//
+
+std::size_t ThreadPool::TaskGroup::cancel()
+{
+    if (!state_)
+        return 0;
+
+    auto pool = detail::lock_pool_or_throw(pool_);
+
+    // Collect the unfinished tasks first: Canceling a task makes it leave the group.
+    std::vector<std::shared_ptr<detail::TaskControlBlock>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex_);
+        tasks.reserve(state_->num_unfinished_.load(std::memory_order_relaxed));
+        for (Member* m = state_->members_; m != nullptr; m = m->next_member_)
+        {
+            // A task that is still being added is canceled by the adding thread
+            if (!m->is_enqueued_)
+                m->is_cancel_pending_ = true;
+            else if (auto control = m->control_.lock())
+                tasks.push_back(std::move(control));
+        }
+    }
+
+    std::size_t num_canceled = 0;
+    for (const auto& control : tasks)
+    {
+        if (pool->cancel_pending_task(*control))
+            ++num_canceled;
+        else
+            control->cancel_requested_.store(true, std::memory_order_release);
+    }
+
+    return num_canceled;
+}
+
+std::size_t ThreadPool::TaskGroup::count_unfinished() const noexcept
+{
+    if (!state_)
+        return 0;
+    return state_->num_unfinished_.load(std::memory_order_acquire);
+}
+
+void ThreadPool::TaskGroup::wait_all() const
+{
+    if (!state_)
+        return;
+
+    std::unique_lock<std::mutex> lock(state_->mutex_);
+    state_->cv_.wait(lock, [this]() { return state_->members_ == nullptr; });
+}
+
+
+//
+// ThreadPool::TaskName
+//
+
+ThreadPool::TaskName ThreadPool::TaskName::intern(string_view name)
+{
+    // The table is deliberately leaked, so that interned names remain valid during the
+    // destruction of static objects
+    static std::mutex* mutex = new std::mutex;
+    static auto* table = new std::unordered_set<std::string>;
+
+    TaskName result;
+
+    std::lock_guard<std::mutex> lock(*mutex);
+    result.static_name_ = table->emplace(name.data(), name.size()).first->c_str();
+
+    return result;
+}
+
+
+//
+// ThreadPool::TaskQueue
+//
+
+void ThreadPool::TaskQueue::clear() noexcept
+{
+    tasks_.clear();
+    head_ = 0;
+}
+
+void ThreadPool::TaskQueue::erase(iterator first, iterator last)
+{
+    tasks_.erase(first, last);
+    if (head_ > tasks_.size())
+        head_ = tasks_.size();
+}
+
+void ThreadPool::TaskQueue::pop_back()
+{
+    tasks_.pop_back();
+    if (head_ == tasks_.size())
+        clear();
+}
+
+void ThreadPool::TaskQueue::pop_front()
+{
+    tasks_[head_] = Task{};
+    ++head_;
+
+    if (head_ == tasks_.size())
+    {
+        clear();
+    }
+    else if (head_ > 32 && 2 * head_ > tasks_.size())
+    {
+        tasks_.erase(tasks_.begin(), tasks_.begin() + static_cast<std::ptrdiff_t>(head_));
+        head_ = 0;
+    }
+}
+
+
+thread_local ThreadPool::ThreadId
+ThreadPool::thread_id_{ std::numeric_limits<ThreadPool::ThreadId>::max() };
+
+thread_local const ThreadPool* ThreadPool::thread_pool_{ nullptr };
+
+thread_local const ThreadPool::Task* ThreadPool::running_task_{ nullptr };
 
 } // namespace gul14
@@ -0,0 +1,189 @@
+/**
+ * \file   test_CompletionQueue.cc
+ * \author \ref contributors
+ * \date   Created on October 16, 2026
+ * \brief  Test suite for the CompletionQueue class.
+ *
+ * \copyright Copyright 2026 Deutsches Elektronen-Synchrotron (DESY), Hamburg
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2.1 of the license, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "gul14/catch.h"
+#include "gul14/CompletionQueue.h"
+#include "gul14/time_util.h"
+#include "gul14/Trigger.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#endif
+
+using namespace std::literals;
+using namespace gul14;
+
+namespace {
+
+// Wait until the descriptor of the queue is readable and return true, or return false
+// after the timeout. Without a descriptor, poll the queue itself.
+bool wait_readable(CompletionQueue& queue, int timeout_ms)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    pollfd pfd{ queue.get_fd(), POLLIN, 0 };
+    return poll(&pfd, 1, timeout_ms) == 1;
+#else
+    gul14::sleep(std::chrono::milliseconds{ timeout_ms });
+    return true;
+#endif
+}
+
+} // anonymous namespace
+
+TEST_CASE("CompletionQueue: Notifications for finished tasks", "[CompletionQueue]")
+{
+    auto pool = make_thread_pool(2);
+    CompletionQueue queue;
+
+#if defined(__unix__) || defined(__APPLE__)
+    REQUIRE(queue.get_fd() >= 0);
+#endif
+    REQUIRE(queue.harvest().empty());
+    REQUIRE(wait_readable(queue, 0) == false);
+
+    SECTION("Completed tasks")
+    {
+        Trigger go;
+
+        auto task1 = pool->add_task([&go]() { go.wait(); return 1; });
+        auto task2 = pool->add_task([&go]() { go.wait(); return 2; });
+        queue.watch(task1);
+        queue.watch(task2);
+
+        REQUIRE(wait_readable(queue, 0) == false);
+        go = true;
+
+        std::vector<CompletionQueue::Completion> completions;
+        while (completions.size() != 2)
+        {
+            REQUIRE(wait_readable(queue, 10'000));
+            queue.harvest(completions);
+        }
+
+        const std::set<ThreadPool::TaskId> ids{ completions[0].id, completions[1].id };
+        REQUIRE(ids == std::set<ThreadPool::TaskId>{ task1.get_id(), task2.get_id() });
+        REQUIRE(completions[0].state == TaskState::complete);
+        REQUIRE(completions[1].state == TaskState::complete);
+
+        // The results can be taken without blocking
+        REQUIRE(task1.is_complete());
+        REQUIRE(task1.get_result() + task2.get_result() == 3);
+
+        REQUIRE(wait_readable(queue, 0) == false);
+    }
+
+    SECTION("Canceled and already finished tasks")
+    {
+        Trigger go;
+
+        pool->add_task([&go]() { go.wait(); });
+        pool->add_task([&go]() { go.wait(); });
+        while (pool->count_pending() != 0)
+            gul14::sleep(1ms);
+
+        auto pending = pool->add_task([]() {});
+        queue.watch(pending);
+        REQUIRE(pending.cancel());
+
+        REQUIRE(wait_readable(queue, 0));
+        auto completions = queue.harvest();
+        REQUIRE(completions.size() == 1);
+        REQUIRE(completions[0].id == pending.get_id());
+        REQUIRE(completions[0].state == TaskState::canceled);
+
+        go = true;
+        auto finished = pool->add_task([]() {});
+        while (!finished.is_complete())
+            gul14::sleep(1ms);
+
+        queue.watch(finished);
+        completions = queue.harvest();
+        REQUIRE(completions.size() == 1);
+        REQUIRE(completions[0].id == finished.get_id());
+        REQUIRE(completions[0].state == TaskState::complete);
+
+        while (!pool->is_idle())
+            gul14::sleep(1ms);
+    }
+
+    SECTION("Many completions are collected with few wakeups")
+    {
+        constexpr std::size_t num_tasks = 2000;
+        std::vector<ThreadPool::TaskHandle<std::size_t>> tasks;
+
+        for (std::size_t i = 0; i != num_tasks; ++i)
+        {
+            tasks.push_back(pool->add_task_blocking([i]() { return i; }));
+            queue.watch(tasks.back());
+        }
+
+        std::vector<CompletionQueue::Completion> completions;
+        std::size_t num_wakeups = 0;
+        while (completions.size() != num_tasks)
+        {
+            REQUIRE(wait_readable(queue, 10'000));
+            ++num_wakeups;
+            queue.harvest(completions);
+        }
+
+        REQUIRE(num_wakeups <= num_tasks);
+
+        std::set<ThreadPool::TaskId> ids;
+        for (const auto& completion : completions)
+        {
+            REQUIRE(completion.state == TaskState::complete);
+            ids.insert(completion.id);
+        }
+        REQUIRE(ids.size() == num_tasks);
+    }
+
+    SECTION("Invalid handles")
+    {
+        REQUIRE_THROWS_AS(queue.watch(ThreadPool::TaskHandle<int>{}), std::logic_error);
+    }
+
+    // Make sure the pool is removed before any captured variable goes out of scope
+    pool.reset();
+}
+
+TEST_CASE("CompletionQueue: Destruction before the tasks finish", "[CompletionQueue]")
+{
+    Trigger go;
+    auto pool = make_thread_pool(1);
+
+    {
+        CompletionQueue queue;
+        queue.watch(pool->add_task([&go]() { go.wait(); }));
+        queue.watch(pool->add_task([]() {}));
+    }
+
+    go = true;
+    while (!pool->is_idle())
+        gul14::sleep(1ms);
+}
@@ -0,0 +1,185 @@
+/**
+ * \file   test_ShardedThreadPool.cc
+ * \author \ref contributors
+ * \date   Created on October 16, 2026
+ * \brief  Test suite for the ShardedThreadPool class.
+ *
+ * \copyright Copyright 2026 Deutsches Elektronen-Synchrotron (DESY), Hamburg
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2.1 of the license, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gul14/catch.h"
+#include "gul14/ShardedThreadPool.h"
+#include "gul14/time_util.h"
+#include "gul14/Trigger.h"
+
+using namespace std::literals;
+using namespace gul14;
+
+TEST_CASE("ShardedThreadPool: Constructor", "[ShardedThreadPool]")
+{
+    ShardedThreadPoolOptions options;
+    options.num_shards = 3;
+    options.shard_options.num_threads = 2;
+
+    ShardedThreadPool pool{ options };
+    REQUIRE(pool.count_shards() == 3);
+    REQUIRE(pool.count_threads() == 6);
+    REQUIRE(pool.is_idle());
+    REQUIRE(&pool.get_shard(0) != &pool.get_shard(1));
+    REQUIRE_THROWS_AS(pool.get_shard(3), std::out_of_range);
+
+    options.num_shards = 0;
+    REQUIRE_THROWS_AS(ShardedThreadPool{ options }, std::invalid_argument);
+}
+
+TEST_CASE("ShardedThreadPool: Routing by key and by shard index", "[ShardedThreadPool]")
+{
+    ShardedThreadPoolOptions options;
+    options.num_shards = 4;
+
+    ShardedThreadPool pool{ options };
+
+    SECTION("Tasks for the same key run on the same shard, in order")
+    {
+        std::vector<int> values;
+
+        for (int i = 0; i != 100; ++i)
+        {
+            auto task = pool.add_task_by_key("client"s,
+                [&values, i](ThreadPool& shard) { values.push_back(i); return &shard; });
+
+            if (i == 99)
+            {
+                const auto index = pool.get_shard_index("client"s);
+                REQUIRE(task.get_result() == &pool.get_shard(index));
+            }
+        }
+
+        REQUIRE(values.size() == 100);
+        for (int i = 0; i != 100; ++i)
+            REQUIRE(values[i] == i);
+    }
+
+    SECTION("Consecutive keys are spread over all shards")
+    {
+        std::vector<int> num_keys(pool.count_shards(), 0);
+
+        for (int key = 0; key != 1000; ++key)
+        {
+            const auto index = pool.get_shard_index(key);
+            REQUIRE(index < pool.count_shards());
+            REQUIRE(index == pool.get_shard_index(key));
+            ++num_keys[index];
+        }
+
+        for (int n : num_keys)
+            REQUIRE(n > 100);
+    }
+
+    SECTION("add_task_to_shard()")
+    {
+        auto task = pool.add_task_to_shard(2, [](ThreadPool& shard) { return &shard; });
+        REQUIRE(task.get_result() == &pool.get_shard(2));
+
+        auto named_task = pool.add_task_to_shard(0, []() { return 42; }, "name");
+        REQUIRE(named_task.get_result() == 42);
+        REQUIRE_THROWS_AS(pool.add_task_to_shard(4, []() {}), std::out_of_range);
+    }
+}
+
+TEST_CASE("ShardedThreadPool: Spillover", "[ShardedThreadPool]")
+{
+    ShardedThreadPoolOptions options;
+    options.num_shards = 2;
+
+    Trigger go;
+    std::atomic<int> num_on_shard_1{ 0 };
+
+    const auto count_shard = [&num_on_shard_1](ShardedThreadPool& pool)
+        {
+            return [&num_on_shard_1, &pool](ThreadPool& shard)
+                {
+                    if (&shard == &pool.get_shard(1))
+                        ++num_on_shard_1;
+                };
+        };
+
+    SECTION("Without spillover, all tasks stay on their shard")
+    {
+        ShardedThreadPool pool{ options };
+        pool.add_task_to_shard(0, [&go]() { go.wait(); });
+
+        for (int i = 0; i != 10; ++i)
+            pool.add_task_to_shard(0, count_shard(pool));
+
+        REQUIRE(pool.count_pending() >= 10);
+        go = true;
+        while (!pool.is_idle())
+            gul14::sleep(1ms);
+
+        REQUIRE(num_on_shard_1 == 0);
+    }
+
+    SECTION("With spillover, tasks move to the least loaded shard")
+    {
+        options.spillover_threshold = 2;
+        ShardedThreadPool pool{ options };
+        pool.add_task_to_shard(0, [&go]() { go.wait(); });
+        while (pool.get_shard(0).count_pending() != 0)
+            gul14::sleep(1ms);
+
+        for (int i = 0; i != 10; ++i)
+            pool.add_task_to_shard(0, count_shard(pool));
+
+        go = true;
+        while (!pool.is_idle())
+            gul14::sleep(1ms);
+
+        REQUIRE(num_on_shard_1 > 0);
+    }
+}
+
+TEST_CASE("ShardedThreadPool: cancel_pending_tasks()", "[ShardedThreadPool]")
+{
+    ShardedThreadPoolOptions options;
+    options.num_shards = 2;
+
+    Trigger go;
+    ShardedThreadPool pool{ options };
+
+    pool.add_task_to_shard(0, [&go]() { go.wait(); });
+    pool.add_task_to_shard(1, [&go]() { go.wait(); });
+    while (pool.count_pending() != 0)
+        gul14::sleep(1ms);
+
+    auto task1 = pool.add_task_to_shard(0, []() {});
+    auto task2 = pool.add_task_to_shard(1, []() {});
+    REQUIRE(pool.count_pending() == 2);
+
+    REQUIRE(pool.cancel_pending_tasks() == 2);
+    REQUIRE(pool.count_pending() == 0);
+    REQUIRE(task1.get_state() == TaskState::canceled);
+    REQUIRE(task2.get_state() == TaskState::canceled);
+
+    go = true;
+}
@@ -24,7 +24,18 @@
 
 #include <array>
 #include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "gul14/catch.h"
 #include "gul14/ThreadPool.h"
@@ -34,6 +45,42 @@
 using namespace gul14;
 using namespace std::literals;
 
+namespace {
+
+// Number of calls to the global operator new on the current thread
+thread_local std::size_t num_allocations = 0;
+
+} // anonymous namespace
+
+// Replace the global allocation functions to count the allocations of each thread
+void* operator new(std::size_t size)
+{
+    ++num_allocations;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+// GCC cannot tell that operator new has been replaced with a call to malloc()
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#   pragma GCC diagnostic push
+#   pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#   pragma GCC diagnostic pop
+#endif
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    ::operator delete(ptr);
+}
+
 //
 // TaskHandle class
 //
@@ -87,6 +134,52 @@ TEST_CASE("TaskHandle: get_result()", "[ThreadPool]")
     REQUIRE(task1.get_result() == 42);
     REQUIRE(task2.get_result() == "Hello");
     REQUIRE_THROWS_AS(task3.get_result(), std::runtime_error);
+
+    SECTION("The result can be retrieved only once")
+    {
+        auto task = pool->add_task([]() { return std::make_unique<int>(7); });
+        REQUIRE(*task.get_result() == 7);
+        REQUIRE(task.is_complete() == false);
+        REQUIRE_THROWS_AS(task.get_result(), std::logic_error);
+    }
+
+    SECTION("References are returned as references")
+    {
+        int value = 1;
+        auto task = pool->add_task([&value](ThreadPool&) -> int& { return value; });
+        REQUIRE(&task.get_result() == &value);
+    }
+
+    SECTION("A waiting call wakes up when the task is canceled")
+    {
+        Trigger go;
+        pool->add_task([&go]() { go.wait(); });
+        auto task = pool->add_task([]() { return 1; });
+
+        std::atomic<bool> has_thrown{ false };
+        std::thread waiter([&task, &has_thrown]()
+            {
+                try
+                {
+                    task.get_result();
+                }
+                catch (const std::logic_error&)
+                {
+                    has_thrown = true;
+                }
+            });
+
+        gul14::sleep(10ms);
+        pool->cancel_pending_tasks();
+        waiter.join();
+        go = true;
+
+        REQUIRE(has_thrown);
+        REQUIRE(task.get_state() == TaskState::canceled);
+    }
+
+    // Make sure the pool is removed before any captured variable goes out of scope
+    pool.reset();
 }
 
 TEST_CASE("TaskHandle: is_complete()", "[ThreadPool][TaskHandle]")
@@ -152,6 +245,203 @@ TEST_CASE("TaskHandle: get_state()", "[ThreadPool][TaskHandle]")
 }
 
 
+TEST_CASE("TaskHandle: cancel() does not affect running tasks", "[ThreadPool][TaskHandle]")
+{
+    auto pool = make_thread_pool(1);
+
+    Trigger go;
+
+    auto task = pool->add_task([&go]() { go.wait(); return 42; });
+
+    while (task.get_state() != TaskState::running)
+        gul14::sleep(1ms);
+
+    REQUIRE(task.cancel() == false);
+    REQUIRE(task.get_state() == TaskState::running);
+
+    go = true;
+
+    REQUIRE(task.get_result() == 42);
+
+    while (task.get_state() != TaskState::complete)
+        gul14::sleep(1ms);
+
+    // Make sure the pool is removed before any captured variable goes out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: Cancellation tokens", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(2);
+
+    // Run until the token is set, return the number of iterations
+    const auto scan = [](ThreadPool& p)
+        {
+            const auto token = p.get_cancellation_token();
+            int num_iterations = 0;
+            while (!token.is_cancellation_requested())
+            {
+                ++num_iterations;
+                gul14::sleep(100us);
+            }
+            return num_iterations;
+        };
+
+    SECTION("TaskHandle::cancel() sets the token of a running task")
+    {
+        auto task = pool->add_task(scan);
+
+        while (task.get_state() != TaskState::running)
+            gul14::sleep(1ms);
+
+        REQUIRE(task.cancel() == false);
+        REQUIRE(task.get_result() >= 0);
+        REQUIRE(task.get_state() == TaskState::complete);
+    }
+
+    SECTION("BatchHandle::cancel() sets the tokens of running tasks")
+    {
+        std::vector<std::function<int(ThreadPool&)>> jobs(2, scan);
+        auto batch = pool->add_tasks(jobs);
+
+        while (pool->count_pending() != 0)
+            gul14::sleep(1ms);
+
+        REQUIRE(batch.cancel() == 0);
+        batch.wait();
+        REQUIRE(batch.is_complete());
+    }
+
+    SECTION("PeriodicTaskHandle::cancel() sets the token of a running task")
+    {
+        std::atomic<bool> started{ false };
+        auto task = pool->add_periodic_task(
+            [&started, &scan](ThreadPool& p) { started = true; scan(p); }, 1ms);
+
+        while (!started)
+            gul14::sleep(1ms);
+
+        REQUIRE(task.cancel() == true);
+        while (task.get_state() != TaskState::canceled)
+            gul14::sleep(1ms);
+        REQUIRE(task.count_runs() == 1);
+    }
+
+    SECTION("Tokens of unrelated tasks are not set")
+    {
+        Trigger go;
+        auto task1 = pool->add_task([&go](ThreadPool& p)
+            {
+                go.wait();
+                return p.get_cancellation_token().is_cancellation_requested();
+            });
+        auto task2 = pool->add_task(scan);
+
+        while (task2.get_state() != TaskState::running)
+            gul14::sleep(1ms);
+        task2.cancel();
+        go = true;
+
+        REQUIRE(task1.get_result() == false);
+        REQUIRE(task2.get_result() >= 0);
+    }
+
+    SECTION("Default-constructed tokens and calls from outside of a task")
+    {
+        REQUIRE(ThreadPool::CancellationToken{}.is_cancellation_requested() == false);
+        REQUIRE_THROWS_AS(pool->get_cancellation_token(), std::runtime_error);
+
+        auto other_pool = make_thread_pool(1);
+        auto task = other_pool->add_task([&pool]() { pool->get_cancellation_token(); });
+        REQUIRE_THROWS_AS(task.get_result(), std::runtime_error);
+    }
+
+    // Make sure the pool is removed before any captured variable goes out of scope
+    pool.reset();
+}
+
+TEST_CASE("TaskHandle: get_state() after destruction of the pool",
+    "[ThreadPool][TaskHandle]")
+{
+    auto pool = make_thread_pool(1);
+
+    auto task1 = pool->add_task([]() {});
+    auto task2 = pool->add_task([]() {}, 1h);
+
+    while (task1.get_state() != TaskState::complete)
+        gul14::sleep(1ms);
+
+    pool.reset();
+
+    REQUIRE(task1.get_state() == TaskState::complete);
+    REQUIRE(task2.get_state() == TaskState::canceled);
+    REQUIRE_THROWS_AS(task2.cancel(), std::logic_error);
+}
+
+TEST_CASE("TaskHandle: Canceling many delayed tasks", "[ThreadPool][TaskHandle]")
+{
+    auto pool = make_thread_pool(1, 1000);
+
+    std::atomic<int> counter{ 0 };
+
+    for (int round = 0; round != 10; ++round)
+    {
+        std::vector<ThreadPool::TaskHandle<void>> handles;
+
+        for (int i = 0; i != 1000; ++i)
+            handles.push_back(pool->add_task([&counter]() { ++counter; }, 1h));
+
+        REQUIRE(pool->is_full());
+
+        for (auto& handle : handles)
+            REQUIRE(handle.cancel() == true);
+
+        REQUIRE(pool->count_pending() == 0);
+        REQUIRE(pool->get_pending_task_names().empty());
+
+        for (auto& handle : handles)
+            REQUIRE(handle.get_state() == TaskState::canceled);
+    }
+
+    pool->add_task([&counter]() { ++counter; });
+
+    while (not pool->is_idle())
+        gul14::sleep(1ms);
+
+    REQUIRE(counter == 1);
+
+    // Make sure the pool is removed before any captured variable goes out of scope
+    pool.reset();
+}
+
+TEST_CASE("TaskHandle: Canceled tasks do not accumulate while the workers are busy",
+    "[ThreadPool][TaskHandle]")
+{
+    auto pool = make_thread_pool(1);
+    auto token = std::make_shared<int>(0);
+    Trigger go;
+
+    pool->add_task([&go]() { go.wait(); });
+    while (pool->count_pending() != 0)
+        gul14::sleep(1ms);
+
+    // Each canceled task keeps a copy of the token until it is removed from its queue
+    for (int i = 0; i != 20000; ++i)
+    {
+        auto task = pool->add_task([token]() {});
+        REQUIRE(task.cancel());
+
+        auto delayed_task = pool->add_task([token]() {}, 1h);
+        REQUIRE(delayed_task.cancel());
+    }
+
+    REQUIRE(static_cast<std::size_t>(token.use_count()) <= 2 * pool->capacity());
+
+    go = true;
+    while (!pool->is_idle())
+        gul14::sleep(1ms);
+}
+
 //
 // ThreadPool class
 //
@@ -176,6 +466,18 @@ TEST_CASE("ThreadPool: Constructor", "[ThreadPool]")
     {
         REQUIRE_THROWS_AS(make_thread_pool(0), std::invalid_argument);
     }
+
+    SECTION("Create a work-stealing thread pool with 3 threads, capacity 10")
+    {
+        ThreadPoolOptions options;
+        options.num_threads = 3;
+        options.capacity = 10;
+        options.work_stealing = true;
+
+        auto pool = make_thread_pool(options);
+        REQUIRE(pool->count_threads() == 3);
+        REQUIRE(pool->capacity() == 10);
+    }
 }
 
 TEST_CASE("ThreadPool: add_task() for functions without ThreadPool&", "[ThreadPool]")
@@ -335,112 +637,640 @@ TEST_CASE("ThreadPool: add_task(f(ThreadPool&, ...))", "[ThreadPool]")
     pool.reset();
 }
 
-TEST_CASE("ThreadPool: cancel_pending_tasks()", "[ThreadPool]")
+TEST_CASE("ThreadPool: add_task() with dependencies", "[ThreadPool]")
 {
-    auto pool = make_thread_pool(1);
+    SECTION("Tasks start after their predecessors have finished")
+    {
+        auto pool = make_thread_pool(4);
 
-    std::atomic<bool> stop{ false };
+        std::mutex mutex;
+        std::string log;
+        const auto append = [&mutex, &log](char c)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                log += c;
+            };
+
+        Trigger go;
+        auto decode = pool->add_task([&]() { go.wait(); append('d'); });
+        auto t1 = pool->add_task([&]() { append('1'); }, after(decode));
+        auto t2 = pool->add_task([&]() { append('2'); }, after(decode), "t2");
+        auto merge = pool->add_task([&](ThreadPool&) { append('m'); return 42; },
+            after(t1, t2));
+
+        gul14::sleep(5ms);
+        REQUIRE(t1.get_state() == TaskState::pending);
+        REQUIRE(merge.get_state() == TaskState::pending);
+        REQUIRE(pool->count_pending() == 3);
+
+        go = true;
+        REQUIRE(merge.get_result() == 42);
+        REQUIRE(log.size() == 4);
+        REQUIRE(log.front() == 'd');
+        REQUIRE(log.back() == 'm');
+    }
 
-    auto task1 = pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
-    auto task2 = pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
-    auto task3 = pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
+    SECTION("Waiting tasks do not occupy a thread")
+    {
+        auto pool = make_thread_pool(1);
 
-    while (task1.get_state() == TaskState::pending)
-        gul14::sleep(1ms);
+        Trigger go;
+        auto first = pool->add_task([&go]() { go.wait(); return 1; });
 
-    REQUIRE(task1.get_state() != TaskState::complete);
-    REQUIRE(task1.get_state() != TaskState::canceled);
-    REQUIRE(task2.get_state() == TaskState::pending);
-    REQUIRE(task3.get_state() == TaskState::pending);
+        // With a single thread, a dependent task that blocked while waiting would
+        // prevent its predecessor from ever running.
+        std::vector<ThreadPool::TaskHandle<int>> chain;
+        chain.push_back(pool->add_task([]() { return 2; }, after(first)));
+        for (int i = 0; i != 10; ++i)
+            chain.push_back(pool->add_task([i]() { return i; }, after(chain.back())));
 
-    REQUIRE(pool->cancel_pending_tasks() == 2);
-    REQUIRE(pool->count_pending() == 0);
-    REQUIRE(pool->cancel_pending_tasks() == 0);
+        auto independent = pool->add_task([]() { return 3; });
+        go = true;
 
-    stop = true;
+        REQUIRE(independent.get_result() == 3);
+        REQUIRE(chain.back().get_result() == 9);
+        REQUIRE(first.get_result() == 1);
+    }
 
-    // Make sure the pool is removed before any of the atomic variables go out of scope
-    pool.reset();
-}
+    SECTION("Predecessors that have already finished")
+    {
+        auto pool = make_thread_pool(2);
 
-TEST_CASE("ThreadPool: capacity()", "[ThreadPool]")
-{
-    auto pool = make_thread_pool(1, 128);
-    REQUIRE(pool->capacity() == 128);
-}
+        auto a = pool->add_task([]() {});
+        while (not a.is_complete())
+            gul14::sleep(10us);
 
-TEST_CASE("ThreadPool: count_pending()", "[ThreadPool]")
-{
-    auto pool = make_thread_pool(1);
+        auto b = pool->add_task([]() { return 'b'; }, after(a));
+        REQUIRE(b.get_result() == 'b');
+    }
 
-    std::atomic<bool> stop{ false };
+    SECTION("Canceling a predecessor cancels all dependent tasks")
+    {
+        auto pool = make_thread_pool(1);
+
+        Trigger go;
+        pool->add_task([&go]() { go.wait(); });
+        while (pool->count_pending() != 0)
+            gul14::sleep(10us);
+
+        auto a = pool->add_task([]() {});
+        auto b = pool->add_task([]() {});
+        auto c = pool->add_task([]() {}, after(a, b));
+        auto d = pool->add_task([]() {}, after(c));
+        REQUIRE(pool->count_pending() == 4);
+
+        REQUIRE(a.cancel());
+        REQUIRE(c.get_state() == TaskState::pending); // b has not finished yet
+
+        go = true;
+        while (not pool->is_idle())
+            gul14::sleep(1ms);
+
+        REQUIRE(b.get_state() == TaskState::complete);
+        REQUIRE(c.get_state() == TaskState::canceled);
+        REQUIRE(d.get_state() == TaskState::canceled);
+        REQUIRE(pool->count_pending() == 0);
+    }
 
-    // Insert 11 work items
-    for (std::size_t i = 0; i <= 10; ++i)
+    SECTION("Canceling a waiting task")
     {
-        REQUIRE(pool->is_full() == false);
-        pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
+        auto pool = make_thread_pool(1);
+
+        Trigger go;
+        auto a = pool->add_task([&go]() { go.wait(); });
+        while (pool->count_pending() != 0)
+            gul14::sleep(10us);
+
+        std::atomic<bool> ran{ false };
+        auto b = pool->add_task([&ran]() { ran = true; }, after(a));
+
+        REQUIRE(pool->count_pending() == 1);
+        REQUIRE(b.cancel());
+        REQUIRE(pool->count_pending() == 0);
+
+        go = true;
+        while (not pool->is_idle())
+            gul14::sleep(1ms);
+        gul14::sleep(1ms);
+
+        REQUIRE(b.get_state() == TaskState::canceled);
+        REQUIRE(ran == false);
     }
 
-    // One work item might already be executing, the queue should have 10 or 11 pending
-    // items
-    REQUIRE(pool->count_pending() >= 10);
-    REQUIRE(pool->count_pending() <= 11);
+    SECTION("Waiting tasks are canceled when the pool is destroyed")
+    {
+        auto pool = make_thread_pool(1);
 
-    stop = true;
+        Trigger go;
+        pool->add_task([&go]() { go.wait(); });
+        auto a = pool->add_task([]() {});
+        auto b = pool->add_task([]() {}, after(a));
 
-    // Make sure the pool is removed before any of the atomic variables go out of scope
-    pool.reset();
+        go = true;
+        pool.reset();
+
+        REQUIRE(b.get_state() == TaskState::canceled);
+    }
+
+    SECTION("Invalid dependencies")
+    {
+        auto pool = make_thread_pool(1);
+        auto other_pool = make_thread_pool(1);
+
+        auto a = other_pool->add_task([]() {});
+        REQUIRE_THROWS_AS(pool->add_task([]() {}, after(a)), std::invalid_argument);
+        REQUIRE(pool->count_pending() == 0);
+
+        ThreadPool::TaskHandle<void> invalid;
+        REQUIRE_THROWS_AS(after(invalid), std::invalid_argument);
+    }
 }
 
-TEST_CASE("ThreadPool: count_threads()", "[ThreadPool]")
+TEST_CASE("TaskHandle: then()", "[ThreadPool][TaskHandle]")
 {
-    for (std::size_t i = 1; i <= 2; ++i)
+    auto pool = make_thread_pool(2);
+
+    SECTION("Chained continuations")
     {
-        auto pool = make_thread_pool(i);
-        REQUIRE(pool->count_threads() == i);
+        auto a = pool->add_task([]() { return 6; });
+        auto b = a.then([](int v) { return v * v; });
+        auto c = b.then([](int v) { return std::to_string(v); }, "to_string");
+        std::atomic<bool> done{ false };
+        auto d = c.then([&done](std::string str) { done = (str == "36"); });
+        auto e = d.then([&done]() { return done.load(); });
+
+        REQUIRE(e.get_result() == true);
+        REQUIRE(a.get_state() == TaskState::complete);
+        REQUIRE(a.is_complete() == false); // the result has been moved on
+        REQUIRE_THROWS_AS(a.get_result(), std::logic_error);
+        REQUIRE_THROWS_AS(a.then([](int) {}), std::logic_error);
+    }
+
+    SECTION("Exceptions propagate")
+    {
+        auto a = pool->add_task([]() -> int { throw std::runtime_error("Test"); });
+        std::atomic<bool> called{ false };
+        auto b = a.then([&called](int v) { called = true; return v; });
+
+        REQUIRE_THROWS_AS(b.get_result(), std::runtime_error);
+        REQUIRE(called == false);
+    }
+
+    SECTION("Canceling a task cancels its continuation")
+    {
+        Trigger go;
+        auto single_pool = make_thread_pool(1);
+        single_pool->add_task([&go]() { go.wait(); });
+        auto a = single_pool->add_task([]() { return 1; }, 1h);
+        auto b = a.then([](int v) { return v; });
+
+        REQUIRE(a.cancel());
+        REQUIRE(b.get_state() == TaskState::canceled);
+        go = true;
+    }
+
+    SECTION("A full queue leaves the result with the handle")
+    {
+        Trigger go;
+        auto single_pool = make_thread_pool(1, 1);
+        single_pool->add_task([&go]() { go.wait(); });
+        while (single_pool->count_pending() != 0)
+            gul14::sleep(1ms);
+
+        auto a = single_pool->add_task([]() { return 42; });
+        REQUIRE(single_pool->is_full());
+        REQUIRE_THROWS_AS(a.then([](int v) { return v; }), std::runtime_error);
+
+        go = true;
+        REQUIRE(a.get_result() == 42);
     }
 }
 
-TEST_CASE("ThreadPool: get_pending_task_names()", "[ThreadPool]")
+TEST_CASE("ThreadPool: when_all()", "[ThreadPool]")
 {
-    auto pool = make_thread_pool(1);
+    Trigger go;
+    auto pool = make_thread_pool(3);
 
-    REQUIRE(pool->get_pending_task_names().empty());
+    auto a = pool->add_task([&go]() { go.wait(); return 1; });
+    auto b = pool->add_task([]() { return 2; });
 
-    std::atomic<bool> stop{ false };
+    SECTION("Variadic")
+    {
+        auto all = when_all(a, b);
+        gul14::sleep(2ms);
+        REQUIRE(all.get_state() == TaskState::pending);
 
-    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); }, "1");
-    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); }, "2");
-    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); }, "3");
+        go = true;
+        auto sum = all.then([&a, &b]() { return a.get_result() + b.get_result(); });
+        REQUIRE(sum.get_result() == 3);
+    }
 
-    while (pool->count_pending() == 3)
-        gul14::sleep(1ms);
+    SECTION("Range")
+    {
+        std::vector<ThreadPool::TaskHandle<int>> handles;
+        handles.push_back(std::move(a));
+        handles.push_back(std::move(b));
+        go = true;
+        when_all(handles.begin(), handles.end()).get_result();
+        REQUIRE(handles[0].is_complete());
+        REQUIRE(handles[1].is_complete());
+
+        handles.clear();
+        REQUIRE_THROWS_AS(when_all(handles.begin(), handles.end()),
+            std::invalid_argument);
+    }
+}
 
-    auto pending_names = pool->get_pending_task_names();
-    REQUIRE(pending_names.size() == 2);
-    REQUIRE(pending_names[0] == "2");
-    REQUIRE(pending_names[1] == "3");
+TEST_CASE("ThreadPool: when_any()", "[ThreadPool]")
+{
+    Trigger go;
+    auto pool = make_thread_pool(3);
 
-    stop = true;
+    SECTION("The first completed task wins")
+    {
+        auto a = pool->add_task([&go]() { go.wait(); });
+        auto b = pool->add_task([]() { return 'b'; });
 
-    // Make sure the pool is removed before any of the atomic variables go out of scope
-    pool.reset();
+        REQUIRE(when_any(a, b).get_result() == 1);
+        go = true;
+    }
+
+    SECTION("Canceled tasks are ignored unless all are canceled")
+    {
+        auto a = pool->add_task([]() {}, 1h);
+        auto b = pool->add_task([&go]() { go.wait(); });
+        std::vector<ThreadPool::TaskHandle<void>> handles;
+        handles.push_back(std::move(a));
+        handles.push_back(std::move(b));
+        auto any = when_any(handles.begin(), handles.end());
+
+        REQUIRE(handles[0].cancel());
+        gul14::sleep(2ms);
+        REQUIRE(any.get_state() == TaskState::pending);
+        go = true;
+        REQUIRE(any.get_result() == 1);
+
+        auto c = pool->add_task([]() {}, 1h);
+        auto d = pool->add_task([]() {}, 1h);
+        auto none = when_any(c, d);
+        c.cancel();
+        d.cancel();
+        REQUIRE(none.get_state() == TaskState::canceled);
+    }
 }
 
-TEST_CASE("ThreadPool: get_running_task_names()", "[ThreadPool]")
+TEST_CASE("ThreadPool: add_tasks()", "[ThreadPool]")
 {
-    auto pool = make_thread_pool(1);
+    std::atomic<int> sum{ 0 };
 
-    REQUIRE(pool->get_running_task_names().empty());
+    SECTION("All tasks of a batch are executed")
+    {
+        auto pool = make_thread_pool(3, 1000);
 
-    std::atomic<bool> stop{ false };
+        std::vector<std::function<void()>> jobs;
+        for (int i = 1; i <= 1000; ++i)
+            jobs.push_back([&sum, i]() { sum += i; });
 
-    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); }, "1");
-    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); }, "2");
+        auto batch = pool->add_tasks(jobs, "batch");
+        REQUIRE(batch.size() == 1000);
 
-    while (pool->count_pending() == 2)
-        gul14::sleep(1ms);
+        batch.wait();
+        REQUIRE(batch.is_complete());
+        REQUIRE(batch.count_remaining() == 0);
+        REQUIRE(sum == 500500);
+        REQUIRE(batch.cancel() == 0);
+    }
+
+    SECTION("Functions taking ThreadPool&, iterator interface")
+    {
+        auto pool = make_thread_pool(2);
+
+        std::array<std::function<int(ThreadPool&)>, 3> jobs;
+        jobs.fill([&sum](ThreadPool&) { return ++sum; });
+
+        auto batch = pool->add_tasks(jobs.begin(), jobs.end());
+        batch.wait();
+        REQUIRE(sum == 3);
+    }
+
+    SECTION("Batches are added completely or not at all")
+    {
+        auto pool = make_thread_pool(1, 10);
+
+        std::atomic<bool> go{ false };
+        pool->add_task([&go]() { while (!go) gul14::sleep(10us); });
+        while (pool->count_pending() != 0)
+            gul14::sleep(10us);
+
+        std::vector<std::function<void()>> jobs(11, [&sum]() { ++sum; });
+        REQUIRE_THROWS_AS(pool->add_tasks(jobs), std::runtime_error);
+        REQUIRE(pool->count_pending() == 0);
+
+        jobs.resize(10);
+        auto batch = pool->add_tasks(jobs);
+        REQUIRE(pool->count_pending() == 10);
+        REQUIRE(pool->is_full());
+
+        go = true;
+        batch.wait();
+        REQUIRE(sum == 10);
+    }
+
+    SECTION("cancel() removes the tasks that have not been started")
+    {
+        auto pool = make_thread_pool(1);
+
+        Trigger go;
+        pool->add_task([&go]() { go.wait(); });
+        while (pool->count_pending() != 0)
+            gul14::sleep(10us);
+
+        std::vector<std::function<void()>> jobs(100, [&sum]() { ++sum; });
+        auto batch = pool->add_tasks(jobs);
+        pool->add_task([&sum]() { sum += 1000; });
+
+        REQUIRE(pool->count_pending() == 101);
+        REQUIRE(batch.cancel() == 100);
+        REQUIRE(batch.is_complete());
+        REQUIRE(pool->count_pending() == 1);
+        REQUIRE(batch.cancel() == 0);
+
+        go = true;
+        while (not pool->is_idle())
+            gul14::sleep(1ms);
+
+        REQUIRE(sum == 1000);
+        batch.wait(); // must not block
+    }
+
+    SECTION("wait() rethrows the first exception")
+    {
+        auto pool = make_thread_pool(1);
+
+        std::vector<std::function<void()>> jobs{
+            [&sum]() { ++sum; },
+            []() { throw std::runtime_error("first"); },
+            []() { throw std::logic_error("second"); },
+            [&sum]() { ++sum; } };
+
+        auto batch = pool->add_tasks(jobs);
+        REQUIRE_THROWS_AS(batch.wait(), std::runtime_error);
+        REQUIRE(sum == 2);
+    }
+
+    SECTION("Destroying the pool completes the batch")
+    {
+        auto pool = make_thread_pool(1);
+
+        Trigger go;
+        pool->add_task([&go]() { go.wait(); });
+        while (pool->count_pending() != 0)
+            gul14::sleep(10us);
+
+        std::vector<std::function<void()>> jobs(5, [&sum]() { ++sum; });
+        auto batch = pool->add_tasks(jobs);
+
+        go = true;
+        pool.reset();
+
+        batch.wait();
+        REQUIRE(batch.is_complete());
+        REQUIRE_THROWS_AS(batch.cancel(), std::logic_error);
+    }
+
+    SECTION("Batches submitted from a worker in work-stealing mode")
+    {
+        ThreadPoolOptions options;
+        options.num_threads = 4;
+        options.work_stealing = true;
+        auto pool = make_thread_pool(options);
+
+        auto handle = pool->add_task(
+            [&sum](ThreadPool& p)
+            {
+                std::vector<std::function<void()>> jobs(100, [&sum]() { ++sum; });
+                return p.add_tasks(jobs);
+            });
+
+        handle.get_result().wait();
+        REQUIRE(sum == 100);
+    }
+}
+
+TEST_CASE("ThreadPool: add_detached_task()", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(2);
+
+    std::atomic<int> sum{ 0 };
+
+    SECTION("Functions with and without ThreadPool&")
+    {
+        for (int i = 1; i <= 100; ++i)
+        {
+            if (i % 2)
+                pool->add_detached_task([&sum, i]() { sum += i; });
+            else
+                pool->add_detached_task([&sum, i](ThreadPool&) { sum += i; });
+        }
+
+        while (not pool->is_idle())
+            gul14::sleep(1ms);
+
+        REQUIRE(sum == 5050);
+    }
+
+    SECTION("Delayed tasks")
+    {
+        pool->add_detached_task([&sum]() { sum += 1; }, 1ms);
+        pool->add_detached_task([&sum]() { sum += 2; },
+            std::chrono::system_clock::now() + 120s);
+
+        while (sum == 0)
+            gul14::sleep(1ms);
+
+        REQUIRE(sum == 1);
+        REQUIRE(pool->count_pending() == 1);
+        REQUIRE(pool->cancel_pending_tasks() == 1);
+        REQUIRE(pool->count_pending() == 0);
+    }
+
+    SECTION("Exceptions are ignored")
+    {
+        pool->add_detached_task([]() { throw std::runtime_error("Test"); });
+        pool->add_detached_task([&sum]() { sum = 42; });
+
+        while (not pool->is_idle())
+            gul14::sleep(1ms);
+
+        REQUIRE(sum == 42);
+    }
+
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: Adding tasks does not allocate memory in steady state",
+    "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1, 1000);
+    Trigger go;
+    std::atomic<int> counter{ 0 };
+
+    // The handles are discarded right away, so the shared states of the tasks are
+    // freed on the worker thread and not on this one
+    const auto add_tasks = [&pool, &counter](int num_tasks)
+        {
+            for (int i = 0; i != num_tasks; ++i)
+                pool->add_task([&counter]() { ++counter; });
+        };
+
+    // Warm up with more tasks in flight than below: The worker thread can keep at most
+    // 256 freed blocks in its own cache, all others are handed back via the depot
+    pool->add_task([&go]() { go.wait(); });
+    add_tasks(500);
+    go = true;
+    while (!pool->is_idle())
+        gul14::sleep(10us);
+
+    const std::size_t num_allocations_before = num_allocations;
+    for (int round = 0; round != 20; ++round)
+    {
+        add_tasks(100);
+        while (!pool->is_idle())
+            gul14::sleep(10us);
+    }
+    const std::size_t num_new_allocations = num_allocations - num_allocations_before;
+
+    REQUIRE(num_new_allocations == 0);
+    REQUIRE(counter == 2500);
+}
+
+TEST_CASE("ThreadPool: add_task() with a large function object", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1);
+
+    // Too large for the inline buffer of the task queue
+    std::array<int, 100> values;
+    for (int i = 0; i != 100; ++i)
+        values[i] = i;
+
+    auto handle = pool->add_task(
+        [values]()
+        {
+            int sum = 0;
+            for (int v : values)
+                sum += v;
+            return sum;
+        });
+
+    REQUIRE(handle.get_result() == 4950);
+}
+
+TEST_CASE("ThreadPool: cancel_pending_tasks()", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1);
+
+    std::atomic<bool> stop{ false };
+
+    auto task1 = pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
+    auto task2 = pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
+    auto task3 = pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
+
+    while (task1.get_state() == TaskState::pending)
+        gul14::sleep(1ms);
+
+    REQUIRE(task1.get_state() != TaskState::complete);
+    REQUIRE(task1.get_state() != TaskState::canceled);
+    REQUIRE(task2.get_state() == TaskState::pending);
+    REQUIRE(task3.get_state() == TaskState::pending);
+
+    REQUIRE(pool->cancel_pending_tasks() == 2);
+    REQUIRE(pool->count_pending() == 0);
+    REQUIRE(pool->cancel_pending_tasks() == 0);
+
+    stop = true;
+
+    // Make sure the pool is removed before any of the atomic variables go out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: capacity()", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1, 128);
+    REQUIRE(pool->capacity() == 128);
+}
+
+TEST_CASE("ThreadPool: count_pending()", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1);
+
+    std::atomic<bool> stop{ false };
+
+    // Insert 11 work items
+    for (std::size_t i = 0; i <= 10; ++i)
+    {
+        REQUIRE(pool->is_full() == false);
+        pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
+    }
+
+    // One work item might already be executing, the queue should have 10 or 11 pending
+    // items
+    REQUIRE(pool->count_pending() >= 10);
+    REQUIRE(pool->count_pending() <= 11);
+
+    stop = true;
+
+    // Make sure the pool is removed before any of the atomic variables go out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: count_threads()", "[ThreadPool]")
+{
+    for (std::size_t i = 1; i <= 2; ++i)
+    {
+        auto pool = make_thread_pool(i);
+        REQUIRE(pool->count_threads() == i);
+    }
+}
+
+TEST_CASE("ThreadPool: get_pending_task_names()", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1);
+
+    REQUIRE(pool->get_pending_task_names().empty());
+
+    std::atomic<bool> stop{ false };
+
+    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); }, "1");
+    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); }, "2");
+    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); }, "3");
+
+    while (pool->count_pending() == 3)
+        gul14::sleep(1ms);
+
+    auto pending_names = pool->get_pending_task_names();
+    REQUIRE(pending_names.size() == 2);
+    REQUIRE(pending_names[0] == "2");
+    REQUIRE(pending_names[1] == "3");
+
+    stop = true;
+
+    // Make sure the pool is removed before any of the atomic variables go out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: get_running_task_names()", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1);
+
+    REQUIRE(pool->get_running_task_names().empty());
+
+    std::atomic<bool> stop{ false };
+
+    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); }, "1");
+    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); }, "2");
+
+    while (pool->count_pending() == 2)
+        gul14::sleep(1ms);
 
     auto running_names = pool->get_running_task_names();
     REQUIRE(running_names.size() == 1);
@@ -452,235 +1282,1732 @@ TEST_CASE("ThreadPool: get_running_task_names()", "[ThreadPool]")
     pool.reset();
 }
 
-TEST_CASE("ThreadPool: get_thread_id()", "[ThreadPool]")
+TEST_CASE("ThreadPool: TaskName", "[ThreadPool]")
 {
-    std::array<std::atomic<ThreadPool::ThreadId>, 2> indices;
-    Trigger trigger;
+    using TaskName = ThreadPool::TaskName;
 
-    auto pool = make_thread_pool(2);
+    SECTION("Construction")
+    {
+        REQUIRE(TaskName{}.empty());
+        REQUIRE(TaskName{ "" }.empty());
+        REQUIRE(TaskName{ std::string{} }.empty());
+
+        static const char literal[] = "literal";
+        const auto from_literal = TaskName::literal(literal);
+        REQUIRE(from_literal.c_str() == literal);
+
+        const TaskName from_array{ literal };
+        REQUIRE(from_array.c_str() != literal);
+        REQUIRE(from_array.c_str() == "literal"s);
+
+        std::string str = "string";
+        const TaskName from_string{ str };
+        str = "changed";
+        REQUIRE(from_string.c_str() == "string"s);
+
+        const char* ptr = str.c_str();
+        const TaskName from_pointer{ ptr };
+        REQUIRE(from_pointer.c_str() != ptr);
+        REQUIRE(from_pointer.c_str() == "changed"s);
+
+        char buffer[16] = "buffer";
+        const TaskName from_buffer{ buffer };
+        std::strcpy(buffer, "overwritten");
+        REQUIRE(from_buffer.c_str() == "buffer"s);
+    }
+
+    SECTION("intern()")
+    {
+        const auto a = TaskName::intern("interned");
+        const auto b = TaskName::intern("interned"s);
+        const auto c = TaskName::intern("other");
+
+        REQUIRE(a.c_str() == "interned"s);
+        REQUIRE(a.c_str() == b.c_str());
+        REQUIRE(a.c_str() != c.c_str());
+        REQUIRE(TaskName::intern("").empty());
+    }
+
+    SECTION("Names of pending and running tasks")
+    {
+        auto pool = make_thread_pool(1);
+        Trigger go;
+
+        const std::string dynamic_name = "dynamic";
+
+        pool->add_task([&go]() { go.wait(); }, TaskName::intern("interned"));
+        pool->add_task([]() {}, TaskName::literal("literal"));
+        pool->add_task([]() {});
+        pool->add_task([]() {}, dynamic_name);
+
+        while (pool->count_pending() == 4)
+            gul14::sleep(1ms);
+
+        REQUIRE(pool->get_running_task_names() == std::vector<std::string>{ "interned" });
+        REQUIRE(pool->get_pending_task_names()
+            == std::vector<std::string>{ "literal", "", "dynamic" });
+
+        go = true;
+        while (!pool->is_idle())
+            gul14::sleep(1ms);
+
+        REQUIRE(pool->get_running_task_names().empty());
+    }
+
+    SECTION("Names from a reused buffer are copied")
+    {
+        auto pool = make_thread_pool(1);
+        Trigger go;
+
+        pool->add_task([&go]() { go.wait(); });
+        while (pool->count_pending() != 0)
+            gul14::sleep(1ms);
+
+        char buffer[16];
+        for (int i = 0; i != 3; ++i)
+        {
+            std::snprintf(buffer, sizeof(buffer), "task %d", i);
+            pool->add_task([]() {}, buffer);
+        }
+        std::strcpy(buffer, "CLOBBERED");
+
+        REQUIRE(pool->get_pending_task_names()
+            == std::vector<std::string>{ "task 0", "task 1", "task 2" });
+
+        go = true;
+        while (!pool->is_idle())
+            gul14::sleep(1ms);
+    }
+
+    SECTION("Names from a local const char array are copied")
+    {
+        auto pool = make_thread_pool(1);
+        Trigger go;
+
+        pool->add_task([&go]() { go.wait(); });
+        while (pool->count_pending() != 0)
+            gul14::sleep(1ms);
+
+        // The array goes out of scope (and its storage is reused) before the task runs
+        const auto add_named_task = [&pool](int i)
+            {
+                const char name[] = { 'l', 'o', 'c', 'a', 'l', ' ',
+                    static_cast<char>('0' + i), '\0' };
+                pool->add_task([]() {}, name);
+            };
+        add_named_task(1);
+        add_named_task(2);
+
+        REQUIRE(pool->get_pending_task_names()
+            == std::vector<std::string>{ "local 1", "local 2" });
+
+        go = true;
+        while (!pool->is_idle())
+            gul14::sleep(1ms);
+    }
+
+    SECTION("Periodic tasks keep their name")
+    {
+        auto pool = make_thread_pool(1);
+        std::atomic<int> num_runs{ 0 };
+        std::vector<std::string> names;
+
+        auto task = pool->add_periodic_task(
+            [&num_runs, &names](ThreadPool& p)
+            {
+                if (num_runs == 2)
+                    names = p.get_running_task_names();
+                ++num_runs;
+            },
+            1ms, "periodic"s);
+
+        while (num_runs < 3)
+            gul14::sleep(1ms);
+
+        task.cancel();
+        REQUIRE(names == std::vector<std::string>{ "periodic" });
+    }
+}
+
+TEST_CASE("ThreadPool: get_statistics()", "[ThreadPool]")
+{
+    const auto sum = [](const ThreadPoolStatistics::Histogram& histogram)
+        {
+            std::uint64_t total = 0;
+            for (auto count : histogram)
+                total += count;
+            return total;
+        };
+
+    ThreadPoolOptions options;
+    options.num_threads = 2;
+
+    SECTION("Counters")
+    {
+        auto pool = make_thread_pool(options);
+
+        auto stats = pool->get_statistics();
+        REQUIRE(stats.num_submitted == 0);
+        REQUIRE(stats.num_started == 0);
+        REQUIRE(stats.num_completed == 0);
+        REQUIRE(stats.num_canceled == 0);
+        REQUIRE(stats.workers.size() == 2);
+
+        for (int i = 0; i != 10; ++i)
+            pool->add_task([]() {}).get_result();
+
+        auto delayed = pool->add_task([]() {}, 1h);
+        delayed.cancel();
+
+        // The result is available before the worker has updated its counters
+        stats = pool->get_statistics();
+        while (stats.num_completed != 10)
+        {
+            gul14::sleep(1ms);
+            stats = pool->get_statistics();
+        }
+
+        REQUIRE(stats.num_submitted == 11);
+        REQUIRE(stats.num_started == 10);
+        REQUIRE(stats.num_completed == 10);
+        REQUIRE(stats.num_canceled == 1);
+        REQUIRE(stats.workers[0].num_completed + stats.workers[1].num_completed == 10);
+
+        // Without measurement, no times are recorded
+        REQUIRE(sum(stats.queue_wait_times) == 0);
+        REQUIRE(sum(stats.execution_times) == 0);
+        REQUIRE(stats.workers[0].busy_time == ThreadPoolStatistics::Duration{ 0 });
+    }
+
+    SECTION("Times")
+    {
+        options.measure_task_times = true;
+        auto pool = make_thread_pool(options);
+
+        pool->add_task([]() { gul14::sleep(20ms); });
+        pool->add_task([]() { gul14::sleep(20ms); });
+        auto last = pool->add_task([]() {});
+        last.get_result();
+
+        auto stats = pool->get_statistics();
+        while (stats.num_completed != 3)
+        {
+            gul14::sleep(1ms);
+            stats = pool->get_statistics();
+        }
+
+        REQUIRE(sum(stats.queue_wait_times) == 3);
+        REQUIRE(sum(stats.execution_times) == 3);
+
+        // The last task had to wait for one of the 20 ms tasks
+        std::size_t max_wait_bin = 0;
+        for (std::size_t bin = 0; bin != ThreadPoolStatistics::num_bins; ++bin)
+        {
+            if (stats.queue_wait_times[bin] != 0)
+                max_wait_bin = bin;
+        }
+        REQUIRE(ThreadPoolStatistics::get_bin_lower_limit(max_wait_bin + 1) > 10ms);
+
+        auto busy = stats.workers[0].busy_time + stats.workers[1].busy_time;
+        REQUIRE(busy >= 40ms);
+    }
+
+    SECTION("Histogram bins")
+    {
+        REQUIRE(ThreadPoolStatistics::get_bin_lower_limit(0) == 0us);
+        REQUIRE(ThreadPoolStatistics::get_bin_lower_limit(1) == 1us);
+        REQUIRE(ThreadPoolStatistics::get_bin_lower_limit(11) == 1024us);
+    }
+}
+
+TEST_CASE("ThreadPool: get_trace_json()", "[ThreadPool]")
+{
+    ThreadPoolOptions options;
+    options.num_threads = 2;
+
+    SECTION("Tracing disabled")
+    {
+        auto pool = make_thread_pool(options);
+        pool->add_task([]() {}, "Task").get_result();
+
+        REQUIRE(pool->get_trace_json() == R"({"traceEvents":[],"displayTimeUnit":"ms"})");
+    }
+
+    SECTION("Tracing enabled")
+    {
+        options.trace_buffer_size = 4;
+        auto pool = make_thread_pool(options);
+
+        pool->add_task([]() {}, "Task \"1\"").get_result();
+        pool->add_task([]() {}).get_result();
+
+        // The result is available before the worker has recorded the event
+        std::string json;
+        do
+        {
+            gul14::sleep(1ms);
+            json = pool->get_trace_json();
+        }
+        while (json.find("(unnamed)") == std::string::npos);
+
+        REQUIRE(json.find(R"({"traceEvents":[)") == 0);
+        REQUIRE(json.find(R"("name":"thread_name","ph":"M")") != std::string::npos);
+        REQUIRE(json.find(R"("name":"Task \"1\"","ph":"X")") != std::string::npos);
+        REQUIRE(json.find(R"("ts":)") != std::string::npos);
+        REQUIRE(json.find(R"("dur":)") != std::string::npos);
+    }
+
+    SECTION("Old events are overwritten")
+    {
+        options.num_threads = 1;
+        options.trace_buffer_size = 2;
+        auto pool = make_thread_pool(options);
+
+        for (int i = 0; i != 5; ++i)
+            pool->add_task([]() {}, cat("T", i)).get_result();
+        pool->add_task([]() {}, "Last");
+
+        std::string json;
+        do
+        {
+            gul14::sleep(1ms);
+            json = pool->get_trace_json();
+        }
+        while (json.find("Last") == std::string::npos);
+
+        REQUIRE(json.find(R"("T3")") == std::string::npos);
+        REQUIRE(json.find(R"("T4")") != std::string::npos);
+    }
+}
+
+TEST_CASE("ThreadPool: get_thread_id()", "[ThreadPool]")
+{
+    std::array<std::atomic<ThreadPool::ThreadId>, 2> indices;
+    Trigger trigger;
+
+    auto pool = make_thread_pool(2);
+
+    pool->add_task(
+        [&](ThreadPool& p) { trigger.wait(); indices[0] = p.get_thread_id(); });
+    pool->add_task(
+        [&](ThreadPool& p) { trigger.wait(); indices[1] = p.get_thread_id(); });
+
+    while (pool->count_pending() > 0)
+        gul14::sleep(1ms);
+
+    trigger = true;
+
+    // From a non-worker thread, the function must throw.
+    REQUIRE_THROWS_AS(pool->get_thread_id(), std::runtime_error);
+
+    pool.reset();
+
+    CAPTURE(indices);
+    REQUIRE(indices[0] <= 1);
+    REQUIRE(indices[1] <= 1);
+    if (indices[0] == 0)
+        REQUIRE(indices[1] == 1);
+    if (indices[0] == 1)
+        REQUIRE(indices[1] == 0);
+}
+
+TEST_CASE("ThreadPool: is_full()", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1);
+
+    std::atomic<bool> stop{ false };
+
+    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
+
+    // Wait until the first task is running
+    while (pool->count_pending() > 0)
+        gul14::sleep(1ms);
+
+    // Enqueue tasks up to the capacity of the pool
+    for (std::size_t i = 1; i <= pool->capacity(); ++i)
+    {
+        REQUIRE(pool->is_full() == false);
+        pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
+    }
+
+    // One work item is currently executing, the queue is full
+    REQUIRE(pool->is_full());
+
+    stop = true;
+
+    // Make sure the pool is removed before any of the atomic variables go out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: is_idle()", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1);
+    REQUIRE(pool->is_idle());
+}
+
+TEST_CASE("ThreadPool: Run 100 functions on a single thread, check order", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1);
+
+    std::vector<std::function<void()>> functions;
+
+    std::mutex mutex;
+    std::vector<int> output;
+
+    for (int i = 1; i <= 100; ++i)
+    {
+        functions.emplace_back(
+            [i, &mutex, &output]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                output.push_back(i);
+            });
+    }
+
+    for (auto& fct : functions)
+        pool->add_task(fct);
+
+    while (not pool->is_idle())
+    {
+        REQUIRE(pool->count_pending() <= functions.size());
+        REQUIRE(pool->count_pending() <= pool->capacity());
+        gul14::sleep(1ms);
+    }
+
+    REQUIRE(output.size() == 100);
+
+    for (int i = 0; i != 100; ++i)
+        REQUIRE(output[i] == i + 1);
+
+    // Make sure the pool is removed before any of the captured variables go out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: Run 100 functions on 4 threads", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(4);
+
+    std::mutex mutex;
+    std::vector<int> output;
+
+    for (int i = 1; i <= 100; ++i)
+    {
+        pool->add_task(
+            [i, &mutex, &output]()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    output.push_back(i);
+                }
+                gul14::sleep(100us);
+            });
+    }
+
+    while (not pool->is_idle())
+    {
+        REQUIRE(pool->count_pending() <= 100);
+        REQUIRE(pool->count_pending() <= pool->capacity());
+        gul14::sleep(1ms);
+    }
+
+    REQUIRE(output.size() == 100);
+
+    std::sort(output.begin(), output.end());
+
+    for (int i = 0; i != 100; ++i)
+        REQUIRE(output[i] == i + 1);
+
+    // Make sure the pool is removed before any of the captured variables go out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: Capacity limit", "[ThreadPool]")
+{
+    std::size_t max_jobs{ 10 };
+    auto pool = make_thread_pool(1, max_jobs);
+
+    std::atomic<bool> go{ false };
+
+    for (std::size_t i = 0; i != max_jobs; ++i)
+    {
+        pool->add_task(
+            [&go]()
+            {
+                while (!go)
+                    gul14::sleep(100us);
+            });
+    }
+
+    // Wait until first job has started
+    while (pool->count_pending() != max_jobs - 1)
+        gul14::sleep(1ms);
+
+    // Add yet another task, filling the queue
+    pool->add_task(
+        [&go]()
+        {
+            while (!go)
+                gul14::sleep(100us);
+        });
+    REQUIRE(pool->is_full());
+
+    REQUIRE_THROWS_AS(pool->add_task([]() {}), std::runtime_error);
+
+    go = true;
+
+    while (not pool->is_idle())
+    {
+        REQUIRE(pool->count_pending() <= max_jobs);
+        gul14::sleep(1ms);
+    }
+
+    REQUIRE_NOTHROW(pool->add_task([]() {}));
+
+    // Make sure the pool is removed before any captured variable goes out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: Deadlines", "[ThreadPool]")
+{
+    ThreadPoolOptions options;
+    options.num_threads = 1;
+
+    SECTION("Tasks that miss their deadline expire without running")
+    {
+        auto pool = make_thread_pool(options);
+
+        Trigger go;
+        pool->add_task([&go]() { go.wait(); });
+
+        std::atomic<bool> called{ false };
+        auto expired = pool->add_task([&called]() { called = true; return 1; },
+            ThreadPool::Deadline{ 10ms });
+        auto dependent = pool->add_task([]() {}, after(expired));
+        auto in_time = pool->add_task([](ThreadPool&) { return 2; },
+            ThreadPool::Deadline{ std::chrono::steady_clock::now() + 1h }, "in time");
+
+        gul14::sleep(20ms);
+        go = true;
+
+        REQUIRE(in_time.get_result() == 2);
+        REQUIRE(expired.get_state() == TaskState::expired);
+        REQUIRE(expired.is_complete() == false);
+        REQUIRE_THROWS_AS(expired.get_result(), std::logic_error);
+        REQUIRE(called == false);
+        REQUIRE(dependent.get_state() == TaskState::canceled);
+        REQUIRE(pool->count_pending() == 0);
+        REQUIRE(pool->get_statistics().num_expired == 1);
+
+        // Make sure the pool is removed before any captured variable goes out of scope
+        pool.reset();
+    }
+
+    SECTION("Earliest deadline first")
+    {
+        options.earliest_deadline_first = true;
+        auto pool = make_thread_pool(options);
+
+        Trigger go;
+        pool->add_task([&go]() { go.wait(); });
+
+        std::mutex mutex;
+        std::vector<int> order;
+        const auto record = [&mutex, &order](int i)
+            {
+                return [&mutex, &order, i]()
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        order.push_back(i);
+                    };
+            };
+
+        pool->add_task(record(0));
+        pool->add_task(record(3), ThreadPool::Deadline{ 3h });
+        pool->add_task(record(1), ThreadPool::Deadline{ 1h });
+        auto canceled = pool->add_task(record(-1), ThreadPool::Deadline{ 1h });
+        pool->add_task(record(2), ThreadPool::Deadline{ 2h });
+        canceled.cancel();
+
+        go = true;
+        while (!pool->is_idle())
+            gul14::sleep(1ms);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        REQUIRE(order == std::vector<int>{ 1, 2, 3, 0 });
+    }
+}
+
+TEST_CASE("ThreadPool: Strands", "[ThreadPool]")
+{
+    ThreadPoolOptions options;
+    options.num_threads = 4;
+    options.capacity = 1000;
+
+    SECTION("Tasks on a strand run in order and never concurrently")
+    {
+        for (bool work_stealing : { false, true })
+        {
+            options.work_stealing = work_stealing;
+            auto pool = make_thread_pool(options);
+            auto strand = pool->make_strand();
+
+            std::vector<int> order; // no mutex: the strand serializes the accesses
+            std::atomic<bool> running{ false };
+            std::atomic<bool> overlap{ false };
+
+            for (int i = 0; i != 200; ++i)
+            {
+                pool->add_task(
+                    [&order, &running, &overlap, i]()
+                    {
+                        if (running.exchange(true))
+                            overlap = true;
+                        order.push_back(i);
+                        running = false;
+                    }, strand);
+            }
+
+            auto last = pool->add_task([](ThreadPool&) { return 42; }, strand, "last");
+            REQUIRE(last.get_result() == 42);
+
+            REQUIRE(overlap == false);
+            REQUIRE(order.size() == 200);
+            for (int i = 0; i != 200; ++i)
+                REQUIRE(order[i] == i);
+        }
+    }
+
+    SECTION("Waiting tasks do not occupy a worker")
+    {
+        options.num_threads = 2;
+        Trigger go;
+        auto pool = make_thread_pool(options);
+        auto strand = pool->make_strand();
+
+        auto first = pool->add_task([&go]() { go.wait(); }, strand);
+        auto second = pool->add_task([]() { return 2; }, strand);
+        auto third = pool->add_task([]() { return 3; }, strand);
+
+        // The second worker is free for other tasks
+        REQUIRE(pool->add_task([]() { return 1; }).get_result() == 1);
+        REQUIRE(second.get_state() == TaskState::pending);
+        REQUIRE(pool->count_pending() == 2);
+
+        go = true;
+        REQUIRE(second.get_result() == 2);
+        REQUIRE(third.get_result() == 3);
+    }
+
+    SECTION("Different strands run in parallel")
+    {
+        auto pool = make_thread_pool(options);
+        auto strand_a = pool->make_strand();
+        auto strand_b = pool->make_strand();
+
+        Trigger a_started;
+        Trigger b_started;
+
+        auto a = pool->add_task(
+            [&]() { a_started = true; return b_started.wait_for(10s); }, strand_a);
+        auto b = pool->add_task(
+            [&]() { b_started = true; return a_started.wait_for(10s); }, strand_b);
+
+        REQUIRE(a.get_result() == true);
+        REQUIRE(b.get_result() == true);
+    }
+
+    SECTION("Canceled tasks are skipped")
+    {
+        Trigger go;
+        auto pool = make_thread_pool(options);
+        auto strand = pool->make_strand();
+
+        std::atomic<int> counter{ 0 };
+        auto first = pool->add_task([&go]() { go.wait(); }, strand);
+        auto second = pool->add_task([&counter]() { ++counter; }, strand);
+        auto third = pool->add_task([&counter]() { return ++counter; }, strand);
+
+        second.cancel();
+        REQUIRE(second.get_state() == TaskState::canceled);
+
+        go = true;
+        REQUIRE(third.get_result() == 1);
+        REQUIRE(counter == 1);
+
+    }
+
+    SECTION("A canceled task in the shared queue passes on its turn")
+    {
+        Trigger go;
+        auto pool = make_thread_pool(1);
+        auto strand = pool->make_strand();
+
+        pool->add_task([&go]() { go.wait(); }); // occupies the only worker
+        auto first = pool->add_task([]() {}, strand); // in the shared queue
+        auto second = pool->add_task([]() { return 2; }, strand); // in the strand
+        first.cancel();
+
+        go = true;
+        REQUIRE(second.get_result() == 2);
+        REQUIRE(first.get_state() == TaskState::canceled);
+    }
+
+    SECTION("cancel_pending_tasks() removes the tasks of strands")
+    {
+        Trigger go;
+        auto pool = make_thread_pool(options);
+        auto strand = pool->make_strand();
+
+        auto first = pool->add_task([&go]() { go.wait(); }, strand, "first");
+        for (int i = 0; i != 10; ++i)
+            pool->add_task([]() {}, strand, "waiting");
+
+        while (first.get_state() != TaskState::running)
+            gul14::sleep(1ms);
+
+        REQUIRE(pool->get_pending_task_names().size() == 10);
+        REQUIRE(pool->cancel_pending_tasks() == 10);
+        REQUIRE(pool->count_pending() == 0);
+
+        go = true;
+        first.get_result();
+
+        // The strand can be used again afterwards
+        REQUIRE(pool->add_task([]() { return 6; }, strand).get_result() == 6);
+    }
+
+    SECTION("Invalid strands")
+    {
+        auto pool = make_thread_pool(options);
+        auto other_pool = make_thread_pool(1);
+
+        REQUIRE_THROWS_AS(pool->add_task([]() {}, ThreadPool::Strand{}),
+            std::invalid_argument);
+        REQUIRE_THROWS_AS(pool->add_task([]() {}, other_pool->make_strand()),
+            std::invalid_argument);
+        REQUIRE(pool->count_pending() == 0);
+    }
+}
+
+TEST_CASE("ThreadPool: Task groups", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(2);
+
+    SECTION("wait_all() waits for all tasks of the group")
+    {
+        auto group = pool->make_task_group();
+        std::atomic<int> counter{ 0 };
+
+        for (int i = 0; i != 50; ++i)
+            pool->add_task([&counter]() { gul14::sleep(100us); ++counter; }, group);
+
+        group.wait_all();
+        REQUIRE(counter == 50);
+        REQUIRE(group.count_unfinished() == 0);
+
+        // The group can be reused
+        auto task = pool->add_task([]() { return 42; }, group, "named");
+        group.wait_all();
+        REQUIRE(task.get_state() == TaskState::complete);
+        REQUIRE(task.get_result() == 42);
+    }
+
+    SECTION("cancel() cancels only the pending tasks of the group")
+    {
+        Trigger go;
+        std::atomic<bool> stop_seen{ false };
+        auto group = pool->make_task_group();
+        auto other_group = pool->make_task_group();
+
+        auto running = pool->add_task(
+            [&go, &stop_seen](ThreadPool& p)
+            {
+                const auto token = p.get_cancellation_token();
+                go.wait();
+                stop_seen = token.is_cancellation_requested();
+            }, group);
+        pool->add_task([&go]() { go.wait(); });
+
+        while (pool->count_pending() != 0)
+            gul14::sleep(1ms);
+
+        std::vector<ThreadPool::TaskHandle<void>> members;
+        for (int i = 0; i != 10; ++i)
+            members.push_back(pool->add_task([]() {}, group));
+        auto other = pool->add_task([]() {}, other_group);
+        auto ungrouped = pool->add_task([]() {});
+
+        REQUIRE(group.count_unfinished() == 11);
+        REQUIRE(other_group.count_unfinished() == 1);
+
+        REQUIRE(group.cancel() == 10);
+        REQUIRE(group.count_unfinished() == 1);
+        for (auto& member : members)
+            REQUIRE(member.get_state() == TaskState::canceled);
+        REQUIRE(pool->count_pending() == 2);
+
+        go = true;
+        group.wait_all();
+        other_group.wait_all();
+
+        REQUIRE(running.get_state() == TaskState::complete);
+        REQUIRE(stop_seen == true);
+        REQUIRE(other.get_state() == TaskState::complete);
+        ungrouped.get_result();
+
+        while (!pool->is_idle())
+            gul14::sleep(1ms);
+    }
+
+    SECTION("Tasks leave the group when they are canceled individually")
+    {
+        Trigger go;
+        auto group = pool->make_task_group();
+
+        pool->add_task([&go]() { go.wait(); });
+        pool->add_task([&go]() { go.wait(); });
+        while (pool->count_pending() != 0)
+            gul14::sleep(1ms);
+
+        auto task = pool->add_task([]() {}, group);
+        REQUIRE(group.count_unfinished() == 1);
+        REQUIRE(task.cancel() == true);
+        REQUIRE(group.count_unfinished() == 0);
+        group.wait_all();
+
+        go = true;
+        while (!pool->is_idle())
+            gul14::sleep(1ms);
+    }
+
+    SECTION("Tasks can be added while another thread waits for or cancels the group")
+    {
+        constexpr int num_tasks = 1000;
+        auto group = pool->make_task_group();
+        std::atomic<int> num_run{ 0 };
+        std::atomic<bool> done{ false };
+        std::vector<ThreadPool::TaskHandle<void>> tasks;
+
+        std::thread producer(
+            [&]()
+            {
+                for (int i = 0; i != num_tasks; ++i)
+                {
+                    while (pool->is_full())
+                        std::this_thread::yield();
+                    tasks.push_back(pool->add_task([&num_run]() { ++num_run; }, group));
+                }
+                done = true;
+            });
+
+        std::size_t num_canceled = 0;
+        while (!done)
+        {
+            num_canceled += group.cancel();
+            group.wait_all();
+        }
+        producer.join();
+        group.wait_all();
+
+        REQUIRE(group.count_unfinished() == 0);
+
+        int num_complete = 0;
+        std::size_t num_canceled_tasks = 0;
+        for (const auto& task : tasks)
+        {
+            const auto state = task.get_state();
+            if (state == TaskState::complete)
+                ++num_complete;
+            else if (state == TaskState::canceled)
+                ++num_canceled_tasks;
+        }
+        REQUIRE(num_complete == num_run);
+        REQUIRE(num_complete + static_cast<int>(num_canceled_tasks) == num_tasks);
+        REQUIRE(num_canceled <= num_canceled_tasks);
+    }
+
+    SECTION("Invalid groups")
+    {
+        ThreadPool::TaskGroup invalid;
+        REQUIRE(invalid.count_unfinished() == 0);
+        REQUIRE(invalid.cancel() == 0);
+        invalid.wait_all();
+        REQUIRE_THROWS_AS(pool->add_task([]() {}, invalid), std::invalid_argument);
+
+        auto other_pool = make_thread_pool(1);
+        auto foreign = other_pool->make_task_group();
+        REQUIRE_THROWS_AS(pool->add_task([]() {}, foreign), std::invalid_argument);
+        REQUIRE(pool->count_pending() == 0);
+    }
+
+    // Make sure the pool is removed before any captured variable goes out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: Back-pressure with try_add_task() and add_task_blocking()",
+    "[ThreadPool]")
+{
+    Trigger go;
+    auto pool = make_thread_pool(1, 2);
+
+    // Occupy the worker and fill the queue
+    pool->add_task([&go]() { go.wait(); });
+    while (pool->count_pending() != 0)
+        gul14::sleep(1ms);
+    pool->add_task([]() { return 1; });
+    pool->add_task([](ThreadPool&) { return 2; });
+    REQUIRE(pool->is_full());
+
+    SECTION("try_add_task()")
+    {
+        REQUIRE_FALSE(pool->try_add_task([]() { return 3; }).has_value());
+        REQUIRE_FALSE(pool->try_add_task([](ThreadPool&) {}, "Name").has_value());
+
+        go = true;
+        while (!pool->is_idle())
+            gul14::sleep(1ms);
+
+        auto task = pool->try_add_task([]() { return 42; });
+        REQUIRE(task.has_value());
+        REQUIRE(task->get_result() == 42);
+    }
+
+    SECTION("add_task_blocking() with a timeout")
+    {
+        auto t0 = gul14::tic();
+        auto task = pool->add_task_blocking([]() { return 3; }, 20ms);
+        REQUIRE(gul14::toc<std::chrono::milliseconds>(t0) >= 20);
+        REQUIRE_FALSE(task.has_value());
+
+        go = true;
+        task = pool->add_task_blocking([]() { return 4; }, 10s, "Name");
+        REQUIRE(task.has_value());
+        REQUIRE(task->get_result() == 4);
+    }
+
+    SECTION("add_task_blocking() waits for room in the queue")
+    {
+        std::atomic<bool> added{ false };
+        ThreadPool::TaskHandle<int> task;
+
+        std::thread producer(
+            [&pool, &added, &task]()
+            {
+                task = pool->add_task_blocking([](ThreadPool&) { return 5; });
+                added = true;
+            });
+
+        gul14::sleep(20ms);
+        REQUIRE(added == false);
+
+        go = true;
+        producer.join();
+        REQUIRE(added == true);
+        REQUIRE(task.get_result() == 5);
+    }
+
+    SECTION("Many producers are throttled")
+    {
+        std::atomic<int> counter{ 0 };
+        std::vector<std::thread> producers;
+
+        go = true;
+        for (int i = 0; i != 4; ++i)
+        {
+            producers.emplace_back(
+                [&pool, &counter]()
+                {
+                    for (int j = 0; j != 100; ++j)
+                        pool->add_task_blocking([&counter]() { ++counter; });
+                });
+        }
+        for (auto& producer : producers)
+            producer.join();
+
+        while (!pool->is_idle())
+        {
+            REQUIRE(pool->count_pending() <= 2);
+            gul14::sleep(1ms);
+        }
+        REQUIRE(counter == 400);
+    }
+
+    go = true;
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: Tasks scheduling their own continuation", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(2);
+
+    std::mutex mutex;
+    std::string str;
+
+    pool->add_task(
+        [&mutex, &str](ThreadPool& p)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                str += '1';
+            }
+
+            p.add_task(
+                [&mutex, &str]()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        str += '2';
+                    }
+                });
+
+            p.add_task(
+                [&mutex, &str]()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        str += '3';
+                    }
+                }, 3ms);
+        });
+
+    while (not pool->is_idle())
+        gul14::sleep(1ms);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        REQUIRE(str == "123");
+    }
+
+    // Make sure the pool is removed before any captured variable goes out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: Work stealing", "[ThreadPool]")
+{
+    ThreadPoolOptions options;
+    options.num_threads = 4;
+    options.capacity = 1000;
+    options.work_stealing = true;
+
+    auto pool = make_thread_pool(options);
+
+    std::atomic<int> counter{ 0 };
+    std::array<std::atomic<int>, 4> tasks_per_thread{};
+
+    SECTION("Tasks spawned by workers are executed")
+    {
+        for (int i = 0; i != 10; ++i)
+        {
+            pool->add_task(
+                [&counter, &tasks_per_thread](ThreadPool& p)
+                {
+                    for (int j = 0; j != 50; ++j)
+                    {
+                        p.add_task(
+                            [&counter, &tasks_per_thread](ThreadPool& p2)
+                            {
+                                ++tasks_per_thread[p2.get_thread_id()];
+                                ++counter;
+                                gul14::sleep(10us);
+                            });
+                    }
+                });
+        }
+
+        while (not pool->is_idle())
+            gul14::sleep(1ms);
+
+        REQUIRE(counter == 500);
+        REQUIRE(pool->count_pending() == 0);
+    }
+
+    SECTION("Local tasks can be queried and canceled")
+    {
+        Trigger go;
+        std::atomic<bool> spawned{ false };
+        ThreadPool::TaskHandle<void> handle;
+
+        // Occupy all workers so that the local tasks stay in the queue.
+        for (int i = 0; i != 3; ++i)
+            pool->add_task([&go]() { go.wait(); });
+
+        while (pool->count_pending() != 0)
+            gul14::sleep(1ms);
+
+        pool->add_task(
+            [&](ThreadPool& p)
+            {
+                handle = p.add_task([&counter]() { ++counter; }, "local");
+                p.add_task([&counter]() { ++counter; }, "local 2");
+                spawned = true;
+                go.wait();
+            });
+
+        while (!spawned)
+            gul14::sleep(1ms);
+
+        REQUIRE(handle.get_state() == TaskState::pending);
+        REQUIRE(pool->count_pending() == 2);
+        REQUIRE(pool->get_pending_task_names().size() == 2);
+
+        REQUIRE(handle.cancel() == true);
+        REQUIRE(handle.get_state() == TaskState::canceled);
+        REQUIRE(pool->count_pending() == 1);
+
+        go = true;
+
+        while (not pool->is_idle())
+            gul14::sleep(1ms);
+
+        REQUIRE(counter == 1);
+    }
+
+    SECTION("Local queues respect the capacity limit")
+    {
+        Trigger go;
+        std::atomic<bool> threw{ false };
+
+        pool->add_task(
+            [&](ThreadPool& p)
+            {
+                try
+                {
+                    // Other workers may steal some tasks, so try adding more
+                    for (std::size_t i = 0; i <= 2 * p.capacity(); ++i)
+                        p.add_task([&go]() { go.wait(); });
+                }
+                catch (const std::runtime_error&)
+                {
+                    threw = true;
+                }
+            });
+
+        while (not threw)
+            gul14::sleep(1ms);
+
+        // Each of the four workers may have started one of the tasks in the meantime
+        REQUIRE(pool->count_pending() + 4 >= pool->capacity());
+
+        go = true;
+        while (not pool->is_idle())
+            gul14::sleep(1ms);
+    }
+
+    // Make sure the pool is removed before any captured variable goes out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: Delayed tasks start in the order of their start times",
+    "[ThreadPool]")
+{
+    auto pool = make_thread_pool(1);
+
+    std::mutex mutex;
+    std::string str;
+
+    const auto append = [&mutex, &str](char c)
+        {
+            return [&mutex, &str, c]()
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    str += c;
+                };
+        };
+
+    const auto now = std::chrono::system_clock::now();
+    pool->add_task(append('3'), now + 30ms, "3");
+    pool->add_task(append('1'), now + 10ms, "1");
+    pool->add_task(append('4'), now + 30ms, "4");
+    pool->add_task(append('2'), now + 20ms, "2");
+
+    auto names = pool->get_pending_task_names();
+    REQUIRE(names.size() == 4);
+    REQUIRE(names[0] == "1");
+    REQUIRE(names[1] == "2");
+    REQUIRE(names[2] == "3");
+    REQUIRE(names[3] == "4");
+
+    while (not pool->is_idle())
+        gul14::sleep(1ms);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        REQUIRE(str == "1234");
+    }
+
+    // Make sure the pool is removed before any captured variable goes out of scope
+    pool.reset();
+}
+
+TEST_CASE("ThreadPool: Many delayed tasks do not slow down ready ones", "[ThreadPool]")
+{
+    auto pool = make_thread_pool(2, 200'000);
+
+    std::atomic<int> counter{ 0 };
+
+    for (int i = 0; i != 100'000; ++i)
+        pool->add_task([&counter]() { ++counter; }, 1h + i * 1ms);
+
+    auto task = pool->add_task([&counter]() { ++counter; }, 1h + 1us);
 
-    pool->add_task(
-        [&](ThreadPool& p) { trigger.wait(); indices[0] = p.get_thread_id(); });
-    pool->add_task(
-        [&](ThreadPool& p) { trigger.wait(); indices[1] = p.get_thread_id(); });
+    for (int i = 0; i != 100; ++i)
+        pool->add_task([&counter]() { ++counter; });
 
-    while (pool->count_pending() > 0)
+    auto t0 = gul14::tic();
+    while (counter != 100)
+    {
+        if (gul14::toc(t0) > 5.0)
+            FAIL("Timeout waiting for ready tasks");
         gul14::sleep(1ms);
+    }
 
-    trigger = true;
-
-    // From a non-worker thread, the function must throw.
-    REQUIRE_THROWS_AS(pool->get_thread_id(), std::runtime_error);
+    REQUIRE(pool->count_pending() == 100'001);
+    REQUIRE(task.cancel() == true);
+    REQUIRE(pool->count_pending() == 100'000);
+    REQUIRE(pool->cancel_pending_tasks() == 100'000);
+    REQUIRE(counter == 100);
 
+    // Make sure the pool is removed before any captured variable goes out of scope
     pool.reset();
-
-    CAPTURE(indices);
-    REQUIRE(indices[0] <= 1);
-    REQUIRE(indices[1] <= 1);
-    if (indices[0] == 0)
-        REQUIRE(indices[1] == 1);
-    if (indices[0] == 1)
-        REQUIRE(indices[1] == 0);
 }
 
-TEST_CASE("ThreadPool: is_full()", "[ThreadPool]")
+TEST_CASE("ThreadPool: Start times on the steady clock", "[ThreadPool]")
 {
     auto pool = make_thread_pool(1);
 
-    std::atomic<bool> stop{ false };
+    const auto start = std::chrono::steady_clock::now() + 20ms;
 
-    pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
+    auto task = pool->add_task(
+        []() { return std::chrono::steady_clock::now(); }, start, "steady");
+    auto task2 = pool->add_task(
+        [](ThreadPool&) { return std::chrono::steady_clock::now(); }, 10ms);
 
-    // Wait until the first task is running
-    while (pool->count_pending() > 0)
-        gul14::sleep(1ms);
+    REQUIRE(pool->get_pending_task_names().size() == 2);
+    REQUIRE(task2.get_result() >= start - 10ms);
+    REQUIRE(task.get_result() >= start);
+}
 
-    // Enqueue tasks up to the capacity of the pool
-    for (std::size_t i = 1; i <= pool->capacity(); ++i)
+TEST_CASE("ThreadPool: Worker groups and CPU sets", "[ThreadPool]")
+{
+    const auto get_group = [](ThreadPool& p)
+        {
+            return p.get_thread_worker_group(p.get_thread_id());
+        };
+
+    SECTION("Default pool has a single group of unpinned workers")
     {
-        REQUIRE(pool->is_full() == false);
-        pool->add_task([&stop]() { while (!stop) gul14::sleep(10us); });
+        auto pool = make_thread_pool(2);
+        REQUIRE(pool->count_worker_groups() == 1);
+        REQUIRE(pool->get_thread_worker_group(1) == 0);
+        REQUIRE(pool->get_thread_cpu_set(0).empty());
+        REQUIRE_THROWS_AS(pool->get_thread_cpu_set(2), std::out_of_range);
+        REQUIRE(pool->add_task_to_worker_group(0, []() { return 42; }).get_result()
+            == 42);
+        REQUIRE_THROWS_AS(pool->add_task_to_worker_group(1, []() {}), std::out_of_range);
     }
 
-    // One work item is currently executing, the queue is full
-    REQUIRE(pool->is_full());
+    SECTION("Tasks for a group are executed by the workers of that group")
+    {
+        ThreadPoolOptions options;
+        options.num_threads = 5;
+        options.cpu_sets = { { 0 }, { 0, 0 } };
+        auto pool = make_thread_pool(options);
 
-    stop = true;
+        REQUIRE(pool->count_worker_groups() == 2);
+        for (ThreadPool::ThreadId i = 0; i != 5; ++i)
+        {
+            REQUIRE(pool->get_thread_worker_group(i) == i % 2);
+            REQUIRE(pool->get_thread_cpu_set(i) == std::vector<unsigned int>{ 0 });
+        }
+
+        std::vector<ThreadPool::TaskHandle<std::size_t>> handles;
+        for (int i = 0; i != 100; ++i)
+            handles.push_back(
+                pool->add_task_to_worker_group(i % 2, get_group, "grouped"));
+        auto ungrouped = pool->add_task([]() { return 1; });
+
+        for (int i = 0; i != 100; ++i)
+            REQUIRE(handles[i].get_result() == static_cast<std::size_t>(i % 2));
+        REQUIRE(ungrouped.get_result() == 1);
+    }
 
-    // Make sure the pool is removed before any of the atomic variables go out of scope
-    pool.reset();
-}
+    SECTION("Canceling tasks of a group")
+    {
+        ThreadPoolOptions options;
+        options.num_threads = 2;
+        options.cpu_sets = { { 0 }, { 0 } };
+        auto pool = make_thread_pool(options);
+
+        Trigger go;
+        auto blocker = pool->add_task_to_worker_group(1, [&go]() { go.wait(); });
+        while (pool->count_pending() != 0)
+            gul14::sleep(1ms);
+
+        auto task = pool->add_task_to_worker_group(1, get_group, "waiting");
+        REQUIRE(pool->get_pending_task_names() == std::vector<std::string>{ "waiting" });
+        REQUIRE(task.cancel() == true);
+        REQUIRE(pool->add_task_to_worker_group(1, []() { return 2; }).cancel() == true);
+        REQUIRE(pool->count_pending() == 0);
+
+        go = true;
+        pool.reset();
+    }
 
-TEST_CASE("ThreadPool: is_idle()", "[ThreadPool]")
-{
-    auto pool = make_thread_pool(1);
-    REQUIRE(pool->is_idle());
+    SECTION("NUMA groups")
+    {
+        ThreadPoolOptions options;
+        options.num_threads = 2;
+        options.numa_groups = true;
+        auto pool = make_thread_pool(options);
+
+        REQUIRE(pool->count_worker_groups() >= 1);
+        REQUIRE(pool->count_worker_groups() <= 2);
+        const auto last_group = pool->count_worker_groups() - 1;
+        REQUIRE(pool->add_task_to_worker_group(last_group, get_group).get_result()
+            == last_group);
+
+        options.cpu_sets = { { 0 } };
+        REQUIRE_THROWS_AS(make_thread_pool(options), std::invalid_argument);
+    }
+
+    SECTION("Invalid CPU sets")
+    {
+        ThreadPoolOptions options;
+        options.num_threads = 2;
+        options.cpu_sets = { { 0 }, { 1 }, { 2 } };
+        REQUIRE_THROWS_AS(make_thread_pool(options), std::invalid_argument);
+
+        options.cpu_sets = { { 0 }, {} };
+        REQUIRE_THROWS_AS(make_thread_pool(options), std::invalid_argument);
+    }
 }
 
-TEST_CASE("ThreadPool: Run 100 functions on a single thread, check order", "[ThreadPool]")
+TEST_CASE("ThreadPool: Elastic thread count", "[ThreadPool]")
 {
-    auto pool = make_thread_pool(1);
+    const auto wait_until = [](auto condition)
+        {
+            auto t0 = gul14::tic();
+            while (!condition())
+            {
+                if (gul14::toc(t0) > 10.0)
+                    FAIL("Timeout");
+                gul14::sleep(1ms);
+            }
+        };
 
-    std::vector<std::function<void()>> functions;
+    ThreadPoolOptions options;
+    options.num_threads = 2;
+    options.min_num_threads = 1;
+    options.max_num_threads = 4;
+    options.capacity = 1000;
+    options.idle_timeout = 0s;
 
-    std::mutex mutex;
-    std::vector<int> output;
+    SECTION("set_thread_count()")
+    {
+        auto pool = make_thread_pool(options);
+        REQUIRE(pool->count_threads() == 2);
 
-    for (int i = 1; i <= 100; ++i)
+        REQUIRE_THROWS_AS(pool->set_thread_count(0), std::invalid_argument);
+        REQUIRE_THROWS_AS(pool->set_thread_count(5), std::invalid_argument);
+
+        // Four tasks that can only finish together need four threads
+        pool->set_thread_count(4);
+        REQUIRE(pool->count_threads() == 4);
+
+        std::atomic<int> num_started{ 0 };
+        std::vector<ThreadPool::TaskHandle<ThreadPool::ThreadId>> handles;
+        for (int i = 0; i != 4; ++i)
+        {
+            handles.push_back(pool->add_task(
+                [&num_started](ThreadPool& p)
+                {
+                    ++num_started;
+                    while (num_started != 4)
+                        gul14::sleep(100us);
+                    return p.get_thread_id();
+                }));
+        }
+        for (auto& handle : handles)
+            REQUIRE(handle.get_result() < 4);
+
+        // After shrinking, only the worker with the lowest ID remains
+        pool->set_thread_count(1);
+        REQUIRE(pool->count_threads() == 1);
+
+        for (int i = 0; i != 20; ++i)
+        {
+            REQUIRE(pool->add_task([](ThreadPool& p) { return p.get_thread_id(); })
+                .get_result() == 0);
+        }
+
+        pool->set_thread_count(3);
+        REQUIRE(pool->count_threads() == 3);
+        REQUIRE(pool->add_task([]() { return 1; }).get_result() == 1);
+    }
+
+    SECTION("Shrinking a work-stealing pool keeps local tasks")
     {
-        functions.emplace_back(
-            [i, &mutex, &output]()
+        options.work_stealing = true;
+        auto pool = make_thread_pool(options);
+
+        std::atomic<int> counter{ 0 };
+        pool->set_thread_count(4);
+        for (int i = 0; i != 8; ++i)
+        {
+            pool->add_task(
+                [&counter](ThreadPool& p)
+                {
+                    for (int j = 0; j != 50; ++j)
+                        p.add_task([&counter]() { ++counter; gul14::sleep(10us); });
+                });
+        }
+        pool->set_thread_count(1);
+
+        wait_until([&counter]() { return counter == 400; });
+        pool.reset();
+    }
+
+    SECTION("The pool grows when tasks wait for too long")
+    {
+        options.num_threads = 1;
+        options.queue_wait_threshold = 1ms;
+        auto pool = make_thread_pool(options);
+
+        Trigger go;
+        pool->add_task([&go]() { go.wait(); });
+        // Growth is checked on submission, so keep adding tasks
+        wait_until([&pool]()
             {
-                std::lock_guard<std::mutex> lock(mutex);
-                output.push_back(i);
+                pool->add_task([]() { gul14::sleep(1ms); });
+                return pool->count_threads() > 1;
             });
-    }
+        REQUIRE(pool->count_threads() <= 4);
 
-    for (auto& fct : functions)
-        pool->add_task(fct);
+        go = true;
+        pool.reset();
+    }
 
-    while (not pool->is_idle())
+    SECTION("Idle workers are retired")
     {
-        REQUIRE(pool->count_pending() <= functions.size());
-        REQUIRE(pool->count_pending() <= pool->capacity());
-        gul14::sleep(1ms);
-    }
+        options.num_threads = 4;
+        options.idle_timeout = 10ms;
+        auto pool = make_thread_pool(options);
 
-    REQUIRE(output.size() == 100);
+        wait_until([&pool]() { return pool->count_threads() == 1; });
+        REQUIRE(pool->add_task([]() { return 2; }).get_result() == 2);
+    }
 
-    for (int i = 0; i != 100; ++i)
-        REQUIRE(output[i] == i + 1);
+    SECTION("Invalid limits")
+    {
+        options.min_num_threads = 3;
+        REQUIRE_THROWS_AS(make_thread_pool(options), std::invalid_argument);
 
-    // Make sure the pool is removed before any of the captured variables go out of scope
-    pool.reset();
+        options.min_num_threads = 1;
+        options.max_num_threads = 1;
+        REQUIRE_THROWS_AS(make_thread_pool(options), std::invalid_argument);
+    }
 }
 
-TEST_CASE("ThreadPool: Run 100 functions on 4 threads", "[ThreadPool]")
+TEST_CASE("ThreadPool: Spinning idle workers", "[ThreadPool]")
 {
-    auto pool = make_thread_pool(4);
+    ThreadPoolOptions options;
+    options.num_threads = 2;
+    options.spin_duration = 1ms;
 
-    std::mutex mutex;
-    std::vector<int> output;
+    SECTION("Sequential tasks")
+    {
+        auto pool = make_thread_pool(options);
 
-    for (int i = 1; i <= 100; ++i)
+        for (int i = 0; i != 1000; ++i)
+            REQUIRE(pool->add_task([i]() { return i; }).get_result() == i);
+    }
+
+    SECTION("No task is lost with several producers")
     {
-        pool->add_task(
-            [i, &mutex, &output]()
-            {
+        options.num_threads = 3;
+        auto pool = make_thread_pool(options);
+        std::atomic<int> num_done{ 0 };
+
+        std::vector<std::thread> producers;
+        for (int i = 0; i != 3; ++i)
+        {
+            producers.emplace_back([&pool, &num_done]()
                 {
-                    std::lock_guard<std::mutex> lock(mutex);
-                    output.push_back(i);
-                }
-                gul14::sleep(100us);
+                    for (int j = 0; j != 1000; ++j)
+                        pool->add_task_blocking([&num_done]() { ++num_done; });
+                });
+        }
+        for (auto& producer : producers)
+            producer.join();
+
+        const auto t0 = gul14::tic();
+        while (num_done != 3000 && gul14::toc(t0) < 10.0)
+            gul14::sleep(1ms);
+        REQUIRE(num_done == 3000);
+    }
+
+    SECTION("Workers that have gone to sleep are woken up")
+    {
+        options.work_stealing = true;
+        auto pool = make_thread_pool(options);
+
+        gul14::sleep(10ms);
+        REQUIRE(pool->add_task([]() { return 1; }).get_result() == 1);
+
+        gul14::sleep(10ms);
+        auto task = pool->add_task([](ThreadPool& p)
+            {
+                auto inner = p.add_task([]() { return 2; });
+                gul14::sleep(5ms);
+                return inner;
             });
+        REQUIRE(task.get_result().get_result() == 2);
     }
+}
 
-    while (not pool->is_idle())
+TEST_CASE("ThreadPool: Periodic tasks", "[ThreadPool]")
+{
+    using SteadyTimePoint = ThreadPool::SteadyTimePoint;
+
+    auto pool = make_thread_pool(2);
+
+    std::mutex mutex;
+    std::vector<SteadyTimePoint> start_times;
+
+    const auto record = [&mutex, &start_times](std::chrono::milliseconds duration)
+        {
+            return [&mutex, &start_times, duration]()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        start_times.push_back(std::chrono::steady_clock::now());
+                    }
+                    gul14::sleep(duration);
+                };
+        };
+
+    const auto wait_for_runs = [](const ThreadPool::PeriodicTaskHandle& handle,
+                                  std::size_t num_runs)
+        {
+            auto t0 = gul14::tic();
+            while (handle.count_runs() < num_runs)
+            {
+                if (gul14::toc(t0) > 10.0)
+                    FAIL("Timeout waiting for periodic task");
+                gul14::sleep(1ms);
+            }
+        };
+
+    SECTION("Fixed rate does not drift with the execution time")
     {
-        REQUIRE(pool->count_pending() <= 100);
-        REQUIRE(pool->count_pending() <= pool->capacity());
-        gul14::sleep(1ms);
+        const auto before = std::chrono::steady_clock::now();
+        auto handle = pool->add_periodic_task(record(10ms), 20ms, "periodic");
+
+        REQUIRE(handle.get_state() != TaskState::canceled);
+        wait_for_runs(handle, 11);
+        REQUIRE(handle.cancel() == true);
+        REQUIRE(handle.cancel() == false);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        REQUIRE(start_times.size() >= 11);
+        for (std::size_t i = 0; i != start_times.size(); ++i)
+            REQUIRE(start_times[i] >= before + i * 20ms);
+
+        // With a fixed delay, 10 periods would take at least 300 ms
+        REQUIRE(start_times[10] - start_times[0] < 280ms);
     }
 
-    REQUIRE(output.size() == 100);
+    SECTION("Fixed delay")
+    {
+        PeriodicTaskOptions options;
+        options.mode = PeriodicTaskOptions::Mode::fixed_delay;
+        options.initial_delay = 5ms;
 
-    std::sort(output.begin(), output.end());
+        const auto before = std::chrono::steady_clock::now();
+        auto handle = pool->add_periodic_task(record(5ms), 10ms, options);
+        wait_for_runs(handle, 4);
+        handle.cancel();
 
-    for (int i = 0; i != 100; ++i)
-        REQUIRE(output[i] == i + 1);
+        std::lock_guard<std::mutex> lock(mutex);
+        REQUIRE(start_times[0] >= before + 5ms);
+        for (std::size_t i = 1; i != start_times.size(); ++i)
+            REQUIRE(start_times[i] - start_times[i - 1] >= 15ms);
+    }
 
-    // Make sure the pool is removed before any of the captured variables go out of scope
-    pool.reset();
-}
+    SECTION("Missed ticks are skipped by default")
+    {
+        std::atomic<int> run{ 0 };
+        const auto before = std::chrono::steady_clock::now();
 
-TEST_CASE("ThreadPool: Capacity limit", "[ThreadPool]")
-{
-    std::size_t max_jobs{ 10 };
-    auto pool = make_thread_pool(1, max_jobs);
+        auto handle = pool->add_periodic_task(
+            [&run, work = record(0ms)]()
+            {
+                work();
+                if (run++ == 0)
+                    gul14::sleep(55ms);
+            },
+            10ms);
+        wait_for_runs(handle, 3);
+        handle.cancel();
 
-    std::atomic<bool> go{ false };
+        std::lock_guard<std::mutex> lock(mutex);
+        REQUIRE(start_times[1] >= before + 60ms);
+        REQUIRE(start_times[2] >= before + 70ms);
+    }
 
-    for (std::size_t i = 0; i != max_jobs; ++i)
+    SECTION("Missed ticks can be caught up")
     {
-        pool->add_task(
-            [&go]()
+        PeriodicTaskOptions options;
+        options.skip_missed_ticks = false;
+
+        std::atomic<int> run{ 0 };
+        auto handle = pool->add_periodic_task(
+            [&run, work = record(0ms)]()
             {
-                while (!go)
-                    gul14::sleep(100us);
-            });
+                work();
+                if (run++ == 0)
+                    gul14::sleep(55ms);
+            },
+            10ms, options);
+        wait_for_runs(handle, 6);
+        handle.cancel();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        REQUIRE(start_times[5] - start_times[0] < 60ms + 10ms);
     }
 
-    // Wait until first job has started
-    while (pool->count_pending() != max_jobs - 1)
-        gul14::sleep(1ms);
+    SECTION("Canceling a running periodic task")
+    {
+        Trigger running;
+        Trigger go;
 
-    // Add yet another task, filling the queue
-    pool->add_task(
-        [&go]()
+        auto handle = pool->add_periodic_task(
+            [&running, &go]() { running = true; go.wait(); }, 1ms);
+
+        running.wait();
+        REQUIRE(handle.get_state() == TaskState::running);
+        REQUIRE(handle.cancel() == true);
+        go = true;
+
+        auto t0 = gul14::tic();
+        while (handle.get_state() != TaskState::canceled)
         {
-            while (!go)
-                gul14::sleep(100us);
-        });
-    REQUIRE(pool->is_full());
+            if (gul14::toc(t0) > 10.0)
+                FAIL("Timeout waiting for cancellation");
+            gul14::sleep(1ms);
+        }
 
-    REQUIRE_THROWS_AS(pool->add_task([]() {}), std::runtime_error);
+        REQUIRE(handle.count_runs() == 1);
+        REQUIRE(pool->count_pending() == 0);
 
-    go = true;
+        pool.reset();
+    }
 
-    while (not pool->is_idle())
+    SECTION("Periodic tasks are canceled with the pool")
     {
-        REQUIRE(pool->count_pending() <= max_jobs);
-        gul14::sleep(1ms);
+        PeriodicTaskOptions options;
+        options.initial_delay = 1h;
+
+        auto handle = pool->add_periodic_task([]() {}, 1s, options);
+        REQUIRE(pool->count_pending() == 1);
+        REQUIRE(handle.get_state() == TaskState::pending);
+        pool.reset();
+        REQUIRE(handle.get_state() == TaskState::canceled);
+        REQUIRE(handle.count_runs() == 0);
     }
 
-    REQUIRE_NOTHROW(pool->add_task([]() {}));
+    SECTION("Invalid period")
+    {
+        REQUIRE_THROWS_AS(pool->add_periodic_task([]() {}, 0s), std::invalid_argument);
+    }
 
     // Make sure the pool is removed before any captured variable goes out of scope
     pool.reset();
 }
 
-TEST_CASE("ThreadPool: Tasks scheduling their own continuation", "[ThreadPool]")
+TEST_CASE("ThreadPool: Timer wheel", "[ThreadPool]")
 {
-    auto pool = make_thread_pool(2);
+    ThreadPoolOptions options;
+    options.num_threads = 2;
+    options.capacity = 200'000;
+    options.timer_wheel = true;
 
-    std::mutex mutex;
-    std::string str;
+    auto pool = make_thread_pool(options);
 
-    pool->add_task(
-        [&mutex, &str](ThreadPool& p)
+    SECTION("Delayed tasks do not start early")
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        std::vector<ThreadPool::TaskHandle<std::chrono::steady_clock::time_point>> tasks;
+        for (auto delay : { 0ms, 1ms, 5ms, 30ms, 300ms, 2ms, 400ms })
         {
-            {
-                std::lock_guard<std::mutex> lock(mutex);
-                str += '1';
-            }
+            tasks.push_back(pool->add_task(
+                []() { return std::chrono::steady_clock::now(); }, now + delay));
+        }
+
+        REQUIRE(tasks[6].get_result() >= now + 400ms);
+        REQUIRE(tasks[4].get_result() >= now + 300ms);
+        REQUIRE(tasks[3].get_result() >= now + 30ms);
+        REQUIRE(tasks[2].get_result() >= now + 5ms);
+        REQUIRE(tasks[5].get_result() >= now + 2ms);
+        REQUIRE(tasks[1].get_result() >= now + 1ms);
+        REQUIRE(tasks[0].get_result() >= now);
+    }
 
-            p.add_task(
-                [&mutex, &str]()
-                {
-                    {
-                        std::lock_guard<std::mutex> lock(mutex);
-                        str += '2';
-                    }
-                });
+    SECTION("Tasks that are cascaded from higher levels start on time")
+    {
+        // Every millisecond from 250 to 1100 ms, so that some tasks are due just before
+        // a cascade of level 1 and are moved down in the same tick
+        constexpr int num_tasks = 851;
+        std::atomic<int> counter{ 0 };
+        const auto start = std::chrono::steady_clock::now();
 
-            p.add_task(
-                [&mutex, &str]()
-                {
-                    {
-                        std::lock_guard<std::mutex> lock(mutex);
-                        str += '3';
-                    }
-                }, 3ms);
-        });
+        for (int i = 0; i != num_tasks; ++i)
+            pool->add_task([&counter]() { ++counter; }, start + 250ms + i * 1ms);
 
-    while (not pool->is_idle())
-        gul14::sleep(1ms);
+        while (counter != num_tasks && std::chrono::steady_clock::now() < start + 5s)
+            gul14::sleep(10ms);
 
+        REQUIRE(counter == num_tasks);
+        REQUIRE(pool->count_pending() == 0);
+
+        // Make sure the pool is removed before any captured variable goes out of scope
+        pool.reset();
+    }
+
+    SECTION("Canceling many timeouts")
     {
-        std::lock_guard<std::mutex> lock(mutex);
-        REQUIRE(str == "123");
+        std::atomic<int> counter{ 0 };
+
+        std::vector<ThreadPool::TaskHandle<void>> handles;
+        handles.reserve(100'000);
+        for (int i = 0; i != 100'000; ++i)
+            handles.push_back(pool->add_task([&counter]() { ++counter; }, 1h + i * 1ms));
+
+        auto far_task = pool->add_task([&counter]() { ++counter; }, 24h * 100);
+
+        REQUIRE(pool->count_pending() == 100'001);
+        REQUIRE(pool->get_pending_task_names().size() == 100'001);
+
+        for (auto& handle : handles)
+            REQUIRE(handle.cancel() == true);
+        REQUIRE(far_task.cancel() == true);
+
+        REQUIRE(pool->count_pending() == 0);
+
+        auto task = pool->add_task([&counter]() { ++counter; }, 2ms);
+        task.get_result();
+        REQUIRE(counter == 1);
+        REQUIRE(pool->get_pending_task_names().empty());
+
+        // Make sure the pool is removed before any captured variable goes out of scope
+        pool.reset();
     }
 
-    // Make sure the pool is removed before any captured variable goes out of scope
-    pool.reset();
+    SECTION("Pending tasks are canceled on destruction")
+    {
+        auto task = pool->add_task([]() {}, 10min);
+        pool.reset();
+        REQUIRE(task.get_state() == TaskState::canceled);
+    }
 }
@@ -0,0 +1,167 @@
+/**
+ * \file   test_parallel.cc
+ * \author \ref contributors
+ * \date   Created on October 15, 2026
+ * \brief  Test suite for the data-parallel algorithms in parallel.h.
+ *
+ * \copyright Copyright 2026 Deutsches Elektronen-Synchrotron (DESY), Hamburg
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 2.1 of the license, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gul14/catch.h"
+#include "gul14/parallel.h"
+
+using namespace gul14;
+
+TEST_CASE("parallel_for()", "[parallel]")
+{
+    auto pool = make_thread_pool(3);
+
+    SECTION("Iterator range")
+    {
+        std::vector<int> values(10000);
+        std::iota(values.begin(), values.end(), 0);
+
+        parallel_for(*pool, values.begin(), values.end(), [](int& v) { v *= 2; });
+
+        for (int i = 0; i != 10000; ++i)
+            REQUIRE(values[i] == 2 * i);
+    }
+
+    SECTION("Span")
+    {
+        std::vector<int> values(1000, 1);
+        std::atomic<int> sum{ 0 };
+
+        parallel_for(*pool, span<const int>(values), [&sum](int v) { sum += v; });
+
+        REQUIRE(sum == 1000);
+    }
+
+    SECTION("Empty range and single element")
+    {
+        std::vector<int> values;
+        parallel_for(*pool, values.begin(), values.end(), [](int&) { FAIL(); });
+
+        values.push_back(1);
+        parallel_for(*pool, values.begin(), values.end(), [](int& v) { v = 42; });
+        REQUIRE(values[0] == 42);
+    }
+
+    SECTION("Exceptions are rethrown")
+    {
+        std::vector<int> values(1000);
+        std::iota(values.begin(), values.end(), 0);
+
+        REQUIRE_THROWS_AS(parallel_for(*pool, values.begin(), values.end(),
+            [](int v) { if (v == 500) throw std::runtime_error("Test"); }),
+            std::runtime_error);
+
+        REQUIRE(pool->count_pending() == 0);
+    }
+
+    SECTION("Call from within a task on the same pool")
+    {
+        auto single_pool = make_thread_pool(1);
+
+        auto task = single_pool->add_task(
+            [](ThreadPool& p)
+            {
+                std::vector<int> values(100, 1);
+                parallel_for(p, values.begin(), values.end(), [](int& v) { ++v; });
+                return std::accumulate(values.begin(), values.end(), 0);
+            });
+
+        REQUIRE(task.get_result() == 200);
+    }
+}
+
+TEST_CASE("parallel_transform()", "[parallel]")
+{
+    auto pool = make_thread_pool(2);
+
+    std::vector<int> input(5000);
+    std::iota(input.begin(), input.end(), 0);
+
+    SECTION("Iterator range")
+    {
+        std::vector<std::string> output(input.size());
+
+        auto it = parallel_transform(*pool, input.begin(), input.end(), output.begin(),
+            [](int v) { return std::to_string(v); });
+
+        REQUIRE(it == output.end());
+        for (std::size_t i = 0; i != input.size(); ++i)
+            REQUIRE(output[i] == std::to_string(i));
+    }
+
+    SECTION("Span")
+    {
+        std::vector<long> output(input.size());
+
+        parallel_transform(*pool, span<const int>(input), span<long>(output),
+            [](int v) { return 3L * v; });
+
+        for (std::size_t i = 0; i != input.size(); ++i)
+            REQUIRE(output[i] == 3L * static_cast<long>(i));
+
+        output.resize(10);
+        REQUIRE_THROWS_AS(parallel_transform(*pool, span<const int>(input),
+            span<long>(output), [](int v) { return v; }), std::invalid_argument);
+    }
+}
+
+TEST_CASE("parallel_reduce()", "[parallel]")
+{
+    auto pool = make_thread_pool(4);
+
+    std::vector<long long> values(100000);
+    std::iota(values.begin(), values.end(), 1);
+
+    SECTION("Sum")
+    {
+        auto sum = parallel_reduce(*pool, values.begin(), values.end(), 0LL,
+            std::plus<long long>{});
+        REQUIRE(sum == 5000050000LL);
+
+        sum = parallel_reduce(*pool, span<const long long>(values), 10LL,
+            std::plus<long long>{});
+        REQUIRE(sum == 5000050010LL);
+    }
+
+    SECTION("Maximum")
+    {
+        values[12345] = 1'000'000;
+        auto max = parallel_reduce(*pool, values.begin(), values.end(), 0LL,
+            [](long long a, long long b) { return a > b ? a : b; });
+        REQUIRE(max == 1'000'000);
+    }
+
+    SECTION("Empty range")
+    {
+        auto sum = parallel_reduce(*pool, values.begin(), values.begin(), 42LL,
+            std::plus<long long>{});
+        REQUIRE(sum == 42);
+    }
+}